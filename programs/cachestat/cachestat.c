@@ -0,0 +1,76 @@
+#include "crosos.h"
+#include "stdlib.h"
+#include "stdio.h"
+#include "memory.h"
+
+#define CACHESTAT_DEFAULT_FILE "0:/blank.elf"
+
+//Prints the counters of the disk block cache
+static void cachestat_print(struct crosos_disk_cache_stats* stats)
+{
+    printf("  entries: %i used: %i dirty: %i\n", stats->total_entries, stats->used_entries, stats->dirty_entries);
+    printf("  hits: %i misses: %i evictions: %i\n", stats->hits, stats->misses, stats->evictions);
+    printf("  read ahead: %i written back: %i\n", stats->prefetched, stats->writebacks);
+}
+
+//Opens and reads a whole file, then tells the hits and misses of the cache it caused
+static int cachestat_read_file(const char* filename, int pass)
+{
+    struct crosos_disk_cache_stats before;
+    struct crosos_disk_cache_stats after;
+    if(crosos_disk_cache_stats(&before) < 0)
+    {
+        return -1;
+    }
+
+    int fd = crosos_fopen(filename, "r");
+    if(!fd)
+    {
+        printf("Could not open %s\n", filename);
+        return -1;
+    }
+
+    int res = -1;
+    struct crosos_file_stat stat;
+    char* buffer = 0;
+    if(crosos_fstat(fd, &stat) == 0)
+    {
+        buffer = malloc(stat.filesize ? stat.filesize : 1);
+    }
+    if(buffer && (stat.filesize == 0 || crosos_fread(buffer, stat.filesize, 1, fd) == 1) && crosos_disk_cache_stats(&after) == 0)
+    {
+        printf("  pass %i, %i bytes: %i hits, %i misses\n", pass, stat.filesize, after.hits - before.hits, after.misses - before.misses);
+        res = 0;
+    }
+
+    free(buffer);
+    crosos_fclose(fd);
+    return res;
+}
+
+//Dumps the disk block cache counters, and reads a file twice to show the second open and read hit only memory
+//Usage: cachestat [file]
+int main(int argc, char** argv)
+{
+    const char* filename = argc > 1 ? argv[1] : CACHESTAT_DEFAULT_FILE;
+    struct crosos_disk_cache_stats stats;
+    memset(&stats, 0, sizeof(stats));
+    if(crosos_disk_cache_stats(&stats) < 0)
+    {
+        printf("Could not read the disk cache statistics\n");
+        return -1;
+    }
+
+    printf("Disk block cache (sectors of 512 bytes)\n");
+    cachestat_print(&stats);
+
+    printf("Reading %s twice\n", filename);
+    if(cachestat_read_file(filename, 1) < 0 || cachestat_read_file(filename, 2) < 0)
+    {
+        return -1;
+    }
+
+    crosos_disk_cache_stats(&stats);
+    cachestat_print(&stats);
+    return 0;
+}
@@ -0,0 +1,61 @@
+#include "crosos.h"
+#include "stdlib.h"
+#include "stdio.h"
+#include "memory.h"
+#include "string.h"
+
+#define DENTRYSTAT_DEFAULT_PATH "0:/blank.elf"
+#define DENTRYSTAT_MISSING_PATH "0:/nofile.txt"
+#define DENTRYSTAT_OPENS 10
+
+//Opens a path several times and prints the directory entry cache hits and misses the opens caused
+static int dentrystat_open(int drive, const char* path)
+{
+    struct crosos_dentry_stats before;
+    struct crosos_dentry_stats after;
+    if(crosos_dentry_stats(drive, &before) < 0)
+    {
+        return -1;
+    }
+
+    int found = 0;
+    for(int i = 0; i < DENTRYSTAT_OPENS; i++)
+    {
+        int fd = crosos_fopen(path, "r");
+        if(fd)
+        {
+            found++;
+            crosos_fclose(fd);
+        }
+    }
+
+    crosos_dentry_stats(drive, &after);
+    printf("  %s, %i opens, %i found: %i hits (%i negative), %i misses\n", path, DENTRYSTAT_OPENS, found,
+        after.hits - before.hits, after.negative_hits - before.negative_hits, after.misses - before.misses);
+    return 0;
+}
+
+//Dumps the directory entry cache counters of the drive of a path, then opens the path and a missing file several times.
+//Only the first open of each should miss
+//Usage: dentrystat [path]
+int main(int argc, char** argv)
+{
+    const char* path = argc > 1 ? argv[1] : DENTRYSTAT_DEFAULT_PATH;
+    int drive = isdigit(path[0]) ? tonumericdigit(path[0]) : 0;
+    struct crosos_dentry_stats stats;
+    memset(&stats, 0, sizeof(stats));
+    if(crosos_dentry_stats(drive, &stats) < 0)
+    {
+        printf("Could not read the directory entry cache statistics of drive %i\n", drive);
+        return -1;
+    }
+
+    printf("Directory entry cache of drive %i\n", drive);
+    printf("  hits: %i negative hits: %i misses: %i evictions: %i\n", stats.hits, stats.negative_hits, stats.misses, stats.evictions);
+    dentrystat_open(drive, path);
+    if(drive == 0)
+    {
+        dentrystat_open(drive, DENTRYSTAT_MISSING_PATH);
+    }
+    return 0;
+}
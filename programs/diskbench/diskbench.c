@@ -0,0 +1,91 @@
+#include "crosos.h"
+#include "stdlib.h"
+#include "stdio.h"
+#include "memory.h"
+#include "string.h"
+
+#define DISKBENCH_LBA 0
+#define DISKBENCH_SECTORS 1024 // 512KB, the largest raw run of the kernel
+#define DISKBENCH_RUNS 3
+
+//Sectors per request of every run: a 4KB page, a 64KB transfer, and the whole run at once
+static const unsigned int diskbench_requests[DISKBENCH_RUNS] = {8, 128, DISKBENCH_SECTORS};
+
+//Times a raw run of a drive. Returns the thousands of cycles it took, 0 on error
+static unsigned int diskbench_run(int drive, bool write, unsigned int sectors_per_request)
+{
+    struct crosos_disk_benchmark bench;
+    memset(&bench, 0, sizeof(bench));
+    bench.drive = drive;
+    bench.write = write;
+    bench.lba = DISKBENCH_LBA;
+    bench.total = DISKBENCH_SECTORS;
+    bench.sectors_per_request = sectors_per_request;
+    return crosos_disk_benchmark(&bench) < 0 ? 0 : bench.kcycles;
+}
+
+//Prints a number right aligned in 'width' characters
+static void diskbench_print_number(unsigned int value, int width)
+{
+    int digits = 1;
+    for(unsigned int rest = value / 10; rest; rest /= 10)
+    {
+        digits++;
+    }
+    while(width-- > digits)
+    {
+        putchar(' ');
+    }
+    printf("%i", value);
+}
+
+//Prints a throughput in KB per million (1024 * 1024) cycles, or a dash for a run that failed
+static void diskbench_print(unsigned int kcycles)
+{
+    if(kcycles == 0)
+    {
+        printf("        -");
+        return;
+    }
+    diskbench_print_number((DISKBENCH_SECTORS / 2) * 1024 / kcycles, 9);
+}
+
+//Reads a drive number, or the default if the text is not a single digit
+static int diskbench_drive(int argc, char** argv, int index, int fallback)
+{
+    if(argc <= index || strlen(argv[index]) != 1 || !isdigit(argv[index][0]))
+    {
+        return fallback;
+    }
+    return tonumericdigit(argv[index][0]);
+}
+
+//Compares the raw throughput of two drives holding the same image, for example the IDE disk and a virtio-blk copy of it.
+//Writes put back the contents just read. They show a dash on a read only drive, or unless the kernel is built with
+//CROSOS_DISK_BENCHMARK_WRITES
+//Usage: diskbench [drive] [drive]
+int main(int argc, char** argv)
+{
+    int drives[2];
+    drives[0] = diskbench_drive(argc, argv, 1, 0);
+    drives[1] = diskbench_drive(argc, argv, 2, 1);
+
+    printf("Raw transfers of %i KB, KB per Mcycle (1024 * 1024 cycles)\n", DISKBENCH_SECTORS / 2);
+    printf("                            drive %i  drive %i\n", drives[0], drives[1]);
+    for(int write = 0; write <= 1; write++)
+    {
+        for(int run = 0; run < DISKBENCH_RUNS; run++)
+        {
+            printf(write ? "write" : "read ");
+            diskbench_print_number(diskbench_requests[run], 5);
+            printf(" sectors/request");
+
+            for(int d = 0; d < 2; d++)
+            {
+                diskbench_print(diskbench_run(drives[d], write, diskbench_requests[run]));
+            }
+            printf("\n");
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include "crosos.h"
+#include "stdlib.h"
+#include "stdio.h"
+#include "memory.h"
+#include "string.h"
+
+#define FILETEST_PATH "0:/filetest.txt"
+#define FILETEST_LARGE_SIZE 20000 // Spans several clusters and several kernel copy buffers
+
+static int failures = 0;
+
+//Prints the result of a check
+static void filetest_check(const char* name, bool ok)
+{
+    printf("  %s: %s\n", name, ok ? "ok" : "FAILED");
+    if(!ok)
+    {
+        failures++;
+    }
+}
+
+//Reads the whole file back and compares it with 'expected'
+static bool filetest_read_back(const char* expected, int size)
+{
+    int fd = crosos_fopen(FILETEST_PATH, "r");
+    if(!fd)
+    {
+        return false;
+    }
+
+    bool ok = false;
+    struct crosos_file_stat stat;
+    char* buffer = malloc(size + 1);
+    if(buffer && crosos_fstat(fd, &stat) == 0 && (int) stat.filesize == size)
+    {
+        ok = size == 0 || (crosos_fread(buffer, size, 1, fd) == 1 && memcmp(buffer, (void*) expected, size) == 0);
+    }
+
+    free(buffer);
+    crosos_fclose(fd);
+    return ok;
+}
+
+//Writes 'size' bytes to the file opened with 'mode' and closes it
+static bool filetest_write(const char* mode, const char* data, int size)
+{
+    int fd = crosos_fopen(FILETEST_PATH, mode);
+    if(!fd)
+    {
+        return false;
+    }
+
+    bool ok = crosos_fwrite(data, size, 1, fd) == 1;
+    return crosos_fclose(fd) == 0 && ok;
+}
+
+//Creates, syncs, appends, truncates and extends a file through the system calls, reading it back after each step
+int main(int argc, char** argv)
+{
+    printf("File write test on %s\n", FILETEST_PATH);
+
+    const char* first = "First line of the log\n";
+    const char* second = "Second line, appended\n";
+    char both[64];
+    strcpy(both, first);
+    strcpy(both + strlen(first), second);
+
+    filetest_check("create", filetest_write("w", first, strlen(first)));
+    filetest_check("sync", crosos_sync() == 0);
+    filetest_check("read back", filetest_read_back(first, strlen(first)));
+    filetest_check("append", filetest_write("a", second, strlen(second)) && filetest_read_back(both, strlen(both)));
+
+    int fd = crosos_fopen(FILETEST_PATH, "a");
+    filetest_check("second writer rejected", fd && crosos_fopen(FILETEST_PATH, "w") == 0);
+    crosos_fclose(fd);
+
+    char* large = malloc(FILETEST_LARGE_SIZE);
+    if(large)
+    {
+        for(int i = 0; i < FILETEST_LARGE_SIZE; i++)
+        {
+            large[i] = 'a' + (i % 26);
+        }
+        filetest_check("truncate and extend", filetest_write("w", large, FILETEST_LARGE_SIZE) && filetest_read_back(large, FILETEST_LARGE_SIZE));
+        free(large);
+    }
+
+    filetest_check("truncate", filetest_write("w", second, strlen(second)) && filetest_read_back(second, strlen(second)));
+
+    printf("%i checks failed\n", failures);
+    return failures;
+}
@@ -0,0 +1,72 @@
+#include "crosos.h"
+#include "stdlib.h"
+#include "stdio.h"
+#include "memory.h"
+#include "string.h"
+
+#define FRAMESTAT_DEFAULT_ROUNDS 1000
+#define FRAMESTAT_LARGE_KB 1024 //Must match the large block of the kernel stress test, KFRAME_CHURN_LARGE_ORDER
+
+//Reads a decimal number, 0 if the text is not one
+static unsigned int framestat_parse(const char* text)
+{
+    unsigned int value = 0;
+    for(; *text; text++)
+    {
+        if(!isdigit(*text))
+        {
+            return 0;
+        }
+        value = value * 10 + tonumericdigit(*text);
+    }
+    return value;
+}
+
+//Prints the usage and fragmentation of the kernel page frame pool
+static int framestat_print()
+{
+    struct crosos_frame_stats stats;
+    memset(&stats, 0, sizeof(stats));
+    if(crosos_frame_stats(&stats) < 0)
+    {
+        printf("Could not read the page frame statistics\n");
+        return -1;
+    }
+
+    printf("Page frames (pages of 4096 bytes)\n");
+    printf("  total: %i free: %i used: %i\n", stats.total_pages, stats.free_pages, stats.total_pages - stats.free_pages);
+    printf("  largest free block: %i fragmentation: %i%%\n", stats.largest_free_pages, stats.fragmentation);
+    printf("  allocations: %i frees: %i failed: %i\n", stats.allocations, stats.frees, stats.failed_allocations);
+    printf("  free blocks by order:");
+    for(int order = 0; order <= CROSOS_FRAME_MAX_ORDER; order++)
+    {
+        printf(" %i", stats.free_blocks[order]);
+    }
+    printf("\n");
+    return 0;
+}
+
+//Dumps the page frame counters, then churns the pool and tells how many large allocations still succeeded
+//Usage: framestat [rounds]
+int main(int argc, char** argv)
+{
+    unsigned int rounds = argc > 1 ? framestat_parse(argv[1]) : FRAMESTAT_DEFAULT_ROUNDS;
+    if(framestat_print() < 0)
+    {
+        return -1;
+    }
+
+    struct crosos_frame_churn_result result;
+    memset(&result, 0, sizeof(result));
+    if(crosos_frame_churn(rounds, &result) < 0)
+    {
+        printf("Could not run the stress test, rounds must be 1 to 100000\n");
+        return -1;
+    }
+
+    printf("Stress test, %i rounds\n", result.rounds);
+    printf("  %i KB allocations: %i succeeded, %i failed\n", FRAMESTAT_LARGE_KB, result.large_successes, result.rounds - result.large_successes);
+    printf("  small allocations failed: %i\n", result.small_failures);
+    printf("  peak fragmentation: %i%% after the test: %i%%\n", result.peak_fragmentation, result.end_fragmentation);
+    return framestat_print();
+}
@@ -0,0 +1,28 @@
+#include "crosos.h"
+#include "stdlib.h"
+#include "stdio.h"
+#include "memory.h"
+
+#define HEAPSTAT_BLOCK_SIZE 4096 //Must match CROSOS_HEAP_BLOCK_SIZE
+
+//Dumps the kernel heap counters
+int main(int argc, char** argv)
+{
+    struct crosos_heap_stats stats;
+    memset(&stats, 0, sizeof(stats));
+    if(crosos_heap_stats(&stats) < 0)
+    {
+        printf("Could not read the kernel heap statistics\n");
+        return -1;
+    }
+
+    printf("Kernel heap (blocks of %i bytes)\n", HEAPSTAT_BLOCK_SIZE);
+    printf("  total: %i used: %i free: %i\n", stats.total_blocks, stats.used_blocks, stats.free_blocks);
+    printf("  peak used: %i\n", stats.peak_used_blocks);
+    printf("  largest free run: %i\n", stats.largest_free_blocks);
+    printf("  allocations: %i frees: %i failed: %i\n", stats.allocations, stats.frees, stats.failed_allocations);
+    printf("  live allocations: %i\n", stats.allocations - stats.frees);
+    printf("  KB requested: %i KB given: %i\n", stats.bytes_requested / 1024, stats.blocks_allocated * (HEAPSTAT_BLOCK_SIZE / 1024));
+
+    return 0;
+}
@@ -0,0 +1,159 @@
+#include "crosos.h"
+#include "stdlib.h"
+#include "stdio.h"
+#include "memory.h"
+#include "string.h"
+#include "cycles.h"
+
+#define LOADBENCH_DATA_PATH "0:/ldbench1.dat"
+#define LOADBENCH_EVICT_PATH "0:/ldbench2.dat"
+#define LOADBENCH_DEFAULT_ELF "0:/shell.elf"
+#define LOADBENCH_FILE_SIZE 786432 // Larger than the kernel sector cache (512KB), reading one file evicts the other
+#define LOADBENCH_CHUNK_SIZE 4096
+
+//Returns the cycles since 'start' in thousands. Divides by 1024, a shift, 64 bit divisions are not available
+static unsigned int loadbench_kcycles(unsigned long long start)
+{
+    return (unsigned int) ((crosos_read_cycles() - start) >> 10);
+}
+
+//Creates a data file of LOADBENCH_FILE_SIZE bytes, unless it is already there
+static int loadbench_create(const char* path, char* chunk)
+{
+    struct crosos_file_stat stat;
+    int fd = crosos_fopen(path, "r");
+    if(fd)
+    {
+        bool ready = crosos_fstat(fd, &stat) == 0 && stat.filesize == LOADBENCH_FILE_SIZE;
+        crosos_fclose(fd);
+        if(ready)
+        {
+            return 0;
+        }
+    }
+
+    fd = crosos_fopen(path, "w");
+    if(!fd)
+    {
+        return -1;
+    }
+
+    int res = 0;
+    for(int i = 0; i < LOADBENCH_FILE_SIZE / LOADBENCH_CHUNK_SIZE && res == 0; i++)
+    {
+        memset(chunk, 'a' + (i % 26), LOADBENCH_CHUNK_SIZE);
+        res = crosos_fwrite(chunk, LOADBENCH_CHUNK_SIZE, 1, fd) == 1 ? 0 : -1;
+    }
+    if(crosos_fclose(fd) < 0)
+    {
+        res = -1;
+    }
+    return res;
+}
+
+//Reads a whole file in chunks, from the start or from the end backwards. Returns the thousands of cycles it took, 0 on error
+//Backward reads move the position every time, so the file system does not see a sequential pattern and reads no sector ahead
+static unsigned int loadbench_read(const char* path, char* chunk, bool backward)
+{
+    unsigned long long start = crosos_read_cycles();
+    int fd = crosos_fopen(path, "r");
+    if(!fd)
+    {
+        return 0;
+    }
+
+    int res = 0;
+    int chunks = LOADBENCH_FILE_SIZE / LOADBENCH_CHUNK_SIZE;
+    for(int i = 0; i < chunks && res == 0; i++)
+    {
+        int index = backward ? chunks - 1 - i : i;
+        if(backward)
+        {
+            res = crosos_fseek(fd, index * LOADBENCH_CHUNK_SIZE, CROSOS_SEEK_SET);
+        }
+        if(res == 0)
+        {
+            res = crosos_fread(chunk, LOADBENCH_CHUNK_SIZE, 1, fd) == 1 ? 0 : -1;
+        }
+    }
+    crosos_fclose(fd);
+    return res == 0 ? loadbench_kcycles(start) : 0;
+}
+
+//Opens a program and reads it whole, like the kernel does to load it. Returns the thousands of cycles it took, 0 on error
+static unsigned int loadbench_load(const char* path, unsigned int* size)
+{
+    unsigned long long start = crosos_read_cycles();
+    int fd = crosos_fopen(path, "r");
+    if(!fd)
+    {
+        return 0;
+    }
+
+    unsigned int kcycles = 0;
+    struct crosos_file_stat stat;
+    char* image = 0;
+    if(crosos_fstat(fd, &stat) == 0 && stat.filesize > 0)
+    {
+        image = malloc(stat.filesize);
+    }
+    if(image && crosos_fread(image, stat.filesize, 1, fd) == 1)
+    {
+        *size = stat.filesize;
+        kcycles = loadbench_kcycles(start);
+    }
+    free(image);
+    crosos_fclose(fd);
+    return kcycles;
+}
+
+//Prints a result, or that the run failed
+static void loadbench_print(const char* name, unsigned int kcycles)
+{
+    if(kcycles == 0)
+    {
+        printf("  %s: failed\n", name);
+        return;
+    }
+    printf("  %s: %i kcycles\n", name, kcycles);
+}
+
+//Times cold and warm loads of a program and of a data file. The sector cache is emptied of a file by reading another one
+//larger than the cache. Sequential reads are helped by read-ahead, backward reads of the same sectors are not
+//Usage: loadbench [program]
+int main(int argc, char** argv)
+{
+    const char* elf_path = argc > 1 ? argv[1] : LOADBENCH_DEFAULT_ELF;
+    char* chunk = malloc(LOADBENCH_CHUNK_SIZE);
+    if(!chunk)
+    {
+        printf("Out of memory\n");
+        return -1;
+    }
+
+    printf("Creating the data files\n");
+    if(loadbench_create(LOADBENCH_DATA_PATH, chunk) < 0 || loadbench_create(LOADBENCH_EVICT_PATH, chunk) < 0 || crosos_sync() < 0)
+    {
+        printf("Could not create the data files\n");
+        free(chunk);
+        return -1;
+    }
+
+    unsigned int size = 0;
+    printf("Sequential loads, kcycles are 1024 cycles\n");
+    loadbench_read(LOADBENCH_EVICT_PATH, chunk, false);
+    unsigned int cold = loadbench_load(elf_path, &size);
+    unsigned int warm = loadbench_load(elf_path, &size);
+    printf("  %s, %i bytes\n", elf_path, size);
+    loadbench_print("cold", cold);
+    loadbench_print("warm", warm);
+
+    printf("  %s, %i bytes in chunks of %i\n", LOADBENCH_DATA_PATH, LOADBENCH_FILE_SIZE, LOADBENCH_CHUNK_SIZE);
+    loadbench_read(LOADBENCH_EVICT_PATH, chunk, false);
+    loadbench_print("cold forward, read ahead", loadbench_read(LOADBENCH_DATA_PATH, chunk, false));
+    loadbench_read(LOADBENCH_EVICT_PATH, chunk, false);
+    loadbench_print("cold backward, no read ahead", loadbench_read(LOADBENCH_DATA_PATH, chunk, true));
+
+    free(chunk);
+    return 0;
+}
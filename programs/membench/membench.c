@@ -0,0 +1,187 @@
+#include "crosos.h"
+#include "stdlib.h"
+#include "stdio.h"
+#include "memory.h"
+#include "string.h"
+#include "cycles.h"
+
+#define MEMBENCH_MAX_SIZE 65536 // Must not be over the kernel MEMORY_BENCHMARK_MAX_SIZE
+#define MEMBENCH_ALIGN 64
+#define MEMBENCH_BYTES_PER_RUN 1048576 // Every size moves about this much, so the runs take a similar time
+#define MEMBENCH_MAX_ITERATIONS 65536
+#define MEMBENCH_VARIANTS 5
+
+static const unsigned int membench_sizes[] = {16, 64, 256, 4096, 65536};
+static const char* membench_ops[] = {"copy", "set", "cmp"};
+
+//User land byte loops, the baseline the word versions of the stdlib are measured against
+static void membench_copy_bytes(char* dest, char* src, int size)
+{
+    while(size-- > 0)
+    {
+        *dest++ = *src++;
+    }
+}
+
+static void membench_set_bytes(char* dest, int c, int size)
+{
+    while(size-- > 0)
+    {
+        *dest++ = (char) c;
+    }
+}
+
+static int membench_compare_bytes(char* s1, char* s2, int size)
+{
+    while(size-- > 0)
+    {
+        if(*s1++ != *s2++)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+//Times a user land version, the byte loops or the stdlib word versions. Returns the cycles
+static unsigned int membench_user(int op, bool words, char* dest, char* src, unsigned int size, unsigned int iterations)
+{
+    memcpy(dest, src, size); //Same contents, so the compares go through the whole size
+    unsigned int start = crosos_read_cycles();
+    for(unsigned int i = 0; i < iterations; i++)
+    {
+        if(op == CROSOS_MEMORY_OP_COPY && words)
+        {
+            memcpy(dest, src, size);
+        }
+        else if(op == CROSOS_MEMORY_OP_COPY)
+        {
+            membench_copy_bytes(dest, src, size);
+        }
+        else if(op == CROSOS_MEMORY_OP_SET && words)
+        {
+            memset(dest, i, size);
+        }
+        else if(op == CROSOS_MEMORY_OP_SET)
+        {
+            membench_set_bytes(dest, i, size);
+        }
+        else if(words)
+        {
+            memcmp(dest, src, size);
+        }
+        else
+        {
+            membench_compare_bytes(dest, src, size);
+        }
+    }
+    return crosos_read_cycles() - start;
+}
+
+//Times a version of the kernel memory functions on kernel buffers. Returns the cycles, 0 if the kernel does not have that version
+static unsigned int membench_kernel(int op, int variant, unsigned int dest_offset, unsigned int src_offset, unsigned int size, unsigned int iterations)
+{
+    struct crosos_memory_benchmark bench;
+    memset(&bench, 0, sizeof(bench));
+    bench.op = op;
+    bench.variant = variant;
+    bench.size = size;
+    bench.dest_offset = dest_offset;
+    bench.src_offset = src_offset;
+    bench.iterations = iterations;
+    return crosos_memory_benchmark(&bench) < 0 ? 0 : bench.cycles;
+}
+
+//Prints a number right aligned in 'width' characters
+static void membench_print_number(unsigned int value, int width)
+{
+    int digits = 1;
+    for(unsigned int rest = value / 10; rest; rest /= 10)
+    {
+        digits++;
+    }
+    while(width-- > digits)
+    {
+        putchar(' ');
+    }
+    printf("%i", value);
+}
+
+//Prints bytes per cycle with two decimals, or a dash for a version that did not run
+static void membench_print_rate(unsigned int bytes, unsigned int cycles)
+{
+    if(cycles == 0)
+    {
+        printf("       -");
+        return;
+    }
+
+    unsigned int rate = bytes * 100 / cycles; //A run moves at most about 1MB, the product fits in 32 bits
+    membench_print_number(rate / 100, 5);
+    printf(".%i%i", (rate / 10) % 10, rate % 10);
+}
+
+//Reports the bytes per cycle of every version of memcpy, memset and memcmp across sizes, with aligned and unaligned buffers
+//Usage: membench [copy|set|cmp]
+int main(int argc, char** argv)
+{
+    char* dest_memory = malloc(MEMBENCH_MAX_SIZE + MEMBENCH_ALIGN * 2);
+    char* src_memory = malloc(MEMBENCH_MAX_SIZE + MEMBENCH_ALIGN * 2);
+    if(!dest_memory || !src_memory)
+    {
+        printf("Out of memory\n");
+        return -1;
+    }
+
+    //The offsets are relative to a 64 byte boundary, like the kernel buffers that start on a page
+    char* dest_base = (char*) (((unsigned int) dest_memory + MEMBENCH_ALIGN - 1) & ~(MEMBENCH_ALIGN - 1));
+    char* src_base = (char*) (((unsigned int) src_memory + MEMBENCH_ALIGN - 1) & ~(MEMBENCH_ALIGN - 1));
+    memset(src_base, 0x5A, MEMBENCH_MAX_SIZE + MEMBENCH_ALIGN);
+
+    printf("Bytes per cycle. Unaligned runs use destination +1, source +3\n");
+    printf("op    size al  user-b  user-w  kern-b  kern-w  kern-sse2\n");
+    for(int op = CROSOS_MEMORY_OP_COPY; op <= CROSOS_MEMORY_OP_COMPARE; op++)
+    {
+        if(argc > 1 && strncmp(argv[1], membench_ops[op], 5) != 0)
+        {
+            continue;
+        }
+
+        for(int s = 0; s < (int) (sizeof(membench_sizes) / sizeof(membench_sizes[0])); s++)
+        {
+            unsigned int size = membench_sizes[s];
+            unsigned int iterations = MEMBENCH_BYTES_PER_RUN / size;
+            if(iterations > MEMBENCH_MAX_ITERATIONS)
+            {
+                iterations = MEMBENCH_MAX_ITERATIONS;
+            }
+
+            for(int unaligned = 0; unaligned <= 1; unaligned++)
+            {
+                unsigned int dest_offset = unaligned ? 1 : 0;
+                unsigned int src_offset = unaligned ? 3 : 0;
+                char* dest = dest_base + dest_offset;
+                char* src = src_base + src_offset;
+                unsigned int cycles[MEMBENCH_VARIANTS];
+                cycles[0] = membench_user(op, false, dest, src, size, iterations);
+                cycles[1] = membench_user(op, true, dest, src, size, iterations);
+                cycles[2] = membench_kernel(op, CROSOS_MEMORY_VARIANT_BYTES, dest_offset, src_offset, size, iterations);
+                cycles[3] = membench_kernel(op, CROSOS_MEMORY_VARIANT_DWORDS, dest_offset, src_offset, size, iterations);
+                cycles[4] = membench_kernel(op, CROSOS_MEMORY_VARIANT_SSE2, dest_offset, src_offset, size, iterations);
+
+                printf("%s", membench_ops[op]);
+                membench_print_number(size, 10 - strlen(membench_ops[op]));
+                printf(unaligned ? "  u" : "  a");
+                for(int v = 0; v < MEMBENCH_VARIANTS; v++)
+                {
+                    membench_print_rate(size * iterations, cycles[v]);
+                }
+                printf("\n");
+            }
+        }
+    }
+
+    free(dest_memory);
+    free(src_memory);
+    return 0;
+}
@@ -13,6 +13,21 @@ global crosos_process_load_start:function
 global crosos_system:function
 global crosos_process_get_arguments:function
 global crosos_exit:function
+global crosos_sbrk:function
+global crosos_heap_stats:function
+global crosos_sync:function
+global crosos_fopen:function
+global crosos_fread:function
+global crosos_fwrite:function
+global crosos_fseek:function
+global crosos_fstat:function
+global crosos_fclose:function
+global crosos_frame_stats:function
+global crosos_frame_churn:function
+global crosos_disk_cache_stats:function
+global crosos_dentry_stats:function
+global crosos_memory_benchmark:function
+global crosos_disk_benchmark:function
 
 ; void print (const char* message)
 print:
@@ -107,4 +122,179 @@ crosos_exit:
     mov eax, 9 ; Cmd exit current process
     int 0x80
     pop ebp
-    ret
\ No newline at end of file
+    ret
+
+; void* crosos_sbrk(int increment)
+crosos_sbrk:
+    push ebp
+    mov ebp, esp
+    mov eax, 10 ; Cmd move the heap break
+    push dword[ebp+8] ; Variable increment
+    int 0x80
+    add esp, 4
+    pop ebp
+    ret
+
+; int crosos_heap_stats(struct crosos_heap_stats* stats)
+crosos_heap_stats:
+    push ebp
+    mov ebp, esp
+    mov eax, 11 ; Cmd get kernel heap statistics
+    push dword[ebp+8] ; Variable stats
+    int 0x80
+    add esp, 4
+    pop ebp
+    ret
+
+; int crosos_sync()
+crosos_sync:
+    push ebp
+    mov ebp, esp
+    mov eax, 12 ; Cmd write the dirty data of the disks
+    int 0x80
+    pop ebp
+    ret
+
+; int crosos_fopen(const char* filename, const char* mode)
+crosos_fopen:
+    push ebp
+    mov ebp, esp
+    mov eax, 13 ; Cmd open a file
+    push dword[ebp+12] ; Variable mode
+    push dword[ebp+8] ; Variable filename
+    int 0x80
+    add esp, 8
+    pop ebp
+    ret
+
+; int crosos_fread(void* ptr, unsigned int size, unsigned int nmemb, int fd)
+crosos_fread:
+    push ebp
+    mov ebp, esp
+    mov eax, 14 ; Cmd read from a file
+    push dword[ebp+20] ; Variable fd
+    push dword[ebp+16] ; Variable nmemb
+    push dword[ebp+12] ; Variable size
+    push dword[ebp+8] ; Variable ptr
+    int 0x80
+    add esp, 16
+    pop ebp
+    ret
+
+; int crosos_fwrite(const void* ptr, unsigned int size, unsigned int nmemb, int fd)
+crosos_fwrite:
+    push ebp
+    mov ebp, esp
+    mov eax, 15 ; Cmd write to a file
+    push dword[ebp+20] ; Variable fd
+    push dword[ebp+16] ; Variable nmemb
+    push dword[ebp+12] ; Variable size
+    push dword[ebp+8] ; Variable ptr
+    int 0x80
+    add esp, 16
+    pop ebp
+    ret
+
+; int crosos_fseek(int fd, unsigned int offset, int whence)
+crosos_fseek:
+    push ebp
+    mov ebp, esp
+    mov eax, 16 ; Cmd move the position of a file
+    push dword[ebp+16] ; Variable whence
+    push dword[ebp+12] ; Variable offset
+    push dword[ebp+8] ; Variable fd
+    int 0x80
+    add esp, 12
+    pop ebp
+    ret
+
+; int crosos_fstat(int fd, struct crosos_file_stat* stat)
+crosos_fstat:
+    push ebp
+    mov ebp, esp
+    mov eax, 17 ; Cmd get the size and flags of a file
+    push dword[ebp+12] ; Variable stat
+    push dword[ebp+8] ; Variable fd
+    int 0x80
+    add esp, 8
+    pop ebp
+    ret
+
+; int crosos_fclose(int fd)
+crosos_fclose:
+    push ebp
+    mov ebp, esp
+    mov eax, 18 ; Cmd close a file
+    push dword[ebp+8] ; Variable fd
+    int 0x80
+    add esp, 4
+    pop ebp
+    ret
+
+; int crosos_frame_stats(struct crosos_frame_stats* stats)
+crosos_frame_stats:
+    push ebp
+    mov ebp, esp
+    mov eax, 19 ; Cmd get page frame pool statistics
+    push dword[ebp+8] ; Variable stats
+    int 0x80
+    add esp, 4
+    pop ebp
+    ret
+
+; int crosos_frame_churn(unsigned int rounds, struct crosos_frame_churn_result* result)
+crosos_frame_churn:
+    push ebp
+    mov ebp, esp
+    mov eax, 20 ; Cmd run the page frame stress test
+    push dword[ebp+12] ; Variable result
+    push dword[ebp+8] ; Variable rounds
+    int 0x80
+    add esp, 8
+    pop ebp
+    ret
+
+; int crosos_disk_cache_stats(struct crosos_disk_cache_stats* stats)
+crosos_disk_cache_stats:
+    push ebp
+    mov ebp, esp
+    mov eax, 21 ; Cmd get disk block cache statistics
+    push dword[ebp+8] ; Variable stats
+    int 0x80
+    add esp, 4
+    pop ebp
+    ret
+
+; int crosos_dentry_stats(int drive, struct crosos_dentry_stats* stats)
+crosos_dentry_stats:
+    push ebp
+    mov ebp, esp
+    mov eax, 22 ; Cmd get directory entry cache statistics of a disk
+    push dword[ebp+12] ; Variable stats
+    push dword[ebp+8] ; Variable drive
+    int 0x80
+    add esp, 8
+    pop ebp
+    ret
+
+; int crosos_memory_benchmark(struct crosos_memory_benchmark* bench)
+crosos_memory_benchmark:
+    push ebp
+    mov ebp, esp
+    mov eax, 23 ; Cmd time a kernel memory function
+    push dword[ebp+8] ; Variable bench
+    int 0x80
+    add esp, 4
+    pop ebp
+    ret
+
+; int crosos_disk_benchmark(struct crosos_disk_benchmark* bench)
+crosos_disk_benchmark:
+    push ebp
+    mov ebp, esp
+    mov eax, 24 ; Cmd time raw transfers of a disk
+    push dword[ebp+8] ; Variable bench
+    int 0x80
+    add esp, 4
+    pop ebp
+    ret
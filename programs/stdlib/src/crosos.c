@@ -1,5 +1,6 @@
 #include "crosos.h"
 #include "string.h"
+#include "stdlib.h"
 
 //Returns a command argument that linked with the following parameters of the command to handle calls to programs with parameters
 struct command_argument* crosos_parse_command(const char* command, int max)
@@ -18,7 +19,7 @@ struct command_argument* crosos_parse_command(const char* command, int max)
         goto out;
     }
 
-    root_command = crosos_malloc(sizeof(struct command_argument)); //Allocates the root command
+    root_command = malloc(sizeof(struct command_argument)); //Allocates the root command
     if(!root_command)
     {
         goto out;
@@ -31,7 +32,7 @@ struct command_argument* crosos_parse_command(const char* command, int max)
     token = strtok(NULL, " "); //Get next chunk
     while(token != 0)
     {
-        struct command_argument* new_command = crosos_malloc(sizeof(new_command->argument)); //Allocate new parameter
+        struct command_argument* new_command = malloc(sizeof(struct command_argument)); //Allocate new parameter
         if(!new_command)
         {
             break;
@@ -15,6 +15,111 @@ struct process_arguments
     char** argv;
 };
 
+//Same layout as the kernel 'struct heap_stats'. Sizes are in heap blocks unless said otherwise
+struct crosos_heap_stats
+{
+    unsigned int total_blocks;
+    unsigned int used_blocks;
+    unsigned int free_blocks;
+    unsigned int peak_used_blocks;
+    unsigned int largest_free_blocks;
+    unsigned int allocations;
+    unsigned int frees;
+    unsigned int failed_allocations;
+    unsigned int bytes_requested;
+    unsigned int blocks_allocated;
+};
+
+#define CROSOS_FRAME_MAX_ORDER 12 //Must match BUDDY_MAX_ORDER
+
+//Same layout as the kernel 'struct buddy_stats'. Sizes are in pages of 4096 bytes
+struct crosos_frame_stats
+{
+    unsigned int total_pages;
+    unsigned int free_pages;
+    unsigned int free_blocks[CROSOS_FRAME_MAX_ORDER + 1]; //Free blocks of every order, a block of order n has 2^n pages
+    unsigned int largest_free_pages;
+    unsigned int fragmentation; //Percentage of free pages that are not part of the largest free block
+    unsigned int allocations;
+    unsigned int frees;
+    unsigned int failed_allocations;
+};
+
+//Same layout as the kernel 'struct kframe_churn_result'
+struct crosos_frame_churn_result
+{
+    unsigned int rounds;
+    unsigned int small_failures;
+    unsigned int large_successes;
+    unsigned int peak_fragmentation;
+    unsigned int end_fragmentation;
+};
+
+//Same layout as the kernel 'struct disk_cache_stats'. Counts are in sectors
+struct crosos_disk_cache_stats
+{
+    unsigned int total_entries;
+    unsigned int used_entries;
+    unsigned int hits;
+    unsigned int misses;
+    unsigned int evictions;
+    unsigned int prefetched;
+    unsigned int dirty_entries;
+    unsigned int writebacks;
+};
+
+//Same layout as the kernel 'struct fat16_dentry_stats'
+struct crosos_dentry_stats
+{
+    unsigned int hits;
+    unsigned int negative_hits; //Hits that answered that the name does not exist
+    unsigned int misses;
+    unsigned int evictions;
+};
+
+//Versions and operations of the kernel memory functions, the same values as in the kernel memory.h
+#define CROSOS_MEMORY_VARIANT_BYTES 0
+#define CROSOS_MEMORY_VARIANT_DWORDS 1
+#define CROSOS_MEMORY_VARIANT_SSE2 2
+#define CROSOS_MEMORY_OP_COPY 0
+#define CROSOS_MEMORY_OP_SET 1
+#define CROSOS_MEMORY_OP_COMPARE 2
+
+//Same layout as the kernel 'struct memory_benchmark'
+struct crosos_memory_benchmark
+{
+    unsigned int op;
+    unsigned int variant;
+    unsigned int size; //Up to 65536
+    unsigned int dest_offset; //Below 64
+    unsigned int src_offset;
+    unsigned int iterations; //Up to 65536
+    unsigned int cycles;
+};
+
+//Same layout as the kernel 'struct disk_benchmark'
+struct crosos_disk_benchmark
+{
+    unsigned int drive;
+    unsigned int write; //Not 0 to write back the sectors instead of reading them. Fails unless the kernel is built with CROSOS_DISK_BENCHMARK_WRITES
+    unsigned int lba;
+    unsigned int total; //Sectors, up to 1024
+    unsigned int sectors_per_request;
+    unsigned int kcycles; //Thousands (1024) of cycles
+};
+
+//Same layout as the kernel 'struct file_stat'
+struct crosos_file_stat
+{
+    unsigned int flags;
+    unsigned int filesize;
+    unsigned int id;
+};
+
+#define CROSOS_SEEK_SET 0
+#define CROSOS_SEEK_CUR 1
+#define CROSOS_FILE_STAT_READ_ONLY 0x01
+
 void print(const char* message);
 int crosos_getkey();
 void* crosos_malloc(size_t size);
@@ -28,5 +133,20 @@ int crosos_system(struct command_argument* arguments);
 void crosos_process_get_arguments(struct process_arguments* arguments);
 int crosos_system_run(const char* command);
 void crosos_exit();
+void* crosos_sbrk(int increment);
+int crosos_heap_stats(struct crosos_heap_stats* stats);
+int crosos_sync();
+int crosos_fopen(const char* filename, const char* mode);
+int crosos_fread(void* ptr, unsigned int size, unsigned int nmemb, int fd);
+int crosos_fwrite(const void* ptr, unsigned int size, unsigned int nmemb, int fd);
+int crosos_fseek(int fd, unsigned int offset, int whence);
+int crosos_fstat(int fd, struct crosos_file_stat* stat);
+int crosos_fclose(int fd);
+int crosos_frame_stats(struct crosos_frame_stats* stats);
+int crosos_frame_churn(unsigned int rounds, struct crosos_frame_churn_result* result);
+int crosos_disk_cache_stats(struct crosos_disk_cache_stats* stats);
+int crosos_dentry_stats(int drive, struct crosos_dentry_stats* stats);
+int crosos_memory_benchmark(struct crosos_memory_benchmark* bench);
+int crosos_disk_benchmark(struct crosos_disk_benchmark* bench);
 
 #endif
\ No newline at end of file
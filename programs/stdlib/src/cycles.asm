@@ -0,0 +1,11 @@
+[BITS 32]
+
+section .asm
+
+global crosos_read_cycles:function
+
+; unsigned long long crosos_read_cycles()
+; Returns the time stamp counter. rdtsc leaves it in edx:eax, where a 64 bit value is returned
+crosos_read_cycles:
+    rdtsc
+    ret
@@ -0,0 +1,6 @@
+#ifndef CROSOS_CYCLES_H
+#define CROSOS_CYCLES_H
+
+unsigned long long crosos_read_cycles();
+
+#endif
@@ -0,0 +1,36 @@
+[BITS 32]
+
+section .asm
+
+global memory_copy_dwords:function
+global memory_set_dwords:function
+
+; void memory_copy_dwords(void* dest, void* src, int count)
+memory_copy_dwords:
+    push ebp
+    mov ebp, esp
+    push edi
+    push esi
+    mov edi, [ebp+8] ; destination
+    mov esi, [ebp+12] ; source
+    mov ecx, [ebp+16] ; number of 4 byte words
+    cld ; copy forward
+    rep movsd
+    pop esi
+    pop edi
+    pop ebp
+    ret
+
+; void memory_set_dwords(void* dest, int value, int count)
+memory_set_dwords:
+    push ebp
+    mov ebp, esp
+    push edi
+    mov edi, [ebp+8] ; destination
+    mov eax, [ebp+12] ; value repeated on every word
+    mov ecx, [ebp+16] ; number of 4 byte words
+    cld
+    rep stosd
+    pop edi
+    pop ebp
+    ret
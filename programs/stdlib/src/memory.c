@@ -1,12 +1,29 @@
 #include "memory.h"
+#include <stdint.h>
+
+//Calls to ASM code
+//There is no SSE version in user land, the kernel does not save the SSE registers on task switches
+extern void memory_copy_dwords(void* dest, void* src, int count);
+extern void memory_set_dwords(void* dest, int value, int count);
 
 //Allocates the 'c' parameter on the values pointed by 'ptr', and the pointer increments 'size' times
 void* memset(void* ptr, int c, size_t size)
 {
-    char* c_ptr = (char*) ptr;
-    for(int i = 0; i < size; i++)
+    uint8_t* d = ptr;
+    while(size && ((uint32_t) d & (sizeof(uint32_t) - 1))) //Bytes until the destination is aligned
+    {
+        *d++ = (uint8_t) c;
+        size--;
+    }
+
+    uint32_t words = size / sizeof(uint32_t);
+    memory_set_dwords(d, (uint8_t) c * 0x01010101, words); //The byte repeated on a whole word
+    d += words * sizeof(uint32_t);
+    size -= words * sizeof(uint32_t);
+
+    while(size--) //Remaining tail
     {
-        c_ptr[i] = (char) c;
+        *d++ = (uint8_t) c;
     }
     return ptr;
 }
@@ -16,6 +33,28 @@ int memcmp(void* s1, void* s2, int count)
 {
     char* c1 = s1;
     char* c2 = s2;
+    if((((uint32_t) c1 ^ (uint32_t) c2) & (sizeof(uint32_t) - 1)) == 0)
+    {
+        //Same alignment, compare whole words until the first difference
+        while(count > 0 && ((uint32_t) c1 & (sizeof(uint32_t) - 1)))
+        {
+            if(*c1 != *c2)
+            {
+                return *c1 < *c2 ? -1:1;
+            }
+            c1++;
+            c2++;
+            count--;
+        }
+
+        while(count >= (int) sizeof(uint32_t) && *(uint32_t*) c1 == *(uint32_t*) c2)
+        {
+            c1 += sizeof(uint32_t);
+            c2 += sizeof(uint32_t);
+            count -= sizeof(uint32_t);
+        }
+    }
+
     while(count-- > 0)
     {
         if(*c1++ != *c2++)
@@ -30,11 +69,26 @@ int memcmp(void* s1, void* s2, int count)
 //Copies 'len' address contents from 'src' to 'dest'
 void* memcpy(void* dest, void* src, int len)
 {
-    char *d = dest;
-    char* s = src;
-    while(len--)
+    uint8_t* d = dest;
+    uint8_t* s = src;
+    while(len > 0 && ((uint32_t) d & (sizeof(uint32_t) - 1))) //Bytes until the destination is aligned
+    {
+        *d++ = *s++;
+        len--;
+    }
+
+    if(len > 0)
+    {
+        int words = len / sizeof(uint32_t);
+        memory_copy_dwords(d, s, words);
+        d += words * sizeof(uint32_t);
+        s += words * sizeof(uint32_t);
+        len -= words * sizeof(uint32_t);
+    }
+
+    while(len-- > 0) //Remaining tail
     {
         *d++ = *s++;
     }
     return dest;
-}
\ No newline at end of file
+}
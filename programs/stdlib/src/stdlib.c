@@ -1,5 +1,30 @@
 #include "stdlib.h"
 #include "crosos.h"
+#include <stdint.h>
+
+#define STDLIB_MALLOC_MIN_CLASS_SHIFT 4 //Smallest block is 16 bytes
+#define STDLIB_MALLOC_TOTAL_CLASSES 8 //Blocks of 16, 32, ... 2048 bytes
+#define STDLIB_MALLOC_LARGE_CLASS STDLIB_MALLOC_TOTAL_CLASSES
+#define STDLIB_MALLOC_LARGE_ALIGN 4096 //Bigger blocks are rounded to pages
+#define STDLIB_MALLOC_REFILL_SIZE 65536 //Bytes asked to the kernel at once
+
+//Placed before every block handed out by malloc
+struct malloc_header
+{
+    uint32_t size; //Size of the whole block, header included
+    uint32_t class; //Size class, or STDLIB_MALLOC_LARGE_CLASS
+};
+
+//Freed blocks reuse their payload to link the free lists
+struct malloc_free_block
+{
+    struct malloc_header header;
+    struct malloc_free_block* next;
+};
+
+static struct malloc_free_block* malloc_free_lists[STDLIB_MALLOC_TOTAL_CLASSES + 1]; //Last list holds the large blocks
+static char* malloc_arena_next = 0; //Part of the arena that was never handed out
+static char* malloc_arena_end = 0;
 
 //Parses an integer to a string
 char* itoa(int i)
@@ -33,14 +58,109 @@ char* itoa(int i)
     return &text[loc]; //Return pointer to the first position of the texted number
 }
 
-//Public function call to system interrupt malloc
+//Carves a block from the arena, asking the kernel for more memory when it runs out
+static void* malloc_arena_take(size_t size)
+{
+    if(size > (size_t) (malloc_arena_end - malloc_arena_next))
+    {
+        size_t refill = size > STDLIB_MALLOC_REFILL_SIZE ? size : STDLIB_MALLOC_REFILL_SIZE;
+        char* chunk = crosos_sbrk(refill);
+        if(!chunk)
+        {
+            return 0;
+        }
+
+        if(chunk != malloc_arena_end)
+        {
+            malloc_arena_next = chunk; //Not contiguous, the rest of the old arena is lost
+        }
+        malloc_arena_end = chunk + refill;
+    }
+
+    void* block = malloc_arena_next;
+    malloc_arena_next += size;
+    return block;
+}
+
+//Returns the size class for a block of 'size' bytes, header included
+static uint32_t malloc_size_class(size_t size)
+{
+    uint32_t class = 0;
+    while(class < STDLIB_MALLOC_TOTAL_CLASSES && ((size_t) 1 << (class + STDLIB_MALLOC_MIN_CLASS_SHIFT)) < size)
+    {
+        class++;
+    }
+    return class;
+}
+
+//Allocates memory from the arena of the program. Only refilling the arena needs a system call
 void* malloc(size_t size)
-{  
-    return crosos_malloc(size);
+{
+    if(!size || size > (size_t) -1 - STDLIB_MALLOC_LARGE_ALIGN)
+    {
+        return 0;
+    }
+
+    size_t total = size + sizeof(struct malloc_header);
+    uint32_t class = malloc_size_class(total);
+    struct malloc_free_block* block = 0;
+    if(class < STDLIB_MALLOC_TOTAL_CLASSES)
+    {
+        total = (size_t) 1 << (class + STDLIB_MALLOC_MIN_CLASS_SHIFT);
+        block = malloc_free_lists[class];
+        if(block)
+        {
+            malloc_free_lists[class] = block->next; //Reuse the last freed block of the class
+        }
+    }
+    else
+    {
+        total = (total + STDLIB_MALLOC_LARGE_ALIGN - 1) & ~(STDLIB_MALLOC_LARGE_ALIGN - 1);
+
+        //First large block that is big enough
+        struct malloc_free_block** link = &malloc_free_lists[STDLIB_MALLOC_LARGE_CLASS];
+        while(*link && (*link)->header.size < total)
+        {
+            link = &(*link)->next;
+        }
+
+        block = *link;
+        if(block)
+        {
+            *link = block->next;
+            total = block->header.size; //The block is not split
+        }
+    }
+
+    if(!block)
+    {
+        block = malloc_arena_take(total);
+        if(!block)
+        {
+            return 0;
+        }
+    }
+
+    block->header.size = total;
+    block->header.class = class;
+    return (char*) block + sizeof(struct malloc_header);
 }
 
-//Public function call to system interrupt free
+//Gives a block back to the free list of its class
 void free(void* ptr)
 {
-    return crosos_free(ptr);
+    if(!ptr)
+    {
+        return;
+    }
+
+    struct malloc_free_block* block = (struct malloc_free_block*) ((char*) ptr - sizeof(struct malloc_header));
+    uint32_t class = block->header.class;
+    if(class > STDLIB_MALLOC_LARGE_CLASS)
+    {
+        return; //Not a block of malloc
+    }
+
+    block->next = malloc_free_lists[class];
+    malloc_free_lists[class] = block;
 }
\ No newline at end of file
@@ -0,0 +1,85 @@
+#include "crosos.h"
+#include "stdlib.h"
+#include "stdio.h"
+#include "memory.h"
+#include "cycles.h"
+
+#define WRITEBENCH_PATH "0:/wrbench.dat"
+#define WRITEBENCH_SIZE 524288 // 512KB, the largest raw run of the kernel
+#define WRITEBENCH_CHUNK_SIZE 4096
+#define WRITEBENCH_RAW_LBA 2048 // Raw runs rewrite the sectors from 1MB on with their own contents
+#define WRITEBENCH_SECTOR_SIZE 512
+
+//Prints the time of a run and its throughput in KB per million (1024 * 1024) cycles
+static void writebench_print(const char* name, unsigned int kcycles)
+{
+    if(kcycles == 0)
+    {
+        printf("  %s: failed\n", name);
+        return;
+    }
+    printf("  %s: %i kcycles, %i KB per Mcycle\n", name, kcycles, (WRITEBENCH_SIZE / 1024) * 1024 / kcycles);
+}
+
+//Writes the benchmark file through the file system and syncs it. Returns the thousands of cycles it took, 0 on error
+static unsigned int writebench_file(char* chunk)
+{
+    unsigned long long start = crosos_read_cycles();
+    int fd = crosos_fopen(WRITEBENCH_PATH, "w");
+    if(!fd)
+    {
+        return 0;
+    }
+
+    int res = 0;
+    for(int i = 0; i < WRITEBENCH_SIZE / WRITEBENCH_CHUNK_SIZE && res == 0; i++)
+    {
+        res = crosos_fwrite(chunk, WRITEBENCH_CHUNK_SIZE, 1, fd) == 1 ? 0 : -1;
+    }
+    if(crosos_fclose(fd) < 0 || crosos_sync() < 0)
+    {
+        res = -1;
+    }
+    return res == 0 ? (unsigned int) ((crosos_read_cycles() - start) >> 10) : 0;
+}
+
+//Writes the same amount of sectors straight to drive 0 in requests of 'sectors_per_request'. Returns the thousands of cycles, 0 on error
+//The kernel only runs it when it is built with CROSOS_DISK_BENCHMARK_WRITES
+static unsigned int writebench_raw(unsigned int sectors_per_request)
+{
+    struct crosos_disk_benchmark bench;
+    memset(&bench, 0, sizeof(bench));
+    bench.drive = 0;
+    bench.write = 1;
+    bench.lba = WRITEBENCH_RAW_LBA;
+    bench.total = WRITEBENCH_SIZE / WRITEBENCH_SECTOR_SIZE;
+    bench.sectors_per_request = sectors_per_request;
+    return crosos_disk_benchmark(&bench) < 0 ? 0 : bench.kcycles;
+}
+
+//Compares the sustained write throughput of the file system, through the write back cache, with raw PIO writes of drive 0:
+//one sector per command, like a naive write through, and 128 sectors per command
+int main(int argc, char** argv)
+{
+    char* chunk = malloc(WRITEBENCH_CHUNK_SIZE);
+    if(!chunk)
+    {
+        printf("Out of memory\n");
+        return -1;
+    }
+    memset(chunk, 'w', WRITEBENCH_CHUNK_SIZE);
+
+    printf("Writing %i KB, kcycles are 1024 cycles\n", WRITEBENCH_SIZE / 1024);
+    writebench_print("file, 4KB writes, close and sync", writebench_file(chunk));
+    unsigned int single = writebench_raw(1);
+    unsigned int batched = writebench_raw(128);
+    writebench_print("raw, 1 sector per command", single);
+    writebench_print("raw, 128 sectors per command", batched);
+    if(!single && !batched)
+    {
+        printf("Raw writes need a kernel built with CROSOS_DISK_BENCHMARK_WRITES\n");
+    }
+
+    free(chunk);
+    return 0;
+}
@@ -3,6 +3,7 @@ BITS 16 ; 16bit real mode code follows
 
 CODE_SEG equ gdt_code - gdt_start ; offset of the code segment of the GDT
 DATA_SEG equ gdt_data - gdt_start ; offset of the data segment of the GDT
+KERNEL_SECTORS equ 199 ; ReservedSectors - 1, the kernel fills the reserved sectors after the boot sector. The Makefile checks that it fits
 
 jmp short start
 nop
@@ -88,7 +89,7 @@ gdt_descriptor:
 [BITS 32]
 load32:
     mov eax, 1 ; Starting sector we wanna load from (0 is the boot sector)
-    mov ecx, 100 ; Number of sectors we want to load
+    mov ecx, KERNEL_SECTORS ; Number of sectors we want to load, one ATA command takes up to 255
     mov edi, 0x0100000 ;1MB, the address we want to load the sectors to
     call ata_lba_read
     jmp CODE_SEG:0x0100000 ; call kernel start function. 
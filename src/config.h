@@ -6,15 +6,32 @@
 #define KERNEL_CODE_SELECTOR 0x08
 #define KERNEL_DATA_SELECTOR 0x10
 
-#define CROSOS_HEAP_SIZE_BYTES 104857600 // 100MB heap size
+#define CROSOS_HEAP_SIZE_BYTES 50331648 // 48MB heap size
 #define CROSOS_HEAP_BLOCK_SIZE 4096
 #define CROSOS_HEAP_ADDRESS 0x01000000
 #define CROSOS_HEAP_TABLE_ADDRESS 0x00007E00
 
+#define CROSOS_FRAME_POOL_SIZE_BYTES 62914560 // 60MB of page frames, right after the heap
+#define CROSOS_FRAME_POOL_ADDRESS 0x04000000
+
+#define CROSOS_PAGING_IDENTITY_END (CROSOS_FRAME_POOL_ADDRESS + CROSOS_FRAME_POOL_SIZE_BYTES) // Every address space identity maps the kernel memory up to here
+
 #define CROSOS_SECTOR_SIZE 512
+#define CROSOS_MAX_DISKS 8 // Drive numbers of the paths are a single digit
+#define CROSOS_DISK_USE_DMA 1 // Use bus master DMA when the IDE controller supports it, PIO otherwise
+#define CROSOS_DISK_USE_VIRTIO 1 // Register the virtio-blk disks of a virtual machine after the IDE ones
+#define CROSOS_DISK_BENCHMARK_WRITES 0 // Debug only: lets the disk benchmark system call rewrite raw sectors of any disk
+#define CROSOS_DISK_CACHE_SIZE_BYTES 524288 // Memory budget of the sector cache (512KB)
+#define CROSOS_DISK_CACHE_BUCKETS 256
+#define CROSOS_FAT16_DENTRY_CACHE_ENTRIES 64 // Path components remembered per FAT16 disk
+#define CROSOS_FAT16_READAHEAD_MIN_CLUSTERS 4 // Read-ahead window after the first sequential read of a file
+#define CROSOS_FAT16_READAHEAD_MAX_SECTORS 256 // Largest read-ahead window (128KB), a quarter of the sector cache
 
 #define CROSOS_MAX_FILESYSTEMS 12
 #define CROSOS_MAX_FILE_DESCRIPTORS 512
+#define CROSOS_MAX_PROCESS_FILES 16 // Files a process can have open at once through the system calls
+#define CROSOS_FILE_SYSCALL_BUFFER_SIZE 4096 // Kernel buffer the file system calls copy the user data through
+#define CROSOS_FS_SYNC_INTERVAL_TICKS 91 // Clock ticks between write backs of the dirty filesystem data (about 5 seconds)
 
 #define CROSOS_MAX_PATH 108
 
@@ -24,12 +41,17 @@
 #define CROSOS_USER_PROGRAM_STACK_SIZE 1024*16
 #define CROSOS_PROGRAM_VIRTUAL_STACK_ADDRESS_START 0x3FF000
 #define CROSOS_PROGRAM_VIRTUAL_STACK_ADDRESS_END CROSOS_PROGRAM_VIRTUAL_STACK_ADDRESS_START - CROSOS_USER_PROGRAM_STACK_SIZE
+#define CROSOS_USER_PROGRAM_STACK_MAX_SIZE 1024*1024 //The stack grows on demand up to this size
+#define CROSOS_PROGRAM_VIRTUAL_STACK_ADDRESS_LIMIT CROSOS_PROGRAM_VIRTUAL_STACK_ADDRESS_START - CROSOS_USER_PROGRAM_STACK_MAX_SIZE
+#define CROSOS_PROGRAM_VIRTUAL_HEAP_ADDRESS 0x40000000 //Start of the heap handed out by sbrk, far from the kernel identity mapping
+#define CROSOS_USER_PROGRAM_HEAP_MAX_SIZE 1024*1024*64
 
 #define USER_DATA_SEGMENT 0x23 //Offsets in the GDT table (20 + 3 ring level)
 #define USER_CODE_SEGMENT 0x1B //Offsets in the GDT table (offset 18 + 3 ring level)
 
-#define CROSOS_MAX_PROGRAM_ALLOCATIONS 1024
+#define CROSOS_PROCESS_ALLOCATION_BUCKETS 64 //Hash buckets that index the kernel allocations of a process
 #define CROSOS_MAX_PROCESSES 12
+#define CROSOS_TASK_KERNEL_STACK_SIZE 16384 //Every task runs its interrupts on its own stack, so it can sleep inside the kernel
 
 #define CROSOS_MAX_ISR80H_COMMANDS 1024
 
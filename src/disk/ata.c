@@ -0,0 +1,371 @@
+#include "ata.h"
+#include "ata_dma.h"
+#include "disk.h"
+#include "io/io.h"
+#include "idt/idt.h"
+#include "config.h"
+#include "status.h"
+#include "memory/memory.h"
+#include "memory/heap/kheap.h"
+
+//Legacy ports of the IDE channels. The secondary one is probed the same way, it is empty when there are no drives on it
+static struct ata_channel ata_channels[ATA_TOTAL_CHANNELS] = {
+    {.io_base = 0x1F0, .control_base = 0x3F6, .interrupt = ATA_PRIMARY_INTERRUPT},
+    {.io_base = 0x170, .control_base = 0x376, .interrupt = ATA_SECONDARY_INTERRUPT}
+};
+
+//Returns the channel that raises an interrupt
+static struct ata_channel* ata_channel_for_interrupt(uint8_t interrupt)
+{
+    for(uint32_t i = 0; i < ATA_TOTAL_CHANNELS; i++)
+    {
+        if(ata_channels[i].interrupt == interrupt)
+        {
+            return &ata_channels[i];
+        }
+    }
+    return 0;
+}
+
+//A drive has a sector ready or finished a command
+static void ata_interrupt(uint8_t interrupt)
+{
+    struct ata_channel* channel = ata_channel_for_interrupt(interrupt);
+    channel->irq_status = insb(channel->io_base + ATA_REG_STATUS); //Reading the status also clears the interrupt of the drive
+    channel->irq_received = true;
+    task_wakeup(&channel->wait_queue);
+}
+
+//IRQ14
+static void ata_primary_interrupt_handler()
+{
+    ata_interrupt(ATA_PRIMARY_INTERRUPT);
+}
+
+//IRQ15
+static void ata_secondary_interrupt_handler()
+{
+    ata_interrupt(ATA_SECONDARY_INTERRUPT);
+}
+
+//Sleeps the current task until the channel raises an interrupt. Other tasks run meanwhile. Returns the ATA status
+uint8_t ata_wait_interrupt(struct ata_channel* channel)
+{
+    while(!channel->irq_received)
+    {
+        task_sleep(&channel->wait_queue);
+    }
+    channel->irq_received = false;
+    return channel->irq_status;
+}
+
+//Waits for the end of a command. With interrupts the task sleeps, otherwise the status is polled
+static uint8_t ata_wait(struct ata_channel* channel)
+{
+    uint8_t status = channel->irq_enabled ? ata_wait_interrupt(channel) : insb(channel->io_base + ATA_REG_STATUS);
+    while(status & ATA_STATUS_BUSY)
+    {
+        status = insb(channel->io_base + ATA_REG_STATUS);
+    }
+    return status;
+}
+
+//Waits until the drive can move a sector through the data port. Returns false on an error
+static bool ata_wait_data(struct ata_channel* channel, uint8_t status)
+{
+    while((status & ATA_STATUS_BUSY) || !(status & ATA_STATUS_DRQ))
+    {
+        if(!(status & ATA_STATUS_BUSY) && (status & (ATA_STATUS_ERROR | ATA_STATUS_FAULT)))
+        {
+            return false;
+        }
+        status = insb(channel->io_base + ATA_REG_STATUS);
+    }
+    return true;
+}
+
+//Writes the drive register. When it selects another drive, the 400ns it needs are waited reading the alternate status
+void ata_select(struct ata_device* device, uint8_t drive_register)
+{
+    struct ata_channel* channel = device->channel;
+    drive_register |= device->drive ? ATA_DRIVE_SLAVE : 0;
+    outb(channel->io_base + ATA_REG_DRIVE, drive_register);
+    if((channel->selected & ATA_DRIVE_SLAVE) != (drive_register & ATA_DRIVE_SLAVE))
+    {
+        for(int i = 0; i < 4; i++)
+        {
+            insb(channel->control_base);
+        }
+    }
+    channel->selected = drive_register;
+}
+
+//Programs the registers of a transfer of 'total' sectors (1-256) and sends the command
+//'command_ext' is sent instead of 'command' with LBA48 addressing, used when the sectors are past the reach of LBA28
+void ata_begin_command(struct ata_device* device, uint32_t lba, uint32_t total, uint8_t command, uint8_t command_ext)
+{
+    struct ata_channel* channel = device->channel;
+    uint16_t io = channel->io_base;
+    channel->irq_received = false;
+    if(device->lba48 && lba + total > ATA_LBA28_LIMIT)
+    {
+        ata_select(device, ATA_DRIVE_LBA48);
+        outb(io + ATA_REG_SECTOR_COUNT, (total >> 8) & 0xFF); //High bytes first
+        outb(io + ATA_REG_LBA_LOW, (lba >> 24) & 0xFF);
+        outb(io + ATA_REG_LBA_MID, 0x00); //The LBA of the disk struct is 32 bits
+        outb(io + ATA_REG_LBA_HIGH, 0x00);
+        outb(io + ATA_REG_SECTOR_COUNT, total & 0xFF);
+        outb(io + ATA_REG_LBA_LOW, lba & 0xFF);
+        outb(io + ATA_REG_LBA_MID, (lba >> 8) & 0xFF);
+        outb(io + ATA_REG_LBA_HIGH, (lba >> 16) & 0xFF);
+        outb(io + ATA_REG_COMMAND, command_ext);
+        return;
+    }
+
+    ata_select(device, ATA_DRIVE_LBA | ((lba >> 24) & 0x0F));
+    outb(io + ATA_REG_SECTOR_COUNT, total & 0xFF); //0 means 256
+    outb(io + ATA_REG_LBA_LOW, lba & 0xFF);
+    outb(io + ATA_REG_LBA_MID, (lba >> 8) & 0xFF);
+    outb(io + ATA_REG_LBA_HIGH, (lba >> 16) & 0xFF);
+    outb(io + ATA_REG_COMMAND, command);
+}
+
+//Reads up to 256 sectors moving every word through the data port. The drive interrupts once per sector
+static int32_t ata_pio_read_sectors(struct ata_device* device, uint32_t lba, uint32_t total, uint16_t* ptr)
+{
+    struct ata_channel* channel = device->channel;
+    ata_begin_command(device, lba, total, ATA_COMMAND_READ, ATA_COMMAND_READ_EXT);
+    for(uint32_t b = 0; b < total; b++)
+    {
+        //Wait for the buffer to be ready
+        uint8_t status = channel->irq_enabled ? ata_wait_interrupt(channel) : insb(channel->io_base + ATA_REG_STATUS);
+        if(!ata_wait_data(channel, status))
+        {
+            return -EIO;
+        }
+
+        //Copy from hard disk to memory
+        for(int i = 0; i < 256; i++)
+        {
+            *ptr = insw(channel->io_base + ATA_REG_DATA);
+            ptr++;
+        }
+    }
+    return 0;
+}
+
+//Writes up to 256 sectors through the data port. The drive raises an interrupt after storing every sector
+static int32_t ata_pio_write_sectors(struct ata_device* device, uint32_t lba, uint32_t total, uint16_t* ptr)
+{
+    struct ata_channel* channel = device->channel;
+    ata_begin_command(device, lba, total, ATA_COMMAND_WRITE, ATA_COMMAND_WRITE_EXT);
+    for(uint32_t b = 0; b < total; b++)
+    {
+        //The first sector is accepted right away, the next ones after the interrupt of the previous one
+        uint8_t status = (b > 0 && channel->irq_enabled) ? ata_wait_interrupt(channel) : insb(channel->io_base + ATA_REG_STATUS);
+        if(!ata_wait_data(channel, status))
+        {
+            return -EIO;
+        }
+
+        for(int i = 0; i < 256; i++)
+        {
+            outw(channel->io_base + ATA_REG_DATA, *ptr);
+            ptr++;
+        }
+    }
+
+    //Wait until the last sector is stored
+    return (ata_wait(channel) & (ATA_STATUS_ERROR | ATA_STATUS_FAULT)) ? -EIO : 0;
+}
+
+//Reads sectors with PIO, split in commands the drive accepts
+static int32_t ata_pio_read(struct disk* disk, uint32_t lba, uint32_t total, void* buff)
+{
+    struct ata_device* device = disk->driver_private;
+    int32_t res = 0;
+    task_mutex_lock(&device->channel->lock);
+    while(total > 0 && res == 0)
+    {
+        uint32_t sectors = total > ATA_MAX_SECTORS_PER_COMMAND ? ATA_MAX_SECTORS_PER_COMMAND : total;
+        res = ata_pio_read_sectors(device, lba, sectors, buff);
+        buff += sectors * CROSOS_SECTOR_SIZE;
+        lba += sectors;
+        total -= sectors;
+    }
+    task_mutex_unlock(&device->channel->lock);
+    return res;
+}
+
+//Writes sectors with PIO, split in commands the drive accepts
+static int32_t ata_pio_write(struct disk* disk, uint32_t lba, uint32_t total, void* buff)
+{
+    struct ata_device* device = disk->driver_private;
+    int32_t res = 0;
+    task_mutex_lock(&device->channel->lock);
+    while(total > 0 && res == 0)
+    {
+        uint32_t sectors = total > ATA_MAX_SECTORS_PER_COMMAND ? ATA_MAX_SECTORS_PER_COMMAND : total;
+        res = ata_pio_write_sectors(device, lba, sectors, buff);
+        buff += sectors * CROSOS_SECTOR_SIZE;
+        lba += sectors;
+        total -= sectors;
+    }
+    task_mutex_unlock(&device->channel->lock);
+    return res;
+}
+
+//Reads sectors with the bus master DMA of the channel
+static int32_t ata_dma_disk_read(struct disk* disk, uint32_t lba, uint32_t total, void* buff)
+{
+    struct ata_device* device = disk->driver_private;
+    task_mutex_lock(&device->channel->lock);
+    int32_t res = ata_dma_read(device, lba, total, buff);
+    task_mutex_unlock(&device->channel->lock);
+    return res;
+}
+
+//Asks the drive to store the contents of its own write cache
+static int32_t ata_flush(struct disk* disk)
+{
+    struct ata_device* device = disk->driver_private;
+    struct ata_channel* channel = device->channel;
+    task_mutex_lock(&channel->lock);
+    channel->irq_received = false;
+    ata_select(device, device->lba48 ? ATA_DRIVE_LBA48 : ATA_DRIVE_LBA);
+    outb(channel->io_base + ATA_REG_COMMAND, device->lba48 ? ATA_COMMAND_FLUSH_EXT : ATA_COMMAND_FLUSH);
+    uint8_t status = ata_wait(channel);
+    task_mutex_unlock(&channel->lock);
+    return (status & (ATA_STATUS_ERROR | ATA_STATUS_FAULT)) ? -EIO : 0;
+}
+
+//Polls the status until the busy bit clears. Returns the status, or 0 if the drive never answers
+static uint8_t ata_poll_not_busy(struct ata_channel* channel)
+{
+    for(uint32_t i = 0; i < ATA_POLL_TIMEOUT; i++)
+    {
+        uint8_t status = insb(channel->io_base + ATA_REG_STATUS);
+        if(!(status & ATA_STATUS_BUSY))
+        {
+            return status;
+        }
+    }
+    return 0;
+}
+
+//Sends IDENTIFY to a drive. Returns an error if there is no ATA drive there (empty, ATAPI or without LBA)
+static int32_t ata_identify(struct ata_device* device)
+{
+    struct ata_channel* channel = device->channel;
+    uint16_t io = channel->io_base;
+    uint16_t identify[256];
+
+    ata_select(device, ATA_DRIVE_LBA);
+    outb(io + ATA_REG_SECTOR_COUNT, 0x00);
+    outb(io + ATA_REG_LBA_LOW, 0x00);
+    outb(io + ATA_REG_LBA_MID, 0x00);
+    outb(io + ATA_REG_LBA_HIGH, 0x00);
+    outb(io + ATA_REG_COMMAND, ATA_COMMAND_IDENTIFY);
+
+    uint8_t status = insb(io + ATA_REG_STATUS);
+    if(status == 0x00 || status == 0xFF) //No drive, or no channel at all (floating bus)
+    {
+        return -EIO;
+    }
+
+    status = ata_poll_not_busy(channel);
+    if(!status)
+    {
+        return -EIO;
+    }
+
+    if(insb(io + ATA_REG_LBA_MID) || insb(io + ATA_REG_LBA_HIGH)) //Signature of an ATAPI or SATA device
+    {
+        return -EIO;
+    }
+
+    for(uint32_t i = 0; !(status & ATA_STATUS_DRQ); i++)
+    {
+        if((status & (ATA_STATUS_ERROR | ATA_STATUS_FAULT)) || i >= ATA_POLL_TIMEOUT)
+        {
+            return -EIO;
+        }
+        status = insb(io + ATA_REG_STATUS);
+    }
+
+    for(int i = 0; i < 256; i++)
+    {
+        identify[i] = insw(io + ATA_REG_DATA);
+    }
+
+    if(!(identify[ATA_IDENTIFY_CAPABILITIES] & ATA_IDENTIFY_HAS_LBA))
+    {
+        return -EIO; //CHS only drives are not supported
+    }
+
+    device->total_sectors = identify[ATA_IDENTIFY_LBA28_SECTORS] | (identify[ATA_IDENTIFY_LBA28_SECTORS + 1] << 16);
+    device->lba48 = identify[ATA_IDENTIFY_COMMAND_SETS] & ATA_IDENTIFY_HAS_LBA48;
+    if(device->lba48)
+    {
+        device->total_sectors = identify[ATA_IDENTIFY_LBA48_SECTORS] | (identify[ATA_IDENTIFY_LBA48_SECTORS + 1] << 16);
+        if(identify[ATA_IDENTIFY_LBA48_SECTORS + 2] || identify[ATA_IDENTIFY_LBA48_SECTORS + 3])
+        {
+            device->total_sectors = 0xFFFFFFFF; //Sectors are addressed with 32 bits, the rest of the drive is not used
+        }
+    }
+    return 0;
+}
+
+//Probes the master and the slave of both IDE channels and registers a disk for every ATA drive found
+//The primary master is registered first, it is the boot disk
+void ata_search_and_init()
+{
+    for(uint32_t i = 0; i < ATA_TOTAL_CHANNELS; i++)
+    {
+        struct ata_channel* channel = &ata_channels[i];
+        outb(channel->control_base, ATA_CONTROL_NIEN); //The drives are polled until ata_enable_interrupts
+        channel->selected = 0xFF; //Unknown, the first select waits
+        bool dma_checked = false;
+        for(uint8_t drive = 0; drive < ATA_DRIVES_PER_CHANNEL; drive++)
+        {
+            struct ata_device probe = {.channel = channel, .drive = drive};
+            if(ata_identify(&probe) < 0)
+            {
+                continue;
+            }
+
+            struct ata_device* device = kzalloc(sizeof(struct ata_device));
+            if(!device)
+            {
+                return;
+            }
+            memcpy(device, &probe, sizeof(struct ata_device));
+
+            if(!dma_checked && CROSOS_DISK_USE_DMA)
+            {
+                ata_dma_init(channel, i); //PIO stays as the fallback when there is no bus master controller
+                dma_checked = true;
+            }
+
+            //Writes are always PIO, the DMA backend only reads
+            DISK_READ_FUNCTION read = channel->dma_base ? ata_dma_disk_read : ata_pio_read;
+            if(!disk_register(read, ata_pio_write, ata_flush, device->total_sectors, device))
+            {
+                kfree(device);
+                return;
+            }
+        }
+    }
+}
+
+//Lets the drives raise their interrupts instead of being polled. Called once the IDT is loaded
+void ata_enable_interrupts()
+{
+    idt_register_interrupt_callback(ATA_PRIMARY_INTERRUPT, ata_primary_interrupt_handler);
+    idt_register_interrupt_callback(ATA_SECONDARY_INTERRUPT, ata_secondary_interrupt_handler);
+    for(uint32_t i = 0; i < ATA_TOTAL_CHANNELS; i++)
+    {
+        ata_channels[i].irq_enabled = true;
+        outb(ata_channels[i].control_base, 0x00); //Clear nIEN in the device control register
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef ATA_H
+#define ATA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "task/task.h"
+
+#define ATA_PRIMARY_INTERRUPT 0x2E // IRQ14, after remapping the slave PIC
+#define ATA_SECONDARY_INTERRUPT 0x2F // IRQ15
+#define ATA_TOTAL_CHANNELS 2
+#define ATA_DRIVES_PER_CHANNEL 2 // Master and slave
+
+//Registers relative to the I/O base of a channel
+#define ATA_REG_DATA 0x00
+#define ATA_REG_SECTOR_COUNT 0x02
+#define ATA_REG_LBA_LOW 0x03
+#define ATA_REG_LBA_MID 0x04
+#define ATA_REG_LBA_HIGH 0x05
+#define ATA_REG_DRIVE 0x06
+#define ATA_REG_STATUS 0x07 // Read
+#define ATA_REG_COMMAND 0x07 // Write
+
+#define ATA_STATUS_ERROR 0x01
+#define ATA_STATUS_DRQ 0x08 // Data ready to be moved through the data port
+#define ATA_STATUS_FAULT 0x20
+#define ATA_STATUS_BUSY 0x80
+
+#define ATA_CONTROL_NIEN 0x02 // The drive does not raise interrupts
+
+#define ATA_DRIVE_LBA 0xE0 // LBA28 addressing, the low bits hold bits 24-27 of the LBA
+#define ATA_DRIVE_LBA48 0x40
+#define ATA_DRIVE_SLAVE 0x10
+
+#define ATA_COMMAND_READ 0x20
+#define ATA_COMMAND_READ_EXT 0x24
+#define ATA_COMMAND_WRITE 0x30
+#define ATA_COMMAND_WRITE_EXT 0x34
+#define ATA_COMMAND_FLUSH 0xE7
+#define ATA_COMMAND_FLUSH_EXT 0xEA
+#define ATA_COMMAND_IDENTIFY 0xEC
+
+//Words of the IDENTIFY data
+#define ATA_IDENTIFY_CAPABILITIES 49
+#define ATA_IDENTIFY_LBA28_SECTORS 60
+#define ATA_IDENTIFY_COMMAND_SETS 83
+#define ATA_IDENTIFY_LBA48_SECTORS 100
+#define ATA_IDENTIFY_HAS_LBA 0x0200
+#define ATA_IDENTIFY_HAS_LBA48 0x0400
+
+#define ATA_LBA28_LIMIT 0x10000000 // First sector that needs LBA48
+#define ATA_MAX_SECTORS_PER_COMMAND 256 // Sector count of a command, larger requests are split
+#define ATA_POLL_TIMEOUT 1000000 // Status polls before a drive that is being probed is given up
+
+struct ata_dma_prd;
+
+//One of the two IDE channels. The master and the slave share its registers and its interrupt
+struct ata_channel
+{
+    uint16_t io_base;
+    uint16_t control_base;
+    uint8_t interrupt;
+    uint8_t selected; //Drive register of the last command, a different drive needs a delay after it is selected
+
+    //Bus master DMA, dma_base is 0 when the channel uses PIO
+    uint16_t dma_base;
+    struct ata_dma_prd* dma_prdt;
+    void* dma_buffer;
+
+    bool irq_enabled; //Until the IDT is ready the drives are polled
+    volatile bool irq_received;
+    volatile uint8_t irq_status; //ATA status read by the interrupt handler
+    struct task_wait_queue wait_queue; //Task waiting for the interrupt
+    struct task_mutex lock; //One request at a time on the channel. Requests to the other channel go on meanwhile
+};
+
+//Driver data of a disk on an IDE channel
+struct ata_device
+{
+    struct ata_channel* channel;
+    uint8_t drive; //0 master, 1 slave
+    bool lba48;
+    uint32_t total_sectors;
+};
+
+void ata_search_and_init();
+void ata_enable_interrupts();
+void ata_select(struct ata_device* device, uint8_t drive_register);
+void ata_begin_command(struct ata_device* device, uint32_t lba, uint32_t total, uint8_t command, uint8_t command_ext);
+uint8_t ata_wait_interrupt(struct ata_channel* channel);
+
+#endif
@@ -0,0 +1,178 @@
+#include "ata_dma.h"
+#include "io/io.h"
+#include "io/pci.h"
+#include "status.h"
+#include "memory/memory.h"
+#include "memory/frame/kframe.h"
+
+//Looks for a PCI IDE controller with bus mastering and prepares the PRD table of the channel number 'index'
+//Returns an error if the drives of the channel must use PIO
+int32_t ata_dma_init(struct ata_channel* channel, uint32_t index)
+{
+    struct pci_device device;
+    if(pci_find_class(ATA_DMA_IDE_CLASS, ATA_DMA_IDE_SUBCLASS, &device) < 0)
+    {
+        return -EIO;
+    }
+
+    uint32_t class = pci_config_read(&device, PCI_CONFIG_CLASS);
+    if(!(class & 0x8000)) //Bit 7 of the programming interface, the controller supports bus mastering
+    {
+        return -EIO;
+    }
+
+    uint32_t bar4 = pci_config_read(&device, PCI_CONFIG_BAR4);
+    if(!(bar4 & 0x01)) //The bus master registers must be in I/O space
+    {
+        return -EIO;
+    }
+
+    struct ata_dma_prd* prdt = kframe_zalloc(sizeof(struct ata_dma_prd) * ATA_DMA_PRD_ENTRIES); //A frame, so the table does not cross a 64KB boundary
+    void* buffer = kframe_alloc(ATA_DMA_MAX_BYTES); //Bounce buffer for the buffers the controller cannot reach, the buddy allocator keeps it inside a 64KB boundary
+    if(!prdt || !buffer)
+    {
+        if(prdt)
+        {
+            kframe_free(prdt);
+        }
+        if(buffer)
+        {
+            kframe_free(buffer);
+        }
+        return -ENOMEM;
+    }
+
+    //Let the controller write to memory on its own
+    uint32_t command = pci_config_read(&device, PCI_CONFIG_COMMAND);
+    pci_config_write(&device, PCI_CONFIG_COMMAND, (command & 0xFFFF) | PCI_COMMAND_IO_SPACE | PCI_COMMAND_BUS_MASTER);
+
+    channel->dma_prdt = prdt;
+    channel->dma_buffer = buffer;
+    channel->dma_base = (bar4 & PCI_BAR_IO_MASK) + (index * ATA_DMA_CHANNEL_REGISTERS);
+    return 0;
+}
+
+//Fills the PRD table with the memory of 'buff'. An entry ends at every 64KB boundary
+static void ata_dma_set_prdt(struct ata_channel* channel, void* buff, uint32_t bytes)
+{
+    uint32_t address = (uint32_t) buff; //The kernel memory is identity mapped
+    struct ata_dma_prd* prd = channel->dma_prdt;
+    while(true)
+    {
+        uint32_t length = ATA_DMA_MAX_BYTES - (address & (ATA_DMA_MAX_BYTES - 1)); //Up to the next boundary
+        if(length > bytes)
+        {
+            length = bytes;
+        }
+
+        prd->address = address;
+        prd->byte_count = length & 0xFFFF;
+        address += length;
+        bytes -= length;
+        if(bytes == 0)
+        {
+            prd->flags = ATA_DMA_PRD_END;
+            break;
+        }
+        prd->flags = 0;
+        prd++;
+    }
+}
+
+//Transfers 'total' sectors to 'buff'. Up to ATA_DMA_DIRECT_MAX_SECTORS, and it must be memory the controller can write
+static int32_t ata_dma_transfer(struct ata_device* device, uint32_t lba, uint32_t total, void* buff)
+{
+    struct ata_channel* channel = device->channel;
+    ata_dma_set_prdt(channel, buff, total * CROSOS_SECTOR_SIZE);
+
+    outb(channel->dma_base + ATA_DMA_REG_COMMAND, 0x00); //Stop any previous transfer
+    outl(channel->dma_base + ATA_DMA_REG_PRDT, (uint32_t) channel->dma_prdt);
+    outb(channel->dma_base + ATA_DMA_REG_COMMAND, ATA_DMA_COMMAND_READ);
+    outb(channel->dma_base + ATA_DMA_REG_STATUS, ATA_DMA_STATUS_ERROR | ATA_DMA_STATUS_INTERRUPT); //Clear them by writing 1
+
+    //Same registers as the PIO read, with the DMA command
+    ata_begin_command(device, lba, total, ATA_COMMAND_READ_DMA, ATA_COMMAND_READ_DMA_EXT);
+
+    outb(channel->dma_base + ATA_DMA_REG_COMMAND, ATA_DMA_COMMAND_READ | ATA_DMA_COMMAND_START);
+
+    if(channel->irq_enabled)
+    {
+        ata_wait_interrupt(channel); //Sleep until the transfer ends, the status loop below finds it done
+    }
+
+    int32_t res = -EIO;
+    for(uint32_t i = 0; i < ATA_DMA_TIMEOUT; i++)
+    {
+        uint8_t status = insb(channel->dma_base + ATA_DMA_REG_STATUS);
+        if(status & ATA_DMA_STATUS_ERROR)
+        {
+            break;
+        }
+
+        if(!(status & ATA_DMA_STATUS_ACTIVE) || (status & ATA_DMA_STATUS_INTERRUPT))
+        {
+            res = 0;
+            break;
+        }
+    }
+
+    outb(channel->dma_base + ATA_DMA_REG_COMMAND, 0x00);
+    uint8_t ata_status = insb(channel->io_base + ATA_REG_STATUS); //Reading the status acknowledges the drive interrupt
+    if(ata_status & ATA_STATUS_ERROR) //Error bit of the drive
+    {
+        res = -EIO;
+    }
+    return res;
+}
+
+//Checks if the controller can write to 'buff' directly: identity mapped kernel memory, with the word alignment of the PRD addresses
+static bool ata_dma_can_target(void* buff, uint32_t total)
+{
+    uint32_t address = (uint32_t) buff;
+    return !(address & 0x03) && address + total * CROSOS_SECTOR_SIZE <= CROSOS_PAGING_IDENTITY_END && address + total * CROSOS_SECTOR_SIZE > address;
+}
+
+//Reads 'total' sectors with bus master DMA. The controller writes straight into 'buff', the CPU does not move the data
+//Buffers it cannot reach go through the bounce buffer of the channel. The caller holds the lock of the channel
+int32_t ata_dma_read(struct ata_device* device, uint32_t lba, uint32_t total, void* buff)
+{
+    struct ata_channel* channel = device->channel;
+    if(!channel->dma_base)
+    {
+        return -EIO;
+    }
+
+    if(ata_dma_can_target(buff, total))
+    {
+        while(total > 0)
+        {
+            uint32_t sectors = total > ATA_DMA_DIRECT_MAX_SECTORS ? ATA_DMA_DIRECT_MAX_SECTORS : total;
+            int32_t res = ata_dma_transfer(device, lba, sectors, buff);
+            if(res < 0)
+            {
+                return res;
+            }
+
+            buff += sectors * CROSOS_SECTOR_SIZE;
+            lba += sectors;
+            total -= sectors;
+        }
+        return 0;
+    }
+
+    while(total > 0)
+    {
+        uint32_t sectors = total > ATA_DMA_MAX_SECTORS ? ATA_DMA_MAX_SECTORS : total;
+        int32_t res = ata_dma_transfer(device, lba, sectors, channel->dma_buffer);
+        if(res < 0)
+        {
+            return res;
+        }
+
+        memcpy(buff, channel->dma_buffer, sectors * CROSOS_SECTOR_SIZE);
+        buff += sectors * CROSOS_SECTOR_SIZE;
+        lba += sectors;
+        total -= sectors;
+    }
+    return 0;
+}
@@ -0,0 +1,44 @@
+#ifndef ATA_DMA_H
+#define ATA_DMA_H
+
+#include <stdint.h>
+#include "config.h"
+#include "ata.h"
+
+#define ATA_DMA_IDE_CLASS 0x01 // Mass storage controller
+#define ATA_DMA_IDE_SUBCLASS 0x01 // IDE interface
+
+//Bus master registers of a channel, relative to BAR4. The ones of the secondary channel follow the primary ones
+#define ATA_DMA_CHANNEL_REGISTERS 0x08
+#define ATA_DMA_REG_COMMAND 0x00
+#define ATA_DMA_REG_STATUS 0x02
+#define ATA_DMA_REG_PRDT 0x04
+
+#define ATA_DMA_COMMAND_START 0x01
+#define ATA_DMA_COMMAND_READ 0x08 // Transfer from the disk to memory
+#define ATA_DMA_STATUS_ACTIVE 0x01
+#define ATA_DMA_STATUS_ERROR 0x02
+#define ATA_DMA_STATUS_INTERRUPT 0x04
+
+#define ATA_DMA_PRD_END 0x8000 // Last entry of the PRD table
+#define ATA_DMA_MAX_BYTES 65536 // A PRD entry cannot cross a 64KB boundary, larger regions take several entries
+#define ATA_DMA_MAX_SECTORS (ATA_DMA_MAX_BYTES / CROSOS_SECTOR_SIZE) // Transfers through the bounce buffer
+#define ATA_DMA_DIRECT_MAX_SECTORS ATA_MAX_SECTORS_PER_COMMAND // Transfers straight to the buffer of the caller, 3 PRD entries at most
+#define ATA_DMA_PRD_ENTRIES 8
+#define ATA_DMA_TIMEOUT 10000000 // Status polls before a transfer is given up
+
+#define ATA_COMMAND_READ_DMA 0xC8
+#define ATA_COMMAND_READ_DMA_EXT 0x25
+
+//Physical region descriptor, tells the controller where to write a transfer
+struct ata_dma_prd
+{
+    uint32_t address;
+    uint16_t byte_count; //0 means 64KB
+    uint16_t flags;
+} __attribute__((packed));
+
+int32_t ata_dma_init(struct ata_channel* channel, uint32_t index);
+int32_t ata_dma_read(struct ata_device* device, uint32_t lba, uint32_t total, void* buff);
+
+#endif
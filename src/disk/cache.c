@@ -0,0 +1,448 @@
+#include "cache.h"
+#include "disk.h"
+#include "config.h"
+#include "status.h"
+#include "memory/memory.h"
+#include "memory/heap/kheap.h"
+#include "task/task.h"
+
+//Sector cache shared by all the disks. Lookups go through a hash of (disk, lba) and the least recently used sector is reused when it is full
+//Writes stay in the cache as dirty sectors. They reach the disk when their entry is reused or on disk_cache_flush, contiguous ones in a single request
+static struct disk_cache_entry* disk_cache_entries = 0;
+static uint32_t disk_cache_total_entries = 0;
+static struct disk_cache_entry* disk_cache_hash[CROSOS_DISK_CACHE_BUCKETS];
+static struct disk_cache_entry* disk_cache_lru_head = 0; //Most recently used
+static struct disk_cache_entry* disk_cache_lru_tail = 0; //Least recently used, next to be reused
+static struct disk_cache_stats disk_cache_stats;
+static uint8_t* disk_cache_io_buffer = 0; //Contiguous copy of the sectors of a prefetch or a write back
+
+//Tasks using different disks can be in the cache at the same time. The lock is held while the entries are used, also during
+//prefetches and write backs that go through the I/O buffer. Plain reads release it while the disk fills the buffer of the caller
+static struct task_mutex disk_cache_lock;
+
+//Returns the hash bucket of a sector
+static struct disk_cache_entry** disk_cache_bucket(uint32_t disk_id, uint32_t lba)
+{
+    return &disk_cache_hash[(lba ^ (disk_id * 0x9E3779B1)) % CROSOS_DISK_CACHE_BUCKETS];
+}
+
+//Removes an entry from the LRU list
+static void disk_cache_lru_unlink(struct disk_cache_entry* entry)
+{
+    if(entry->lru_prev)
+    {
+        entry->lru_prev->lru_next = entry->lru_next;
+    }
+    else
+    {
+        disk_cache_lru_head = entry->lru_next;
+    }
+
+    if(entry->lru_next)
+    {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    }
+    else
+    {
+        disk_cache_lru_tail = entry->lru_prev;
+    }
+    entry->lru_prev = 0;
+    entry->lru_next = 0;
+}
+
+//Adds an entry as the most recently used
+static void disk_cache_lru_push(struct disk_cache_entry* entry)
+{
+    entry->lru_prev = 0;
+    entry->lru_next = disk_cache_lru_head;
+    if(disk_cache_lru_head)
+    {
+        disk_cache_lru_head->lru_prev = entry;
+    }
+    disk_cache_lru_head = entry;
+    if(!disk_cache_lru_tail)
+    {
+        disk_cache_lru_tail = entry;
+    }
+}
+
+//Removes a valid entry from its hash bucket
+static void disk_cache_hash_unlink(struct disk_cache_entry* entry)
+{
+    struct disk_cache_entry** link = disk_cache_bucket(entry->disk_id, entry->lba);
+    while(*link && *link != entry)
+    {
+        link = &(*link)->hash_next;
+    }
+
+    if(*link)
+    {
+        *link = entry->hash_next;
+    }
+    entry->hash_next = 0;
+    entry->valid = false;
+}
+
+//Allocates the memory of the cache. Without it, reads go straight to the disk
+void disk_cache_init()
+{
+    memset(disk_cache_hash, 0, sizeof(disk_cache_hash));
+    memset(&disk_cache_stats, 0, sizeof(disk_cache_stats));
+    disk_cache_lru_head = 0;
+    disk_cache_lru_tail = 0;
+
+    uint32_t total_entries = CROSOS_DISK_CACHE_SIZE_BYTES / CROSOS_SECTOR_SIZE;
+    struct disk_cache_entry* entries = kzalloc(sizeof(struct disk_cache_entry) * total_entries);
+    uint8_t* data = kmalloc(CROSOS_DISK_CACHE_SIZE_BYTES);
+    uint8_t* io_buffer = kmalloc(DISK_CACHE_IO_SECTORS * CROSOS_SECTOR_SIZE);
+    if(!entries || !data || !io_buffer)
+    {
+        if(entries)
+        {
+            kfree(entries);
+        }
+        if(data)
+        {
+            kfree(data);
+        }
+        if(io_buffer)
+        {
+            kfree(io_buffer);
+        }
+        return;
+    }
+
+    //Every entry starts empty at the tail side of the LRU list
+    for(uint32_t i = 0; i < total_entries; i++)
+    {
+        entries[i].data = data + (i * CROSOS_SECTOR_SIZE);
+        disk_cache_lru_push(&entries[i]);
+    }
+
+    disk_cache_entries = entries;
+    disk_cache_total_entries = total_entries;
+    disk_cache_stats.total_entries = total_entries;
+    disk_cache_io_buffer = io_buffer;
+}
+
+//Finds a cached sector
+static struct disk_cache_entry* disk_cache_find(uint32_t disk_id, uint32_t lba)
+{
+    for(struct disk_cache_entry* entry = *disk_cache_bucket(disk_id, lba); entry; entry = entry->hash_next)
+    {
+        if(entry->disk_id == disk_id && entry->lba == lba)
+        {
+            return entry;
+        }
+    }
+    return 0;
+}
+
+//Writes the dirty run of sectors that starts at 'lba', as many at once as the buffer holds
+static int32_t disk_cache_write_run(struct disk* disk, uint32_t lba)
+{
+    while(1)
+    {
+        uint32_t count = 0;
+        while(count < DISK_CACHE_IO_SECTORS)
+        {
+            struct disk_cache_entry* entry = disk_cache_find(disk->id, lba + count);
+            if(!entry || !entry->dirty)
+            {
+                break;
+            }
+            memcpy(disk_cache_io_buffer + (count * CROSOS_SECTOR_SIZE), entry->data, CROSOS_SECTOR_SIZE);
+            count++;
+        }
+
+        if(!count)
+        {
+            return 0;
+        }
+
+        int32_t res = disk_write_uncached(disk, lba, count, disk_cache_io_buffer);
+        if(res < 0)
+        {
+            return res;
+        }
+
+        for(uint32_t i = 0; i < count; i++)
+        {
+            disk_cache_find(disk->id, lba + i)->dirty = false;
+        }
+        disk_cache_stats.dirty_entries -= count;
+        disk_cache_stats.writebacks += count;
+        lba += count;
+    }
+}
+
+//Writes a dirty entry to its disk, so it can be dropped
+static int32_t disk_cache_write_back(struct disk_cache_entry* entry)
+{
+    struct disk* disk = disk_get(entry->disk_id);
+    if(!disk)
+    {
+        return -EIO;
+    }
+
+    int32_t res = disk_write_uncached(disk, entry->lba, 1, entry->data);
+    if(res < 0)
+    {
+        return res;
+    }
+
+    entry->dirty = false;
+    disk_cache_stats.dirty_entries--;
+    disk_cache_stats.writebacks++;
+    return 0;
+}
+
+//Stores a copy of a sector, reusing the least recently used entry. A dirty entry is written back before it is reused
+static struct disk_cache_entry* disk_cache_insert(uint32_t disk_id, uint32_t lba, void* sector)
+{
+    struct disk_cache_entry* entry = disk_cache_lru_tail;
+    if(entry->valid)
+    {
+        if(entry->dirty && disk_cache_write_back(entry) < 0)
+        {
+            return 0;
+        }
+
+        disk_cache_hash_unlink(entry);
+        disk_cache_stats.evictions++;
+        disk_cache_stats.used_entries--;
+    }
+
+    entry->disk_id = disk_id;
+    entry->lba = lba;
+    entry->valid = true;
+    memcpy(entry->data, sector, CROSOS_SECTOR_SIZE);
+
+    struct disk_cache_entry** bucket = disk_cache_bucket(disk_id, lba);
+    entry->hash_next = *bucket;
+    *bucket = entry;
+    disk_cache_stats.used_entries++;
+
+    disk_cache_lru_unlink(entry);
+    disk_cache_lru_push(entry);
+    return entry;
+}
+
+//Reads 'total' sectors starting at 'lba'. Cached sectors are copied, every run of missing sectors is read from the disk with a single request
+int32_t disk_cache_read(struct disk* disk, uint32_t lba, uint32_t total, void* buff)
+{
+    if(!disk_cache_total_entries)
+    {
+        return disk_read_uncached(disk, lba, total, buff);
+    }
+
+    int32_t res = 0;
+    uint8_t* out = buff;
+    uint32_t i = 0;
+    task_mutex_lock(&disk_cache_lock);
+    while(i < total && res == 0)
+    {
+        struct disk_cache_entry* entry = disk_cache_find(disk->id, lba + i);
+        if(entry)
+        {
+            memcpy(out + (i * CROSOS_SECTOR_SIZE), entry->data, CROSOS_SECTOR_SIZE);
+            disk_cache_lru_unlink(entry);
+            disk_cache_lru_push(entry);
+            disk_cache_stats.hits++;
+            i++;
+            continue;
+        }
+
+        //Extend the miss until a cached sector or the end of the request
+        uint32_t run = 1;
+        while(i + run < total && !disk_cache_find(disk->id, lba + i + run))
+        {
+            run++;
+        }
+
+        task_mutex_unlock(&disk_cache_lock); //Other disks use the cache while this one reads
+        res = disk_read_uncached(disk, lba + i, run, out + (i * CROSOS_SECTOR_SIZE));
+        task_mutex_lock(&disk_cache_lock);
+        if(res < 0)
+        {
+            break;
+        }
+
+        //A write may have cached some of these sectors while the lock was released, its data is newer than the disk
+        for(uint32_t j = 0; j < run && res == 0; j++)
+        {
+            struct disk_cache_entry* written = disk_cache_find(disk->id, lba + i + j);
+            if(written)
+            {
+                memcpy(out + ((i + j) * CROSOS_SECTOR_SIZE), written->data, CROSOS_SECTOR_SIZE);
+                continue;
+            }
+
+            if(!disk_cache_insert(disk->id, lba + i + j, out + ((i + j) * CROSOS_SECTOR_SIZE)))
+            {
+                res = -EIO;
+            }
+        }
+        disk_cache_stats.misses += run;
+        i += run;
+    }
+
+    task_mutex_unlock(&disk_cache_lock);
+    return res;
+}
+
+//Reads sectors into the cache before they are used. Cached sectors are skipped and every missing run is a single disk request
+int32_t disk_cache_prefetch(struct disk* disk, uint32_t lba, uint32_t total)
+{
+    if(!disk_cache_total_entries)
+    {
+        return 0;
+    }
+
+    int32_t res = 0;
+    uint32_t i = 0;
+    task_mutex_lock(&disk_cache_lock);
+    while(i < total && res == 0)
+    {
+        if(disk_cache_find(disk->id, lba + i))
+        {
+            i++;
+            continue;
+        }
+
+        uint32_t run = 1;
+        while(i + run < total && run < DISK_CACHE_IO_SECTORS && !disk_cache_find(disk->id, lba + i + run))
+        {
+            run++;
+        }
+
+        res = disk_read_uncached(disk, lba + i, run, disk_cache_io_buffer);
+        for(uint32_t j = 0; j < run && res == 0; j++)
+        {
+            if(!disk_cache_insert(disk->id, lba + i + j, disk_cache_io_buffer + (j * CROSOS_SECTOR_SIZE)))
+            {
+                res = -EIO;
+            }
+        }
+        disk_cache_stats.prefetched += run;
+        i += run;
+    }
+
+    task_mutex_unlock(&disk_cache_lock);
+    return res;
+}
+
+//Writes 'total' sectors to the cache. They are marked dirty and written to the disk later
+int32_t disk_cache_write(struct disk* disk, uint32_t lba, uint32_t total, void* buff)
+{
+    if(!disk_cache_total_entries)
+    {
+        return disk_write_uncached(disk, lba, total, buff); //Write through without a cache
+    }
+
+    int32_t res = 0;
+    uint8_t* in = buff;
+    task_mutex_lock(&disk_cache_lock);
+    for(uint32_t i = 0; i < total; i++)
+    {
+        void* sector = in + (i * CROSOS_SECTOR_SIZE);
+        struct disk_cache_entry* entry = disk_cache_find(disk->id, lba + i);
+        if(entry)
+        {
+            memcpy(entry->data, sector, CROSOS_SECTOR_SIZE);
+            disk_cache_lru_unlink(entry);
+            disk_cache_lru_push(entry);
+        }
+        else
+        {
+            entry = disk_cache_insert(disk->id, lba + i, sector);
+            if(!entry)
+            {
+                res = -EIO;
+                break;
+            }
+        }
+
+        if(!entry->dirty)
+        {
+            entry->dirty = true;
+            disk_cache_stats.dirty_entries++;
+        }
+    }
+
+    task_mutex_unlock(&disk_cache_lock);
+    return res;
+}
+
+//Writes every dirty sector of a disk. Contiguous dirty sectors go in a single request
+int32_t disk_cache_flush(struct disk* disk)
+{
+    int32_t res = 0;
+    task_mutex_lock(&disk_cache_lock);
+    for(uint32_t i = 0; i < disk_cache_total_entries && disk_cache_stats.dirty_entries; i++)
+    {
+        struct disk_cache_entry* entry = &disk_cache_entries[i];
+        if(!entry->valid || !entry->dirty || entry->disk_id != disk->id)
+        {
+            continue;
+        }
+
+        //The run is written from its first sector
+        struct disk_cache_entry* previous = entry->lba ? disk_cache_find(disk->id, entry->lba - 1) : 0;
+        if(previous && previous->dirty)
+        {
+            continue;
+        }
+
+        res = disk_cache_write_run(disk, entry->lba);
+        if(res < 0)
+        {
+            break;
+        }
+    }
+
+    task_mutex_unlock(&disk_cache_lock);
+    return res;
+}
+
+//Drops the cached copies of a range of sectors, they are read again from the disk the next time. Dirty sectors are written first
+void disk_cache_invalidate(struct disk* disk, uint32_t lba, uint32_t total)
+{
+    task_mutex_lock(&disk_cache_lock);
+    for(uint32_t i = 0; i < total && disk_cache_total_entries; i++)
+    {
+        struct disk_cache_entry* entry = disk_cache_find(disk->id, lba + i);
+        if(!entry)
+        {
+            continue;
+        }
+
+        if(entry->dirty && disk_cache_write_back(entry) < 0)
+        {
+            continue; //Kept, so the data is not lost
+        }
+
+        disk_cache_hash_unlink(entry);
+        disk_cache_stats.used_entries--;
+
+        //Empty entries are reused first
+        disk_cache_lru_unlink(entry);
+        entry->lru_prev = disk_cache_lru_tail;
+        if(disk_cache_lru_tail)
+        {
+            disk_cache_lru_tail->lru_next = entry;
+        }
+        disk_cache_lru_tail = entry;
+        if(!disk_cache_lru_head)
+        {
+            disk_cache_lru_head = entry;
+        }
+    }
+    task_mutex_unlock(&disk_cache_lock);
+}
+
+//Returns the counters of the cache
+void disk_cache_get_stats(struct disk_cache_stats* stats)
+{
+    memcpy(stats, &disk_cache_stats, sizeof(struct disk_cache_stats));
+}
@@ -0,0 +1,43 @@
+#ifndef DISK_CACHE_H
+#define DISK_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define DISK_CACHE_IO_SECTORS 128 // Largest disk request issued by a prefetch or a write back
+
+//Cached copy of a sector of a disk
+struct disk_cache_entry
+{
+    uint32_t disk_id;
+    uint32_t lba;
+    bool valid; //Holds a sector, it is linked in the hash
+    bool dirty; //Written in memory only, it must be stored to the disk before it is reused
+    uint8_t* data; //Sector contents, inside the memory of the cache
+    struct disk_cache_entry* hash_next; //Next entry in the same hash bucket
+    struct disk_cache_entry* lru_prev; //More recently used entry
+    struct disk_cache_entry* lru_next; //Less recently used entry
+};
+
+struct disk_cache_stats
+{
+    uint32_t total_entries;
+    uint32_t used_entries;
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+    uint32_t prefetched; //Sectors read ahead of their use
+    uint32_t dirty_entries;
+    uint32_t writebacks; //Sectors written to the disk
+};
+
+struct disk;
+void disk_cache_init();
+int32_t disk_cache_read(struct disk* disk, uint32_t lba, uint32_t total, void* buff);
+int32_t disk_cache_prefetch(struct disk* disk, uint32_t lba, uint32_t total);
+int32_t disk_cache_write(struct disk* disk, uint32_t lba, uint32_t total, void* buff);
+int32_t disk_cache_flush(struct disk* disk);
+void disk_cache_invalidate(struct disk* disk, uint32_t lba, uint32_t total);
+void disk_cache_get_stats(struct disk_cache_stats* stats);
+
+#endif
@@ -1,70 +1,215 @@
-#include "io/io.h"
 #include "disk.h"
+#include "cache.h"
+#include "ata.h"
+#include "virtio_blk.h"
 #include "memory/memory.h"
+#include "memory/frame/kframe.h"
 #include "config.h"
 #include "status.h"
 
-struct disk disk;
+static struct disk disks[CROSOS_MAX_DISKS];
+static uint32_t disk_total = 0;
 
-//Same commands commented at boot.asm
-//The disk read is the main one, there is no implementation for other secondary disks
-uint32_t disk_read_sector(uint32_t lba, uint32_t total, void* buff)
+//Checks that a disk was registered
+static bool disk_is_registered(struct disk* idisk)
 {
-    outb(0x1F6, (lba >> 24) | 0xE0);
-    outb(0x1F2, total);
-    outb(0x1F3, (unsigned char) (lba & 0xff));
-    outb(0x1F4, (unsigned char) (lba >> 8));
-    outb(0x1F5, (unsigned char) (lba >> 16));
-    outb(0x1F7, 0x20);
-
-    unsigned short* ptr = (unsigned short*) buff;
-    for(int b = 0; b < total; b++)
-    {
-        //Wait for the buffer to be ready
-        char c = insb(0x1F7); //Read from the bus
-        while(!(c & 0x08))
-        {
-            c = insb(0x1F7); //Keep reading flag, when the flag is set, the contents can be read
-        }
-
-        //Copy from hard disk to memory
-        for(int i = 0; i < 256; i++)
-        {
-            *ptr = insw(0x1F0); //Reads the contents and stores them in the ptr that points to buff
-            ptr++;
-        }
-
-    }
-    return 0;
+    return idisk >= disks && idisk < disks + disk_total;
 }
 
-//Initializes a disk
+//Adds a disk found by a driver. Its id is the drive number of the paths, in the order the disks are found
+struct disk* disk_register(DISK_READ_FUNCTION read, DISK_WRITE_FUNCTION write, DISK_FLUSH_FUNCTION flush, uint32_t total_sectors, void* driver_private)
+{
+    if(disk_total >= CROSOS_MAX_DISKS)
+    {
+        return 0;
+    }
+
+    struct disk* disk = &disks[disk_total];
+    memset(disk, 0, sizeof(struct disk));
+    disk->type = CROSOS_DISK_TYPE_REAL;
+    disk->sector_size = CROSOS_SECTOR_SIZE;
+    disk->id = disk_total;
+    disk->total_sectors = total_sectors;
+    disk->read = read;
+    disk->write = write;
+    disk->flush = flush;
+    disk->driver_private = driver_private;
+    disk_total++;
+    return disk;
+}
+
+//Lets the drives complete their requests with an interrupt. Called once the IDT is loaded
+void disk_enable_interrupts()
+{
+    ata_enable_interrupts();
+    if(CROSOS_DISK_USE_VIRTIO)
+    {
+        virtio_blk_enable_interrupts();
+    }
+}
+
+//Finds the disks of every driver and the filesystem of each one
 void disk_search_and_init()
 {
-    memset(&disk, 0, sizeof(disk)); //Sets space in memory for the information of the used disk
-    disk.type = CROSOS_DISK_TYPE_REAL;
-    disk.sector_size = CROSOS_SECTOR_SIZE;
-    disk.id = 0;
-    disk.filesystem = fs_resolve(&disk); //Gets the filesystem of the disk
+    disk_cache_init(); //The filesystem reads its headers through the cache
+    ata_search_and_init();
+    if(CROSOS_DISK_USE_VIRTIO)
+    {
+        virtio_blk_search_and_init(); //After the IDE disks, an IDE boot disk keeps the drive number 0
+    }
+    for(uint32_t i = 0; i < disk_total; i++)
+    {
+        disks[i].filesystem = fs_resolve(&disks[i]); //Gets the filesystem of the disk
+    }
 }
 
-//Returns a disk given an index (currently only 0)
+//Returns a disk given an index, 0 if there is no such disk
 struct disk* disk_get(uint32_t index) 
 {
-    if (index != 0) //Only disk0 is implemented
+    if (index >= disk_total)
     {
         return 0;
     }
-    return &disk;
+    return &disks[index];
+}
+
+//Reads from the disk itself, skipping the sector cache
+int32_t disk_read_uncached(struct disk* idisk, uint32_t lba, uint32_t total, void* buff)
+{
+    if(!disk_is_registered(idisk))
+    {
+        return -EIO;
+    }
+
+    if(idisk->total_sectors && (lba >= idisk->total_sectors || total > idisk->total_sectors - lba))
+    {
+        return -EIO; //Past the end of the disk
+    }
+
+    return idisk->read(idisk, lba, total, buff); // Read with the driver of the disk
 }
 
-//Reads a disk block by an 'lba' given
+//Reads a disk block by an 'lba' given. Sectors already in the cache are not read again
 uint32_t disk_read_block(struct disk* idisk, uint32_t lba, uint32_t total, void* buff)
 {
-    if(idisk != &disk) //The only disk used is the global variable of this file
+    if(!disk_is_registered(idisk))
+    {
+        return -EIO;
+    }
+
+    return disk_cache_read(idisk, lba, total, buff);
+}
+
+//Writes to the disk itself, skipping the sector cache
+int32_t disk_write_uncached(struct disk* idisk, uint32_t lba, uint32_t total, void* buff)
+{
+    if(!disk_is_registered(idisk))
+    {
+        return -EIO;
+    }
+
+    if(idisk->total_sectors && (lba >= idisk->total_sectors || total > idisk->total_sectors - lba))
+    {
+        return -EIO;
+    }
+
+    idisk->write_pending = true;
+    return idisk->write(idisk, lba, total, buff);
+}
+
+//Writes a disk block. The sectors stay dirty in the cache until they are evicted or disk_sync is called
+int32_t disk_write_block(struct disk* idisk, uint32_t lba, uint32_t total, void* buff)
+{
+    if(!disk_is_registered(idisk))
     {
         return -EIO;
     }
 
-    return disk_read_sector(lba, total, buff); // Read sector for the function
-}
\ No newline at end of file
+    return disk_cache_write(idisk, lba, total, buff);
+}
+
+//Writes every dirty cached sector of the disk and flushes the cache of the drive
+int32_t disk_sync(struct disk* idisk)
+{
+    if(!disk_is_registered(idisk))
+    {
+        return -EIO;
+    }
+
+    int32_t res = disk_cache_flush(idisk);
+    if(res < 0 || !idisk->write_pending || !idisk->flush)
+    {
+        return res;
+    }
+
+    res = idisk->flush(idisk);
+    if(res == 0)
+    {
+        idisk->write_pending = false;
+    }
+    return res;
+}
+
+//Loads sectors that are about to be read into the sector cache
+int32_t disk_prefetch_block(struct disk* idisk, uint32_t lba, uint32_t total)
+{
+    if(!disk_is_registered(idisk))
+    {
+        return -EIO;
+    }
+
+    return disk_cache_prefetch(idisk, lba, total);
+}
+
+//Times transfers of the disk itself, without the sector cache, in requests of 'sectors_per_request'. It is the baseline of
+//the cached paths and compares the drivers. Runs are reads, unless CROSOS_DISK_BENCHMARK_WRITES is set for debugging: then
+//a write run first reads the sectors and writes the same contents back, then flushes the drive. A crash in the middle of
+//it can still corrupt the disk. The lock of the disk must be held, no filesystem call dirties the sectors meanwhile
+int32_t disk_benchmark(struct disk* idisk, struct disk_benchmark* bench)
+{
+    if(!disk_is_registered(idisk) || bench->total == 0 || bench->total > DISK_BENCHMARK_MAX_SECTORS ||
+        bench->sectors_per_request == 0 || bench->sectors_per_request > bench->total)
+    {
+        return -EINVARG;
+    }
+
+    if(bench->lba >= idisk->total_sectors || bench->total > idisk->total_sectors - bench->lba)
+    {
+        return -EINVARG; //Past the end of the disk, or a disk whose size is not known
+    }
+
+    if(bench->write && !CROSOS_DISK_BENCHMARK_WRITES)
+    {
+        return -EUNIMP;
+    }
+
+    uint8_t* buffer = kframe_alloc(bench->total * CROSOS_SECTOR_SIZE);
+    if(!buffer)
+    {
+        return -ENOMEM;
+    }
+
+    disk_cache_invalidate(idisk, bench->lba, bench->total); //Writes back the dirty sectors, the next cached reads are cold
+    int32_t res = 0;
+    if(bench->write)
+    {
+        res = disk_read_uncached(idisk, bench->lba, bench->total, buffer);
+    }
+
+    uint64_t start = memory_read_cycles();
+    for(uint32_t done = 0; done < bench->total && res == 0; done += bench->sectors_per_request)
+    {
+        uint32_t sectors = bench->total - done > bench->sectors_per_request ? bench->sectors_per_request : bench->total - done;
+        uint8_t* buff = buffer + done * CROSOS_SECTOR_SIZE;
+        res = bench->write ? disk_write_uncached(idisk, bench->lba + done, sectors, buff) : disk_read_uncached(idisk, bench->lba + done, sectors, buff);
+    }
+    if(res == 0 && bench->write && idisk->flush)
+    {
+        res = idisk->flush(idisk);
+        idisk->write_pending = res < 0;
+    }
+    bench->kcycles = (memory_read_cycles() - start) >> 10;
+
+    kframe_free(buffer);
+    return res;
+}
@@ -1,21 +1,60 @@
 #ifndef DISK_H
 #define DISK_H
 #include <stdint.h>
+#include <stdbool.h>
 #include "fs/file.h"
+#include "task/task.h"
 
 typedef uint32_t CROSOS_DISK_TYPE;
 
+struct disk;
+//Driver functions that read and write sectors of the disk itself
+typedef int32_t (*DISK_READ_FUNCTION)(struct disk* disk, uint32_t lba, uint32_t total, void* buff);
+typedef int32_t (*DISK_WRITE_FUNCTION)(struct disk* disk, uint32_t lba, uint32_t total, void* buff);
+//Makes the drive store the sectors kept in its own write cache
+typedef int32_t (*DISK_FLUSH_FUNCTION)(struct disk* disk);
+
+#define DISK_BENCHMARK_MAX_SECTORS 1024 // 512KB
+
+//A run of disk_benchmark asked by a process
+struct disk_benchmark
+{
+    uint32_t drive;
+    uint32_t write; //Not 0 to write back the sectors instead of reading them, only with CROSOS_DISK_BENCHMARK_WRITES
+    uint32_t lba;
+    uint32_t total; //Sectors
+    uint32_t sectors_per_request;
+    uint32_t kcycles; //Written by the kernel, in thousands (1024) of cycles
+};
+
 #define CROSOS_DISK_TYPE_REAL 0;
 struct disk
 {
     CROSOS_DISK_TYPE type;
     uint32_t sector_size;
     uint32_t id;
+    uint32_t total_sectors;
+    DISK_READ_FUNCTION read; //PIO or DMA, chosen when the disk is initialized
+    DISK_WRITE_FUNCTION write;
+    DISK_FLUSH_FUNCTION flush;
+    //Private data of the driver
+    void* driver_private;
+    bool write_pending; //Sectors written since the last flush of the drive cache
+    //Queue of the disk. Filesystem calls on it run one at a time, calls on other disks go on meanwhile
+    struct task_mutex lock;
     struct filesystem* filesystem;
     //Private data of the filesystem
     void* fs_private;
 };
 void disk_search_and_init();
+struct disk* disk_register(DISK_READ_FUNCTION read, DISK_WRITE_FUNCTION write, DISK_FLUSH_FUNCTION flush, uint32_t total_sectors, void* driver_private);
 struct disk* disk_get(uint32_t index);
 uint32_t disk_read_block(struct disk* idisk, uint32_t lba, uint32_t total, void* buff);
+int32_t disk_prefetch_block(struct disk* idisk, uint32_t lba, uint32_t total);
+int32_t disk_read_uncached(struct disk* idisk, uint32_t lba, uint32_t total, void* buff);
+int32_t disk_write_block(struct disk* idisk, uint32_t lba, uint32_t total, void* buff);
+int32_t disk_write_uncached(struct disk* idisk, uint32_t lba, uint32_t total, void* buff);
+int32_t disk_sync(struct disk* idisk);
+int32_t disk_benchmark(struct disk* idisk, struct disk_benchmark* bench);
+void disk_enable_interrupts();
 #endif
\ No newline at end of file
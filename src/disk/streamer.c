@@ -1,8 +1,12 @@
 #include "streamer.h"
 #include "memory/heap/kheap.h"
+#include "memory/heap/slab.h"
 #include "config.h"
+#include "memory/memory.h"
 #include <stdbool.h>
 
+static struct kmem_cache disk_stream_cache = KMEM_CACHE_INIT("disk_stream", sizeof(struct disk_stream));
+
 //Creates a new streamer
 struct disk_stream* diskstreamer_new(uint32_t disk_id)
 {
@@ -12,7 +16,11 @@ struct disk_stream* diskstreamer_new(uint32_t disk_id)
         return 0;
     }
 
-    struct disk_stream* streamer = kzalloc(sizeof(struct disk_stream));
+    struct disk_stream* streamer = kmem_cache_zalloc(&disk_stream_cache);
+    if(!streamer)
+    {
+        return 0;
+    }
     streamer->pos = 0; //Position initialized to 0
     streamer->disk = disk; //Disk found by the disk_id
     return streamer;
@@ -25,46 +33,120 @@ uint32_t diskstreamer_seek(struct disk_stream* stream, uint32_t pos)
     return 0;
 }
 
-//This function has a bug, if there is an offset and the data to be read + offset is higher than MAX_SIZE, we will read random data
+//Reads 'total' bytes from the position of the stream
+//Whole sectors are read straight to 'out', as many at once as the disk allows. Only a partial first or last sector goes through a temporary buffer
 uint32_t diskstreamer_read(struct disk_stream* stream, void* out, uint32_t total)
 {
-    uint32_t sector = stream->pos / CROSOS_SECTOR_SIZE; //Get sector from 'pos'
-    uint32_t offset = stream->pos % CROSOS_SECTOR_SIZE; //Get offset from 'pos'
-    uint32_t total_to_read = total;
-    bool overflow = (offset + total_to_read) >= CROSOS_SECTOR_SIZE;
-    char buff[CROSOS_SECTOR_SIZE]; //Create a temporary buffer of the sector to be read
-    
-    if(overflow)
+    int32_t res = 0;
+    char buff[CROSOS_SECTOR_SIZE]; //Temporary buffer for partial sectors
+    while(total > 0)
     {
-        total_to_read -= (offset + total_to_read) - CROSOS_SECTOR_SIZE;
-    }
-    
-    uint32_t res = disk_read_block(stream->disk, sector, 1, buff); //Read the entire sector to 'buff'
+        uint32_t sector = stream->pos / CROSOS_SECTOR_SIZE; //Get sector from 'pos'
+        uint32_t offset = stream->pos % CROSOS_SECTOR_SIZE; //Get offset from 'pos'
+        uint32_t total_to_read = 0;
+        if(offset == 0 && total >= CROSOS_SECTOR_SIZE)
+        {
+            //Aligned middle of the request
+            uint32_t sectors = total / CROSOS_SECTOR_SIZE;
+            if(sectors > DISKSTREAMER_MAX_SECTORS_PER_READ)
+            {
+                sectors = DISKSTREAMER_MAX_SECTORS_PER_READ;
+            }
 
-    if(res < 0)
-    {
-        goto out;
-    }
+            res = disk_read_block(stream->disk, sector, sectors, out);
+            if(res < 0)
+            {
+                break;
+            }
+            total_to_read = sectors * CROSOS_SECTOR_SIZE;
+        }
+        else
+        {
+            //Partial sector, copy the wanted bytes from the temporary buffer
+            total_to_read = CROSOS_SECTOR_SIZE - offset;
+            if(total_to_read > total)
+            {
+                total_to_read = total;
+            }
 
-    for(int i = 0; i < total_to_read; i++)
-    {
-        *(char*) out++ = buff[offset+i]; //Start copying from the offset stated in the position
+            res = disk_read_block(stream->disk, sector, 1, buff); //Read the entire sector to 'buff'
+            if(res < 0)
+            {
+                break;
+            }
+            memcpy(out, buff + offset, total_to_read);
+        }
+
+        //Adjust the stream
+        out += total_to_read;
+        total -= total_to_read;
+        stream->pos += total_to_read; //Update the position in the streamer
     }
 
-    //Adjust the stream
-    stream->pos += total_to_read; //Update the position in the streamer
-    if(overflow)
+    return res;
+}
+
+//Writes 'total' bytes at the position of the stream
+//Whole sectors are written straight from 'in'. A partial first or last sector is read, modified and written back
+uint32_t diskstreamer_write(struct disk_stream* stream, const void* in, uint32_t total)
+{
+    int32_t res = 0;
+    char buff[CROSOS_SECTOR_SIZE]; //Temporary buffer for partial sectors
+    while(total > 0)
     {
-        //If more than a sector has to be read, call again the function decreasing the total data that is needed to be read
-        res = diskstreamer_read(stream, out, total-total_to_read);
+        uint32_t sector = stream->pos / CROSOS_SECTOR_SIZE;
+        uint32_t offset = stream->pos % CROSOS_SECTOR_SIZE;
+        uint32_t total_to_write = 0;
+        if(offset == 0 && total >= CROSOS_SECTOR_SIZE)
+        {
+            //Aligned middle of the request
+            uint32_t sectors = total / CROSOS_SECTOR_SIZE;
+            if(sectors > DISKSTREAMER_MAX_SECTORS_PER_READ)
+            {
+                sectors = DISKSTREAMER_MAX_SECTORS_PER_READ;
+            }
+
+            res = disk_write_block(stream->disk, sector, sectors, (void*) in);
+            if(res < 0)
+            {
+                break;
+            }
+            total_to_write = sectors * CROSOS_SECTOR_SIZE;
+        }
+        else
+        {
+            //Partial sector, the rest of its bytes are kept
+            total_to_write = CROSOS_SECTOR_SIZE - offset;
+            if(total_to_write > total)
+            {
+                total_to_write = total;
+            }
+
+            res = disk_read_block(stream->disk, sector, 1, buff);
+            if(res < 0)
+            {
+                break;
+            }
+            memcpy(buff + offset, (void*) in, total_to_write);
+
+            res = disk_write_block(stream->disk, sector, 1, buff);
+            if(res < 0)
+            {
+                break;
+            }
+        }
+
+        //Adjust the stream
+        in += total_to_write;
+        total -= total_to_write;
+        stream->pos += total_to_write;
     }
 
-out:
     return res;
 }
 
 //Frees the streamer from allocated memory
 void diskstreamer_close(struct disk_stream* stream) 
 {
-    kfree(stream);
+    kmem_cache_free(&disk_stream_cache, stream);
 }
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include "disk.h"
 #include <stdint.h>
 
+#define DISKSTREAMER_MAX_SECTORS_PER_READ 255 // Sector count register of the ATA controller is 8 bits
+
 struct disk_stream
 {
     uint32_t pos; //Position of the disk that is wanted to be read
@@ -13,6 +15,7 @@ struct disk_stream
 struct disk_stream* diskstreamer_new(uint32_t disk_id);
 uint32_t diskstreamer_seek(struct disk_stream* stream, uint32_t pos);
 uint32_t diskstreamer_read(struct disk_stream* stream, void* out, uint32_t total);
+uint32_t diskstreamer_write(struct disk_stream* stream, const void* in, uint32_t total);
 void diskstreamer_close(struct disk_stream* stream);
 
 #endif
\ No newline at end of file
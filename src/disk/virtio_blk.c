@@ -0,0 +1,421 @@
+#include "virtio_blk.h"
+#include "disk.h"
+#include "io/io.h"
+#include "io/pci.h"
+#include "io/pit.h"
+#include "idt/idt.h"
+#include "config.h"
+#include "status.h"
+#include "memory/memory.h"
+#include "memory/heap/kheap.h"
+#include "memory/frame/kframe.h"
+
+static struct virtio_blk_device* virtio_blk_devices[CROSOS_MAX_DISKS];
+static uint32_t virtio_blk_total = 0;
+
+//Rounds 'value' up to the virtqueue alignment
+static uint32_t virtio_blk_align(uint32_t value)
+{
+    return (value + VIRTQ_ALIGN - 1) & ~(VIRTQ_ALIGN - 1);
+}
+
+//Every virtio-blk device shares the handler, the devices whose queue raised the interrupt wake up their task
+static void virtio_blk_interrupt_handler()
+{
+    for(uint32_t i = 0; i < virtio_blk_total; i++)
+    {
+        struct virtio_blk_device* device = virtio_blk_devices[i];
+        if(insb(device->io_base + VIRTIO_REG_ISR_STATUS) & VIRTIO_ISR_QUEUE) //Reading the ISR status also lowers the interrupt line
+        {
+            task_wakeup(&device->wait_queue);
+        }
+    }
+}
+
+//Waits until the device finishes at least one more request. Other tasks run meanwhile if the interrupt is enabled
+static int32_t virtio_blk_wait(struct virtio_blk_device* device)
+{
+    if(device->irq_enabled)
+    {
+        while(device->used->idx == device->last_used)
+        {
+            task_sleep(&device->wait_queue);
+        }
+        return 0;
+    }
+
+    struct pit_timer timer;
+    pit_timer_start(&timer, VIRTIO_BLK_POLL_TIMEOUT_MS);
+    while(device->used->idx == device->last_used)
+    {
+        if(pit_timer_expired(&timer))
+        {
+            return -EIO;
+        }
+    }
+    return 0;
+}
+
+//Takes a descriptor from the free list
+static uint16_t virtio_blk_alloc_desc(struct virtio_blk_device* device)
+{
+    uint16_t index = device->free_head;
+    device->free_head = device->desc[index].next;
+    device->free_total--;
+    return index;
+}
+
+//Fills a descriptor with a buffer. Kernel memory is identity mapped, so its address is the physical one
+static void virtio_blk_set_desc(struct virtio_blk_device* device, uint16_t index, volatile void* buff, uint32_t length, uint16_t flags)
+{
+    volatile struct virtq_desc* desc = &device->desc[index];
+    desc->address_low = (uint32_t) buff;
+    desc->address_high = 0;
+    desc->length = length;
+    desc->flags = flags;
+    desc->next = 0;
+}
+
+//Adds a descriptor after 'last' in a chain
+static uint16_t virtio_blk_chain_desc(struct virtio_blk_device* device, uint16_t last, volatile void* buff, uint32_t length, uint16_t flags)
+{
+    uint16_t index = virtio_blk_alloc_desc(device);
+    virtio_blk_set_desc(device, index, buff, length, flags);
+    device->desc[last].flags |= VIRTQ_DESC_F_NEXT;
+    device->desc[last].next = index;
+    return index;
+}
+
+//Puts a request in the available ring: a chain of the header, the data split in segments and the status byte
+//The device is not notified, so several requests go to it at once. Returns false when the free descriptors are not enough yet
+static bool virtio_blk_queue_request(struct virtio_blk_device* device, uint32_t type, uint32_t lba, uint32_t total, uint8_t* buff)
+{
+    uint32_t bytes = total * CROSOS_SECTOR_SIZE;
+    uint32_t segments = (bytes + device->segment_size - 1) / device->segment_size;
+    if(device->free_total < segments + 2)
+    {
+        return false;
+    }
+
+    uint16_t head = virtio_blk_alloc_desc(device);
+    volatile struct virtio_blk_request* request = &device->requests[head];
+    request->header.type = type;
+    request->header.reserved = 0;
+    request->header.sector_low = lba;
+    request->header.sector_high = 0;
+    request->status = 0xFF; //The device writes VIRTIO_BLK_S_OK or an error
+    request->descriptors = segments + 2;
+    virtio_blk_set_desc(device, head, &request->header, sizeof(struct virtio_blk_header), 0);
+
+    uint16_t last = head;
+    uint16_t data_flags = type == VIRTIO_BLK_T_IN ? VIRTQ_DESC_F_WRITE : 0;
+    while(bytes > 0)
+    {
+        uint32_t length = bytes > device->segment_size ? device->segment_size : bytes;
+        last = virtio_blk_chain_desc(device, last, buff, length, data_flags);
+        buff += length;
+        bytes -= length;
+    }
+    virtio_blk_chain_desc(device, last, &request->status, 1, VIRTQ_DESC_F_WRITE);
+
+    //The rings are volatile, the device sees the index move only after the chain is written
+    device->avail->ring[device->avail->idx % device->queue_size] = head;
+    device->avail->idx++;
+    return true;
+}
+
+//Gives the chains of the finished requests back to the free list. Returns -EIO if the device failed one of them
+static int32_t virtio_blk_reclaim(struct virtio_blk_device* device, uint32_t* in_flight)
+{
+    int32_t res = 0;
+    while(device->last_used != device->used->idx)
+    {
+        uint16_t head = device->used->ring[device->last_used % device->queue_size].id;
+        volatile struct virtio_blk_request* request = &device->requests[head];
+        if(request->status != VIRTIO_BLK_S_OK)
+        {
+            res = -EIO;
+        }
+
+        uint16_t tail = head;
+        for(uint16_t i = 1; i < request->descriptors; i++)
+        {
+            tail = device->desc[tail].next;
+        }
+        device->desc[tail].next = device->free_head;
+        device->free_head = head;
+        device->free_total += request->descriptors;
+        device->last_used++;
+        (*in_flight)--;
+    }
+    return res;
+}
+
+//Allocates the memory of virtqueue 0: the descriptor table and the available ring, then the used ring in the next aligned page
+static int32_t virtio_blk_alloc_queue(struct virtio_blk_device* device)
+{
+    uint32_t size = device->queue_size;
+    uint32_t used_offset = virtio_blk_align(sizeof(struct virtq_desc) * size + sizeof(uint16_t) * (3 + size));
+    uint32_t used_size = virtio_blk_align(sizeof(uint16_t) * 3 + sizeof(struct virtq_used_elem) * size);
+    device->queue_memory = kframe_zalloc(used_offset + used_size); //Physically contiguous and page aligned
+    device->requests = kzalloc(sizeof(struct virtio_blk_request) * size);
+    if(!device->queue_memory || !device->requests)
+    {
+        return -ENOMEM;
+    }
+
+    device->queue_bytes = used_offset + used_size;
+    device->desc = device->queue_memory;
+    device->avail = (struct virtq_avail*) ((uint8_t*) device->queue_memory + sizeof(struct virtq_desc) * size);
+    device->used = (struct virtq_used*) ((uint8_t*) device->queue_memory + used_offset);
+    return 0;
+}
+
+//Empties virtqueue 0, every descriptor is free, and gives its memory to the device
+static void virtio_blk_setup_queue(struct virtio_blk_device* device)
+{
+    memset(device->queue_memory, 0, device->queue_bytes);
+    for(uint32_t i = 0; i < device->queue_size; i++)
+    {
+        device->desc[i].next = i + 1;
+    }
+    device->free_head = 0;
+    device->free_total = device->queue_size;
+    device->last_used = 0;
+
+    outw(device->io_base + VIRTIO_REG_QUEUE_SELECT, 0);
+    outl(device->io_base + VIRTIO_REG_QUEUE_ADDRESS, (uint32_t) device->queue_memory / VIRTQ_ALIGN);
+}
+
+//Resets the device and tells it a driver was found. The device forgets its features and its queue and stops
+static void virtio_blk_reset(struct virtio_blk_device* device)
+{
+    outb(device->io_base + VIRTIO_REG_DEVICE_STATUS, 0x00);
+    outb(device->io_base + VIRTIO_REG_DEVICE_STATUS, VIRTIO_STATUS_ACKNOWLEDGE);
+    outb(device->io_base + VIRTIO_REG_DEVICE_STATUS, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER);
+}
+
+//Brings back a device that stopped answering, with an empty queue. The requests in flight are dropped, their transfer fails
+static void virtio_blk_restart(struct virtio_blk_device* device)
+{
+    virtio_blk_reset(device);
+    outl(device->io_base + VIRTIO_REG_GUEST_FEATURES, device->features); //The features negotiated when the device was set up
+    virtio_blk_setup_queue(device);
+    outb(device->io_base + VIRTIO_REG_DEVICE_STATUS, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER | VIRTIO_STATUS_DRIVER_OK);
+}
+
+//Moves 'total' sectors between the disk and 'buff'. The transfer is split in requests that are in flight together,
+//the queue is refilled as the device finishes them
+static int32_t virtio_blk_transfer(struct virtio_blk_device* device, uint32_t type, uint32_t lba, uint32_t total, uint8_t* buff)
+{
+    int32_t res = 0;
+    uint32_t in_flight = 0;
+    task_mutex_lock(&device->lock);
+    while(total > 0 || in_flight > 0)
+    {
+        bool queued = false;
+        while(total > 0)
+        {
+            uint32_t sectors = total > device->request_sectors ? device->request_sectors : total;
+            if(!virtio_blk_queue_request(device, type, lba, sectors, buff))
+            {
+                break;
+            }
+            queued = true;
+            in_flight++;
+            lba += sectors;
+            buff += sectors * CROSOS_SECTOR_SIZE;
+            total -= sectors;
+        }
+
+        if(queued)
+        {
+            outw(device->io_base + VIRTIO_REG_QUEUE_NOTIFY, 0);
+        }
+
+        res = virtio_blk_wait(device);
+        if(res < 0)
+        {
+            virtio_blk_restart(device); //The requests in flight are dropped, the next transfer gets an empty queue
+            break;
+        }
+
+        res = virtio_blk_reclaim(device, &in_flight);
+        if(res < 0)
+        {
+            total = 0; //Nothing else is queued, the requests in flight are still reclaimed
+        }
+    }
+    task_mutex_unlock(&device->lock);
+    return res;
+}
+
+static int32_t virtio_blk_read(struct disk* disk, uint32_t lba, uint32_t total, void* buff)
+{
+    return virtio_blk_transfer(disk->driver_private, VIRTIO_BLK_T_IN, lba, total, buff);
+}
+
+static int32_t virtio_blk_write(struct disk* disk, uint32_t lba, uint32_t total, void* buff)
+{
+    struct virtio_blk_device* device = disk->driver_private;
+    if(device->features & VIRTIO_BLK_F_RO)
+    {
+        return -ERDONLY;
+    }
+    return virtio_blk_transfer(device, VIRTIO_BLK_T_OUT, lba, total, buff);
+}
+
+//Asks the host to store the writes of the device. Without the flush feature the writes are already stored when they end
+static int32_t virtio_blk_flush(struct disk* disk)
+{
+    struct virtio_blk_device* device = disk->driver_private;
+    if(!(device->features & VIRTIO_BLK_F_FLUSH))
+    {
+        return 0;
+    }
+
+    int32_t res = 0;
+    uint32_t in_flight = 1;
+    task_mutex_lock(&device->lock);
+    virtio_blk_queue_request(device, VIRTIO_BLK_T_FLUSH, 0, 0, 0); //The queue is empty between transfers
+    outw(device->io_base + VIRTIO_REG_QUEUE_NOTIFY, 0);
+    res = virtio_blk_wait(device);
+    if(res < 0)
+    {
+        virtio_blk_restart(device);
+    }
+    else
+    {
+        res = virtio_blk_reclaim(device, &in_flight);
+    }
+    task_mutex_unlock(&device->lock);
+    return res;
+}
+
+//Sets the largest segment and request from the limits the device offers and the size of the queue
+static void virtio_blk_set_limits(struct virtio_blk_device* device)
+{
+    uint32_t request_bytes = VIRTIO_BLK_REQUEST_SECTORS * CROSOS_SECTOR_SIZE;
+    device->segment_size = request_bytes;
+    if(device->features & VIRTIO_BLK_F_SIZE_MAX)
+    {
+        uint32_t size_max = insl(device->io_base + VIRTIO_REG_BLK_SIZE_MAX) & ~(CROSOS_SECTOR_SIZE - 1);
+        if(size_max && size_max < device->segment_size)
+        {
+            device->segment_size = size_max;
+        }
+    }
+
+    uint32_t segments = device->queue_size - 2; //The header and the status take a descriptor each
+    if(device->features & VIRTIO_BLK_F_SEG_MAX)
+    {
+        uint32_t seg_max = insl(device->io_base + VIRTIO_REG_BLK_SEG_MAX);
+        if(seg_max && seg_max < segments)
+        {
+            segments = seg_max;
+        }
+    }
+
+    if(segments * device->segment_size < request_bytes)
+    {
+        request_bytes = segments * device->segment_size;
+    }
+    device->request_sectors = request_bytes / CROSOS_SECTOR_SIZE;
+}
+
+//Brings a device up through the legacy interface: reset, feature negotiation, queue setup and DRIVER_OK
+static int32_t virtio_blk_init_device(struct pci_device* pci, struct virtio_blk_device* device)
+{
+    uint32_t bar0 = pci_config_read(pci, PCI_CONFIG_BAR0);
+    if(!(bar0 & 0x01))
+    {
+        return -EIO; //The legacy registers are in I/O space
+    }
+
+    uint32_t command = pci_config_read(pci, PCI_CONFIG_COMMAND) & 0xFFFF;
+    pci_config_write(pci, PCI_CONFIG_COMMAND, command | PCI_COMMAND_IO_SPACE | PCI_COMMAND_BUS_MASTER); //The device reads and writes the queues in memory
+    device->io_base = bar0 & PCI_BAR_IO_MASK;
+    device->irq = pci_config_read(pci, PCI_CONFIG_INTERRUPT_LINE) & 0xFF;
+
+    uint16_t io_base = device->io_base;
+    virtio_blk_reset(device);
+    device->features = insl(io_base + VIRTIO_REG_DEVICE_FEATURES) & (VIRTIO_BLK_F_SIZE_MAX | VIRTIO_BLK_F_SEG_MAX | VIRTIO_BLK_F_RO | VIRTIO_BLK_F_FLUSH);
+    outl(io_base + VIRTIO_REG_GUEST_FEATURES, device->features);
+
+    outw(io_base + VIRTIO_REG_QUEUE_SELECT, 0);
+    device->queue_size = insw(io_base + VIRTIO_REG_QUEUE_SIZE);
+    if(device->queue_size < 3)
+    {
+        return -EIO; //No queue, or one that cannot hold a request with data
+    }
+
+    int32_t res = virtio_blk_alloc_queue(device);
+    if(res < 0)
+    {
+        return res;
+    }
+    virtio_blk_setup_queue(device);
+    virtio_blk_set_limits(device);
+
+    uint32_t capacity_high = insl(io_base + VIRTIO_REG_BLK_CAPACITY + 4);
+    device->total_sectors = capacity_high ? 0xFFFFFFFF : insl(io_base + VIRTIO_REG_BLK_CAPACITY); //Sectors past 32 bits cannot be addressed
+    outb(io_base + VIRTIO_REG_DEVICE_STATUS, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER | VIRTIO_STATUS_DRIVER_OK);
+    return 0;
+}
+
+//Marks a device that could not be used as failed and frees its driver data
+static void virtio_blk_free_device(struct virtio_blk_device* device)
+{
+    if(device->io_base)
+    {
+        outb(device->io_base + VIRTIO_REG_DEVICE_STATUS, VIRTIO_STATUS_FAILED);
+    }
+    if(device->queue_memory)
+    {
+        kframe_free(device->queue_memory);
+    }
+    if(device->requests)
+    {
+        kfree((void*) device->requests);
+    }
+    kfree(device);
+}
+
+//Finds the virtio-blk functions in the PCI bus and registers a disk for each one. They are polled until virtio_blk_enable_interrupts
+void virtio_blk_search_and_init()
+{
+    struct pci_device pci;
+    for(uint32_t index = 0; virtio_blk_total < CROSOS_MAX_DISKS && pci_find_device(VIRTIO_PCI_VENDOR, VIRTIO_PCI_DEVICE_BLK, index, &pci) == 0; index++)
+    {
+        struct virtio_blk_device* device = kzalloc(sizeof(struct virtio_blk_device));
+        if(!device)
+        {
+            return;
+        }
+
+        if(virtio_blk_init_device(&pci, device) < 0 ||
+            !disk_register(virtio_blk_read, virtio_blk_write, virtio_blk_flush, device->total_sectors, device))
+        {
+            virtio_blk_free_device(device); //It is not used again
+            continue;
+        }
+        virtio_blk_devices[virtio_blk_total++] = device;
+    }
+}
+
+//Lets the devices raise their interrupts instead of being polled. Called once the IDT is loaded
+void virtio_blk_enable_interrupts()
+{
+    for(uint32_t i = 0; i < virtio_blk_total; i++)
+    {
+        struct virtio_blk_device* device = virtio_blk_devices[i];
+        if(device->irq == 0 || device->irq == 2 || device->irq >= 16)
+        {
+            continue; //No interrupt line routed to the PICs, the device keeps being polled
+        }
+
+        idt_register_interrupt_callback(0x20 + device->irq, virtio_blk_interrupt_handler);
+        idt_enable_irq(device->irq);
+        device->irq_enabled = true;
+    }
+}
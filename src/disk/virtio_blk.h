@@ -0,0 +1,128 @@
+#ifndef VIRTIO_BLK_H
+#define VIRTIO_BLK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "task/task.h"
+
+#define VIRTIO_PCI_VENDOR 0x1AF4
+#define VIRTIO_PCI_DEVICE_BLK 0x1001 // Legacy (transitional) block device
+
+//Registers of the legacy interface, relative to the I/O space of BAR0
+#define VIRTIO_REG_DEVICE_FEATURES 0x00
+#define VIRTIO_REG_GUEST_FEATURES 0x04
+#define VIRTIO_REG_QUEUE_ADDRESS 0x08 // Page number of the queue memory
+#define VIRTIO_REG_QUEUE_SIZE 0x0C
+#define VIRTIO_REG_QUEUE_SELECT 0x0E
+#define VIRTIO_REG_QUEUE_NOTIFY 0x10
+#define VIRTIO_REG_DEVICE_STATUS 0x12
+#define VIRTIO_REG_ISR_STATUS 0x13 // Reading it acknowledges the interrupt
+#define VIRTIO_REG_BLK_CAPACITY 0x14 // 64 bit, in sectors of 512 bytes
+#define VIRTIO_REG_BLK_SIZE_MAX 0x1C
+#define VIRTIO_REG_BLK_SEG_MAX 0x20
+
+#define VIRTIO_STATUS_ACKNOWLEDGE 0x01
+#define VIRTIO_STATUS_DRIVER 0x02
+#define VIRTIO_STATUS_DRIVER_OK 0x04
+#define VIRTIO_STATUS_FAILED 0x80
+
+#define VIRTIO_ISR_QUEUE 0x01
+
+#define VIRTIO_BLK_F_SIZE_MAX (1 << 1) // Largest segment of a request
+#define VIRTIO_BLK_F_SEG_MAX (1 << 2) // Most segments in a request
+#define VIRTIO_BLK_F_RO (1 << 5)
+#define VIRTIO_BLK_F_FLUSH (1 << 9)
+
+#define VIRTIO_BLK_T_IN 0
+#define VIRTIO_BLK_T_OUT 1
+#define VIRTIO_BLK_T_FLUSH 4
+#define VIRTIO_BLK_S_OK 0
+
+#define VIRTQ_DESC_F_NEXT 0x01
+#define VIRTQ_DESC_F_WRITE 0x02 // The device writes the buffer
+#define VIRTQ_ALIGN 4096 // Alignment of the used ring and of the queue memory in the legacy interface
+
+#define VIRTIO_BLK_REQUEST_SECTORS 128 // Largest request (64KB), larger transfers are split in several requests in flight
+#define VIRTIO_BLK_POLL_TIMEOUT_MS 30000 // Time a polled device has to finish a request before it is reset
+
+//Buffer of a descriptor chain
+struct virtq_desc
+{
+    uint32_t address_low;
+    uint32_t address_high;
+    uint32_t length;
+    uint16_t flags;
+    uint16_t next;
+}__attribute__((packed));
+
+//Heads of the chains given to the device
+struct virtq_avail
+{
+    uint16_t flags;
+    uint16_t idx;
+    uint16_t ring[];
+}__attribute__((packed));
+
+struct virtq_used_elem
+{
+    uint32_t id; //Head of the chain
+    uint32_t length;
+}__attribute__((packed));
+
+//Chains the device finished
+struct virtq_used
+{
+    uint16_t flags;
+    uint16_t idx;
+    struct virtq_used_elem ring[];
+}__attribute__((packed));
+
+//First buffer of every request
+struct virtio_blk_header
+{
+    uint32_t type;
+    uint32_t reserved;
+    uint32_t sector_low;
+    uint32_t sector_high;
+}__attribute__((packed));
+
+//A request in flight, found by the head descriptor of its chain. The device reads the header and writes the status
+struct virtio_blk_request
+{
+    struct virtio_blk_header header;
+    uint8_t status;
+    uint16_t descriptors; //Length of the chain, given back to the free list when the request ends
+}__attribute__((packed));
+
+//Driver data of a virtio-blk disk
+struct virtio_blk_device
+{
+    uint16_t io_base;
+    uint8_t irq; //Interrupt line from the PCI configuration. 0, 2 and 16 or more mean no line to the PICs, the device is polled
+    uint32_t features;
+    uint32_t total_sectors;
+
+    //Split virtqueue 0, the only one of the device
+    uint16_t queue_size;
+    void* queue_memory;
+    uint32_t queue_bytes;
+    volatile struct virtq_desc* desc;
+    volatile struct virtq_avail* avail;
+    volatile struct virtq_used* used;
+    volatile struct virtio_blk_request* requests;
+    uint16_t free_head; //Free descriptors are chained by their next field
+    uint16_t free_total;
+    uint16_t last_used; //Used ring entries up to here were reclaimed
+
+    uint32_t segment_size; //Largest data buffer of a descriptor
+    uint32_t request_sectors; //Largest request, so its chain fits in the queue and in the segment limit
+
+    bool irq_enabled;
+    struct task_wait_queue wait_queue;
+    struct task_mutex lock; //One transfer at a time, its requests are in flight together
+};
+
+void virtio_blk_search_and_init();
+void virtio_blk_enable_interrupts();
+
+#endif
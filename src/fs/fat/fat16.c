@@ -7,11 +7,21 @@
 #include "memory/memory.h"
 #include "kernel.h"
 #include "memory/heap/kheap.h"
+#include "memory/heap/slab.h"
 
 #define CROSOS_FAT16_SIGNATURE 0x29
 #define CROSOS_FAT16_FAT_ENTRY_SIZE 0x02
-#define CROSOS_FAT16_BAD_SECTOR 0xFF7
+#define CROSOS_FAT16_BAD_SECTOR 0xFFF7
+#define CROSOS_FAT16_RESERVED_START 0xFFF0 //Values from here to the bad sector mark are reserved
+#define CROSOS_FAT16_END_OF_CHAIN 0xFFF8 //This and higher values mark the last cluster of a file
 #define CROSOS_FAT16_UNUSED 0x00
+#define CROSOS_FAT16_LAST_CLUSTER 0xFFFF //Written to the FAT entry of the last cluster of a chain
+#define CROSOS_FAT16_DELETED_ITEM 0xE5 //First byte of the name of a deleted directory entry
+
+#define FAT16_DENTRY_ROOT_CLUSTER 0 //Parent cluster used for the items of the root directory
+#define FAT16_DENTRY_NAME_SIZE 13 //8.3 name, dot and terminator
+#define FAT16_DENTRY_BUCKETS 32
+#define FAT16_INDEX_END 0xFFFFFFFF //End of a chain of the name index of a directory
 
 typedef uint32_t FAT_ITEM_TYPE;
 #define FAT_ITEM_TYPE_DIRECTORY 0
@@ -93,6 +103,10 @@ struct fat_directory
     uint32_t sector_pos;
     uint32_t ending_sector_pos;
 
+    //Hash index of the item names, built on the first lookup
+    uint32_t* index_buckets; //First item of every bucket
+    uint32_t* index_next; //Next item in the same bucket, for every item
+    uint32_t index_total_buckets; //Power of two
 };
 
 //An item may be a file or a directory. It includes the directory structure and its type
@@ -106,11 +120,65 @@ struct fat_item
     FAT_ITEM_TYPE type;
 };
 
+//Run of clusters that are contiguous on disk
+struct fat_extent
+{
+    uint32_t file_cluster; //Index of the first cluster of the run inside the file
+    uint32_t cluster; //First cluster of the run on disk
+    uint32_t total_clusters;
+};
+
+//Cluster chain of an item, as a sorted list of contiguous runs
+struct fat_extent_map
+{
+    struct fat_extent* extents;
+    uint32_t total;
+};
+
 //Descriptor of the item. Includes a position and all the info of the directory
 struct fat_file_descriptor
 {
     struct fat_item* item;
     uint32_t pos;
+    struct fat_extent_map extent_map; //Built on the first read of the file
+
+    //Sequential read detection
+    uint32_t readahead_next; //Offset where the last read ended, a read starting here is sequential
+    uint32_t readahead_window; //Clusters read ahead, doubles while the reads stay sequential
+    uint32_t readahead_end; //First cluster of the file after the prefetched ones
+
+    //Files opened for writing or appending
+    FILE_MODE mode;
+    struct disk* disk;
+    uint32_t parent_cluster; //Directory of the file, FAT16_DENTRY_ROOT_CLUSTER for the root
+    uint32_t item_pos; //Absolute position of the directory entry on the disk, it identifies the file. Set for readers too
+    bool dirty; //The size or the first cluster changed, the directory entry is written on close or sync
+    struct fat_file_descriptor* next_writer; //Next open file of the disk with write access
+
+    //Readers whose file cannot be opened for writing while they are open, such as the image of a running program
+    bool deny_write;
+    struct fat_file_descriptor* next_denied;
+};
+
+//Result of a path component lookup, kept so later opens do not read the directory again
+struct fat_dentry
+{
+    bool valid;
+    bool negative; //The name does not exist in the parent directory
+    uint32_t parent_cluster;
+    char name[FAT16_DENTRY_NAME_SIZE]; //Lower case
+    struct fat_directory_item item; //Copy of the directory entry, when it exists
+    uint32_t item_pos; //Absolute position of the directory entry on the disk
+    struct fat_dentry* next; //Next entry in the same hash bucket
+};
+
+//Bounded cache of path component lookups. Entries are reused in a round robin
+struct fat_dentry_cache
+{
+    struct fat_dentry entries[CROSOS_FAT16_DENTRY_CACHE_ENTRIES];
+    struct fat_dentry* buckets[FAT16_DENTRY_BUCKETS];
+    uint32_t next_victim;
+    struct fat16_dentry_stats stats;
 };
 
 //Private headers for internal FAT16 routines
@@ -125,11 +193,34 @@ struct fat_private
     struct disk_stream* fat_read_stream;
     //Used in situation where we stream the directory
     struct disk_stream* directory_stream;
+
+    //First copy of the file allocation table, loaded once so cluster chains are followed in memory
+    uint16_t* fat_table;
+    uint32_t fat_total_entries;
+
+    //Cluster allocation, kept in memory. Changed FAT sectors are written on close or sync
+    uint8_t* cluster_bitmap; //A bit per cluster, set when it is in use
+    uint32_t total_clusters; //Clusters of the data area, plus the two reserved entries
+    uint32_t next_free_cluster; //Where the search of a free cluster starts
+    uint8_t* fat_dirty_sectors; //A bit per sector of the FAT changed since the last write
+    bool fat_dirty;
+    struct fat_file_descriptor* writers; //Open files with pending directory entry updates
+    struct fat_file_descriptor* write_denied; //Open files that cannot be written meanwhile
+
+    struct fat_dentry_cache dentry_cache;
 };
 
+static struct kmem_cache fat_directory_item_cache = KMEM_CACHE_INIT("fat_directory_item", sizeof(struct fat_directory_item));
+static struct kmem_cache fat_directory_cache = KMEM_CACHE_INIT("fat_directory", sizeof(struct fat_directory));
+static struct kmem_cache fat_item_cache = KMEM_CACHE_INIT("fat_item", sizeof(struct fat_item));
+static struct kmem_cache fat_file_descriptor_cache = KMEM_CACHE_INIT("fat_file_descriptor", sizeof(struct fat_file_descriptor));
+
 uint32_t fat16_resolve(struct disk* disk);
 void* fat16_open(struct disk* disk, struct path_part* path, FILE_MODE mode);
 uint32_t fat16_read(struct disk* disk, void* descriptor, uint32_t size, uint32_t nmemb, char* out_ptr);
+uint32_t fat16_write(struct disk* disk, void* descriptor, uint32_t size, uint32_t nmemb, const char* in_ptr);
+uint32_t fat16_sync(struct disk* disk);
+int32_t fat16_deny_write(struct disk* disk, void* private);
 uint32_t fat16_seek(void* private, uint32_t offset, FILE_SEEK_MODE seek_mode);
 uint32_t fat16_stat(struct disk* disk, void* private, struct file_stat* stat);
 uint32_t fat16_close(void* private);
@@ -142,7 +233,10 @@ struct filesystem fat16_fs =
     .read = fat16_read,
     .seek = fat16_seek,
     .stat = fat16_stat,
-    .close = fat16_close
+    .close = fat16_close,
+    .write = fat16_write,
+    .sync = fat16_sync,
+    .deny_write = fat16_deny_write
 }; 
 
 //Returns the instantiated struct
@@ -167,7 +261,7 @@ uint32_t fat16_sector_to_absolute(struct disk* disk, uint32_t sector)
     return sector * disk->sector_size;
 }
 
-//Get the number of items for a given directory
+//Get the number of entries for a given directory, up to the end marker. Deleted entries are counted, so the items keep their position
 uint32_t fat16_get_total_items_for_directory(struct disk* disk, uint32_t directory_start_sector)
 {
     struct fat_directory_item item;
@@ -202,11 +296,6 @@ uint32_t fat16_get_total_items_for_directory(struct disk* disk, uint32_t directo
             break;
         }
 
-        if(item.file_name[0] == 0xE5) //Item unused
-        {
-            continue;
-        }
-
         i++;
     }
 
@@ -271,6 +360,94 @@ err:
     return res;
 }
 
+//Gets the first fat sector
+static uint32_t fat16_get_first_fat_sector(struct fat_private* private)
+{
+    return private->header.primary_header.reserved_sectors; //Returns the position of the FAT table
+}
+
+//Loads the first file allocation table into memory
+static int32_t fat16_load_fat_table(struct disk* disk, struct fat_private* fat_private)
+{
+    int32_t res = 0;
+    uint32_t fat_size = fat_private->header.primary_header.sectors_per_fat * disk->sector_size;
+    uint16_t* fat_table = kmalloc(fat_size);
+    if(!fat_table)
+    {
+        res = -ENOMEM;
+        goto out;
+    }
+
+    struct disk_stream* stream = fat_private->fat_read_stream;
+    if(diskstreamer_seek(stream, fat16_get_first_fat_sector(fat_private) * disk->sector_size) != CROSOS_ALL_OK)
+    {
+        res = -EIO;
+        goto out;
+    }
+
+    if(diskstreamer_read(stream, fat_table, fat_size) != CROSOS_ALL_OK)
+    {
+        res = -EIO;
+        goto out;
+    }
+
+    fat_private->fat_table = fat_table;
+    fat_private->fat_total_entries = fat_size / CROSOS_FAT16_FAT_ENTRY_SIZE;
+
+out:
+    if(res < 0 && fat_table)
+    {
+        kfree(fat_table);
+    }
+    return res;
+}
+
+//Marks the clusters in use from the FAT loaded in memory, so free clusters are found without reading the disk
+static int32_t fat16_load_allocation_state(struct disk* disk, struct fat_private* fat_private)
+{
+    struct fat_header* header = &fat_private->header.primary_header;
+    uint32_t total_sectors = header->number_of_sectors ? header->number_of_sectors : header->sectors_big; //The big count is used above 65535 sectors
+    uint32_t data_start = fat_private->root_directory.ending_sector_pos;
+    uint32_t total_clusters = 2; //Entries 0 and 1 of the FAT are reserved
+    if(total_sectors > data_start)
+    {
+        total_clusters += (total_sectors - data_start) / header->sectors_per_cluster;
+    }
+    if(total_clusters > fat_private->fat_total_entries)
+    {
+        total_clusters = fat_private->fat_total_entries;
+    }
+
+    uint8_t* cluster_bitmap = kzalloc((total_clusters + 7) / 8);
+    uint8_t* fat_dirty_sectors = kzalloc((header->sectors_per_fat + 7) / 8);
+    if(!cluster_bitmap || !fat_dirty_sectors)
+    {
+        if(cluster_bitmap)
+        {
+            kfree(cluster_bitmap);
+        }
+        if(fat_dirty_sectors)
+        {
+            kfree(fat_dirty_sectors);
+        }
+        return -ENOMEM;
+    }
+
+    for(uint32_t cluster = 0; cluster < total_clusters; cluster++)
+    {
+        if(cluster < 2 || fat_private->fat_table[cluster] != CROSOS_FAT16_UNUSED)
+        {
+            cluster_bitmap[cluster / 8] |= 1 << (cluster % 8);
+        }
+    }
+
+    fat_private->cluster_bitmap = cluster_bitmap;
+    fat_private->fat_dirty_sectors = fat_dirty_sectors;
+    fat_private->total_clusters = total_clusters;
+    fat_private->next_free_cluster = 2;
+    return 0;
+}
+
 //Figures if the disk is using FAT16
 uint32_t fat16_resolve(struct disk* disk) 
 {
@@ -297,6 +474,7 @@ uint32_t fat16_resolve(struct disk* disk)
     if(fat_private->header.shared.extended_header.signature != 0x29)
     {
         res = -EFSNOTUS;
+        goto out;
     }
 
     //Gets the root directory of the FAT filesystem, from the headers already parsed to 'fat_private' and set it to '&fat_private->root_directory'
@@ -306,6 +484,20 @@ uint32_t fat16_resolve(struct disk* disk)
         goto out;
     }
 
+    //Cluster chains are followed from memory from now on
+    res = fat16_load_fat_table(disk, fat_private);
+    if(res < 0)
+    {
+        goto out;
+    }
+
+    //Free clusters for the writes
+    res = fat16_load_allocation_state(disk, fat_private);
+    if(res < 0)
+    {
+        goto out;
+    }
+
 out:
     if(stream)
     {
@@ -313,6 +505,35 @@ out:
     }
     if(res < 0)
     {
+        if(fat_private->fat_table)
+        {
+            kfree(fat_private->fat_table);
+        }
+        if(fat_private->cluster_bitmap)
+        {
+            kfree(fat_private->cluster_bitmap);
+        }
+        if(fat_private->fat_dirty_sectors)
+        {
+            kfree(fat_private->fat_dirty_sectors);
+        }
+        if(fat_private->root_directory.item)
+        {
+            kfree(fat_private->root_directory.item);
+        }
+        //The streamers created by fat16_init_private
+        if(fat_private->cluster_read_stream)
+        {
+            diskstreamer_close(fat_private->cluster_read_stream);
+        }
+        if(fat_private->fat_read_stream)
+        {
+            diskstreamer_close(fat_private->fat_read_stream);
+        }
+        if(fat_private->directory_stream)
+        {
+            diskstreamer_close(fat_private->directory_stream);
+        }
         kfree(fat_private);
         disk->fs_private = 0;
     }
@@ -358,11 +579,11 @@ struct fat_directory_item* fat16_clone_directory_item(struct fat_directory_item*
 {
     
     struct fat_directory_item* item_copy = 0;
-    if(size < sizeof(struct fat_directory_item))
+    if(size != sizeof(struct fat_directory_item)) //Copies come from the item cache
     {
         return 0;
     }
-    item_copy = kzalloc(size);
+    item_copy = kmem_cache_alloc(&fat_directory_item_cache);
     if(!item_copy)
     {
         return 0;
@@ -386,300 +607,1125 @@ static uint32_t fat16_cluster_to_sector(struct fat_private* private, uint32_t cl
     return private->root_directory.ending_sector_pos + ((cluster - 2) * private->header.primary_header.sectors_per_cluster);
 }
 
-//Gets the first fat sector
-static uint32_t fat16_get_first_fat_sector(struct fat_private* private)
-{
-    return private->header.primary_header.reserved_sectors; //Returns the position of the FAT table
-}
-
-//Reads a fat entry
+//Reads a fat entry from the table loaded in memory
 static uint32_t fat16_get_fat_entry(struct disk* disk, uint32_t cluster)
 {
-    uint32_t res = -1;
     struct fat_private* private = disk->fs_private;
-    struct disk_stream* stream = private->fat_read_stream;
-    if(!stream)
+    if(!private->fat_table || cluster >= private->fat_total_entries)
     {
-        goto out;
-    }
-    //Get FAT table position in disk
-    uint32_t fat_table_position = fat16_get_first_fat_sector(private) * disk->sector_size;
-    //Set the streamer to the position where the cluster we want to read is
-    res = diskstreamer_seek(stream, fat_table_position * (cluster * CROSOS_FAT16_FAT_ENTRY_SIZE));
-    if(res < 0)
-    {
-        goto out;
+        return CROSOS_FAT16_BAD_SECTOR; //Outside of the table, the chain is broken
     }
 
-    uint16_t result = 0;
-    //Read the cluster entry on the table (2 bytes)
-    res = diskstreamer_read(stream, &result, sizeof(result));
-    if(res < 0)
-    {
-        goto out;
-    }
+    return private->fat_table[cluster];
+}
 
-    res = result;
+//Checks if a FAT entry links to a following cluster, instead of ending the chain or marking a bad or reserved cluster
+static bool fat16_is_next_cluster(uint32_t entry)
+{
+    return entry >= 0x02 && entry < CROSOS_FAT16_RESERVED_START;
+}
 
-out:
-    return res;
+//Returns true if the cluster is in use or outside of the data area
+static bool fat16_cluster_used(struct fat_private* private, uint32_t cluster)
+{
+    if(cluster >= private->total_clusters)
+    {
+        return true;
+    }
+    return private->cluster_bitmap[cluster / 8] & (1 << (cluster % 8));
 }
 
-//Gets the cluster that we need to read given an offset
-static uint32_t fat16_get_cluster_for_offset(struct disk* disk, uint32_t starting_cluster, uint32_t offset)
+//Changes a FAT entry in memory. Its sector of the FAT is written on the next sync
+static void fat16_set_fat_entry(struct disk* disk, uint32_t cluster, uint16_t value)
 {
-    uint32_t res = 0;
     struct fat_private* private = disk->fs_private;
-    uint32_t size_of_cluster_bytes = private->header.primary_header.sectors_per_cluster * disk->sector_size;
-    uint32_t cluster_to_use = starting_cluster;
-    uint32_t clusters_ahead = offset / size_of_cluster_bytes; // If the offset is higher than a cluster size, we will have to look for another cluster than the starting one
-    for(uint32_t i = 0; i < clusters_ahead; i++)
+    if(cluster >= private->total_clusters)
     {
-        //Entry gives the next cluster to read in the FAT or an error flag
-        uint32_t entry = fat16_get_fat_entry(disk, cluster_to_use); //Gets the entry on the FAT table of the cluster we want to read
-
-        //Check that the sector read is correct
-        if(entry == 0xFF8 || entry == 0xFFF)
-        {
-            //Last entry in the file
-            res = -EIO;
-            goto out;
-        }
-
-        // Sector is marked
-        if(entry == CROSOS_FAT16_BAD_SECTOR)
-        {
-            res = -EIO;
-            goto out;
-        }
-
-        //Reserved sectors
-        if(entry == 0xFF0 || entry == 0xFF6)
-        {
-            res = -EIO;
-            goto out;
-        }
-
-        if(entry == 0x00)
-        {
-            res = -EIO;
-            goto out;
-        }
-
-        cluster_to_use = entry; //Set sector to returned value or to the next iteration value. By this, we can follow the FAT map to get the cluster we need to read
+        return;
     }
 
-    res = cluster_to_use;
+    private->fat_table[cluster] = value;
+    if(value == CROSOS_FAT16_UNUSED)
+    {
+        private->cluster_bitmap[cluster / 8] &= ~(1 << (cluster % 8));
+    }
+    else
+    {
+        private->cluster_bitmap[cluster / 8] |= 1 << (cluster % 8);
+    }
 
-out:
-    return res;
+    uint32_t sector = (cluster * CROSOS_FAT16_FAT_ENTRY_SIZE) / disk->sector_size;
+    private->fat_dirty_sectors[sector / 8] |= 1 << (sector % 8);
+    private->fat_dirty = true;
 }
 
-//Reads a file
-static uint32_t fat16_read_internal_from_stream(struct disk* disk, struct disk_stream* stream, uint32_t cluster, uint32_t offset, uint32_t total, void* out)
+//Takes a free cluster and links it after 'previous', or starts a chain if it is 0
+//The cluster that follows 'previous' is preferred, so the files stay contiguous
+static uint32_t fat16_allocate_cluster(struct disk* disk, uint32_t previous)
 {
-    uint32_t res = 0;
     struct fat_private* private = disk->fs_private;
-    uint32_t size_of_cluster_bytes = private->header.primary_header.sectors_per_cluster * disk->sector_size; //Get cluster size
-    uint32_t cluster_to_use = fat16_get_cluster_for_offset(disk, cluster, offset); //Considers offset to maybe increment the reading cluster
-    if(cluster_to_use < 0) //No cluster found
+    uint32_t cluster = 0;
+    if(previous && !fat16_cluster_used(private, previous + 1))
     {
-        res = cluster_to_use;
-        goto out;
+        cluster = previous + 1;
     }
 
-    uint32_t offset_from_cluster = offset % size_of_cluster_bytes; //Gets the offset from the gotten cluster
-
-    uint32_t starting_sector = fat16_cluster_to_sector(private, cluster_to_use); //Gets the sector from the cluster
-    uint32_t starting_pos = (starting_sector * disk->sector_size) + offset_from_cluster; //Starting position for streamer
-    uint32_t total_to_read = total > size_of_cluster_bytes ? size_of_cluster_bytes : total; //Max total to read is the size of a cluster.
-    res = diskstreamer_seek(stream, starting_pos); //Sets the starting position to the streamer
-    if(res != CROSOS_ALL_OK)
+    uint32_t data_clusters = private->total_clusters - 2;
+    for(uint32_t i = 0; !cluster && i < data_clusters; i++)
     {
-        goto out;
+        uint32_t candidate = 2 + ((private->next_free_cluster - 2 + i) % data_clusters);
+        if(!fat16_cluster_used(private, candidate))
+        {
+            cluster = candidate;
+        }
     }
 
-    res = diskstreamer_read(stream, out, total_to_read); //Reads the desired data of the sectors (2 max)
-    if(res != CROSOS_ALL_OK)
+    if(!cluster)
     {
-        goto out;
+        return 0; //The disk is full
     }
 
-    total -= total_to_read;
-    if(total > 0) //Still left to read
+    fat16_set_fat_entry(disk, cluster, CROSOS_FAT16_LAST_CLUSTER);
+    if(previous)
     {
-        //Repeat operation, modifying the offset, the 'out' and providing an already modified total
-        res = fat16_read_internal_from_stream(disk, stream, cluster, offset + total_to_read, total, out + total_to_read);
+        fat16_set_fat_entry(disk, previous, cluster);
     }
 
-out:
-    return res;
+    private->next_free_cluster = cluster + 1 < private->total_clusters ? cluster + 1 : 2;
+    return cluster;
 }
 
-//Reads the contents from a cluster to the total size wanted to be read
-static uint32_t fat16_read_internal(struct disk* disk, uint32_t stating_cluster, uint32_t offset, uint32_t total, void* out)
+//Returns the clusters of a chain to the free ones
+static void fat16_free_cluster_chain(struct disk* disk, uint32_t cluster)
 {
-    struct fat_private* fs_private = disk->fs_private;
-    struct disk_stream* stream = fs_private->cluster_read_stream; //Get the cluster reader stream
-    //Return the reading of all the clusters that we need to read to access the file
-    return fat16_read_internal_from_stream(disk, stream, stating_cluster, offset, total, out);
+    struct fat_private* private = disk->fs_private;
+    for(uint32_t i = 0; fat16_is_next_cluster(cluster) && i < private->total_clusters; i++) //Bounded to stop on loops
+    {
+        uint32_t next = fat16_get_fat_entry(disk, cluster);
+        fat16_set_fat_entry(disk, cluster, CROSOS_FAT16_UNUSED);
+        if(cluster < private->next_free_cluster)
+        {
+            private->next_free_cluster = cluster;
+        }
+        cluster = next;
+    }
+}
 
+//Returns true if a sector of the FAT changed since it was written
+static bool fat16_fat_sector_dirty(struct fat_private* private, uint32_t sector)
+{
+    return private->fat_dirty_sectors[sector / 8] & (1 << (sector % 8));
 }
 
-//Frees a loaded directory
-void fat16_free_directory(struct fat_directory* directory)
+//Writes the changed sectors of the FAT to every copy of the table. Contiguous sectors go in a single write
+static int32_t fat16_flush_fat(struct disk* disk)
 {
-    if(!directory)
+    struct fat_private* private = disk->fs_private;
+    if(!private->fat_dirty)
     {
-        return;
+        return 0;
     }
 
-    if(directory->item)
+    struct fat_header* header = &private->header.primary_header;
+    uint32_t sector = 0;
+    while(sector < header->sectors_per_fat)
     {
-        kfree(directory->item);
+        if(!fat16_fat_sector_dirty(private, sector))
+        {
+            sector++;
+            continue;
+        }
+
+        uint32_t run = 1;
+        while(sector + run < header->sectors_per_fat && fat16_fat_sector_dirty(private, sector + run))
+        {
+            run++;
+        }
+
+        void* data = (uint8_t*) private->fat_table + (sector * disk->sector_size);
+        for(uint32_t copy = 0; copy < header->fat_copies; copy++)
+        {
+            int32_t res = disk_write_block(disk, fat16_get_first_fat_sector(private) + (copy * header->sectors_per_fat) + sector, run, data);
+            if(res < 0)
+            {
+                return res;
+            }
+        }
+
+        for(uint32_t i = 0; i < run; i++)
+        {
+            private->fat_dirty_sectors[(sector + i) / 8] &= ~(1 << ((sector + i) % 8));
+        }
+        sector += run;
     }
 
-    kfree(directory);
+    private->fat_dirty = false;
+    return 0;
 }
 
-//Frees a generic fat item
-void fat16_fat_item_free(struct fat_item* item)
+//Returns the absolute disk position of the entry number 'index' of a directory, or 0 if the directory is shorter
+//'cluster' is the first cluster of the directory, or FAT16_DENTRY_ROOT_CLUSTER for the root
+static uint32_t fat16_directory_item_position(struct disk* disk, uint32_t cluster, uint32_t index)
 {
-    if(item->type == FAT_ITEM_TYPE_DIRECTORY)
+    struct fat_private* private = disk->fs_private;
+    uint32_t offset = index * sizeof(struct fat_directory_item);
+    if(cluster == FAT16_DENTRY_ROOT_CLUSTER)
     {
-        fat16_free_directory(item->directory);
+        if(index >= private->header.primary_header.root_dir_entries)
+        {
+            return 0;
+        }
+        return (private->root_directory.sector_pos * disk->sector_size) + offset;
     }
-    else if(item->type == FAT_ITEM_TYPE_FILE)
+
+    uint32_t size_of_cluster_bytes = private->header.primary_header.sectors_per_cluster * disk->sector_size;
+    for(uint32_t i = offset / size_of_cluster_bytes; i > 0; i--)
     {
-        kfree(item->item);
+        cluster = fat16_get_fat_entry(disk, cluster);
+        if(!fat16_is_next_cluster(cluster))
+        {
+            return 0;
+        }
     }
 
-    kfree(item);
+    return (fat16_cluster_to_sector(private, cluster) * disk->sector_size) + (offset % size_of_cluster_bytes);
 }
 
-//Returns a directory from 
-struct fat_directory* fat16_load_fat_directory(struct disk* disk, struct fat_directory_item* item)
+//Walks the cluster chain that starts at 'first_cluster' once and stores it as runs of contiguous clusters
+static int32_t fat16_build_extent_map(struct disk* disk, uint32_t first_cluster, struct fat_extent_map* map)
 {
-    uint32_t res = 0;
-    struct fat_directory* directory = 0;
-    struct fat_private* fat_private = disk->fs_private;
-    if(!(item->attribute & FAT_FILE_SUBDIRECTORY)) //We dont want a file
-    {
-        res = -EINVARG;
-        goto out;
-    }
-    //Allocate the returned directory
-    directory = kzalloc(sizeof(struct fat_directory));
-    if(!directory)
+    struct fat_private* private = disk->fs_private;
+    map->extents = 0;
+    map->total = 0;
+    if(!fat16_is_next_cluster(first_cluster))
     {
-        res = -ENOMEM;
-        goto out;
+        return -EIO;
     }
 
-    uint32_t cluster = fat16_get_first_cluster(item); //Get first cluster of the item
-    uint32_t cluster_sector = fat16_cluster_to_sector(fat_private, cluster); //Change the cluster to sector
-    uint32_t total_items = fat16_get_total_items_for_directory(disk, cluster_sector); //Sets the total items in the directory
-    directory->total = total_items; //Assigns the value to the returned directory
-    uint32_t directory_size = directory->total * sizeof(struct fat_directory_item); 
-    directory->item = kzalloc(directory_size); //Asigns memory for all the items in the directory + the directory struct itself
-    if(!directory->item)
+    //First pass counts the runs, so the list is allocated once. The chain length is bounded to stop on loops
+    uint32_t total_extents = 1;
+    uint32_t total_clusters = 1;
+    uint32_t cluster = first_cluster;
+    uint32_t entry = fat16_get_fat_entry(disk, cluster);
+    while(fat16_is_next_cluster(entry) && total_clusters < private->fat_total_entries)
     {
-        res = -ENOMEM;
-        goto out;
+        if(entry != cluster + 1)
+        {
+            total_extents++;
+        }
+        cluster = entry;
+        entry = fat16_get_fat_entry(disk, cluster);
+        total_clusters++;
     }
 
-    //All the data is stored to directory->item
-    res = fat16_read_internal(disk, cluster, 0x00, directory_size, directory->item);
-    if(res != CROSOS_ALL_OK)
+    struct fat_extent* extents = kzalloc(sizeof(struct fat_extent) * total_extents);
+    if(!extents)
     {
-        goto out;
+        return -ENOMEM;
     }
 
-out:
-    if(res != CROSOS_ALL_OK)
+    uint32_t current = 0;
+    extents[0].file_cluster = 0;
+    extents[0].cluster = first_cluster;
+    extents[0].total_clusters = 1;
+    cluster = first_cluster;
+    for(uint32_t i = 1; i < total_clusters; i++)
     {
-        fat16_free_directory(directory); //Error, we dont want the space for the created directory anymore
+        entry = fat16_get_fat_entry(disk, cluster);
+        if(entry != cluster + 1)
+        {
+            current++; //Not contiguous, a new run starts
+            extents[current].file_cluster = i;
+            extents[current].cluster = entry;
+        }
+        extents[current].total_clusters++;
+        cluster = entry;
     }
-    return directory;
+
+    map->extents = extents;
+    map->total = total_extents;
+    return 0;
 }
 
-//Creates a new item to be treated from the data in 'item', to avoid memory issues, since item is not allocated
-struct fat_item* fat16_new_fat_item_for_directory_item(struct disk* disk, struct fat_directory_item* item)
+//Frees the runs of an extent map
+static void fat16_free_extent_map(struct fat_extent_map* map)
 {
-    //Allocates the new item in memory
-    struct fat_item* f_item = kzalloc(sizeof(struct fat_item));
-    if(!f_item)
+    if(map->extents)
     {
-        return 0;
+        kfree(map->extents);
     }
+    map->extents = 0;
+    map->total = 0;
+}
 
-    if(item->attribute & FAT_FILE_SUBDIRECTORY) //Directory case
+//Binary search of the run that holds the cluster number 'file_cluster' of the file. Returns 0 if the file is shorter
+static struct fat_extent* fat16_find_extent(struct fat_extent_map* map, uint32_t file_cluster)
+{
+    uint32_t low = 0;
+    uint32_t high = map->total;
+    while(low < high)
     {
-        f_item->directory = fat16_load_fat_directory(disk, item); //Get the directory from the 'item'
-        f_item->type = FAT_ITEM_TYPE_DIRECTORY;
+        uint32_t middle = low + (high - low) / 2;
+        struct fat_extent* extent = &map->extents[middle];
+        if(file_cluster < extent->file_cluster)
+        {
+            high = middle;
+        }
+        else if(file_cluster >= extent->file_cluster + extent->total_clusters)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            return extent;
+        }
+    }
+    return 0;
+}
+
+//Reads 'total' bytes from 'offset' of an item whose cluster chain is mapped
+//Every run of contiguous clusters is fetched with a single streamer read straight to 'out'
+static uint32_t fat16_read_internal_from_stream(struct disk* disk, struct disk_stream* stream, struct fat_extent_map* map, uint32_t offset, uint32_t total, void* out)
+{
+    int32_t res = 0;
+    struct fat_private* private = disk->fs_private;
+    uint32_t size_of_cluster_bytes = private->header.primary_header.sectors_per_cluster * disk->sector_size; //Get cluster size
+    while(total > 0)
+    {
+        uint32_t file_cluster = offset / size_of_cluster_bytes; //Cluster of the file that holds the offset
+        struct fat_extent* extent = fat16_find_extent(map, file_cluster);
+        if(!extent) //The chain ends before the offset
+        {
+            res = -EIO;
+            break;
+        }
+
+        uint32_t cluster_to_use = extent->cluster + (file_cluster - extent->file_cluster);
+        uint32_t offset_from_cluster = offset % size_of_cluster_bytes; //Gets the offset from the gotten cluster
+        uint32_t starting_sector = fat16_cluster_to_sector(private, cluster_to_use); //Gets the sector from the cluster
+        uint32_t starting_pos = (starting_sector * disk->sector_size) + offset_from_cluster; //Starting position for streamer
+
+        //Everything up to the end of the run can be read at once
+        uint32_t run_end = (extent->file_cluster + extent->total_clusters) * size_of_cluster_bytes;
+        uint32_t total_to_read = run_end - offset;
+        if(total_to_read > total)
+        {
+            total_to_read = total;
+        }
+
+        res = diskstreamer_seek(stream, starting_pos); //Sets the starting position to the streamer
+        if(res != CROSOS_ALL_OK)
+        {
+            break;
+        }
+
+        res = diskstreamer_read(stream, out, total_to_read);
+        if(res != CROSOS_ALL_OK)
+        {
+            break;
+        }
+
+        offset += total_to_read;
+        out += total_to_read;
+        total -= total_to_read;
+    }
+
+    return res;
+}
+
+//Prefetches the clusters that follow a sequential read of a file into the sector cache
+//The next reads are served from memory, and the disk gets one big request per window instead of one per read
+static void fat16_read_ahead(struct disk* disk, struct fat_file_descriptor* desc, uint32_t offset, uint32_t total)
+{
+    struct fat_private* private = disk->fs_private;
+    uint32_t sectors_per_cluster = private->header.primary_header.sectors_per_cluster;
+    uint32_t size_of_cluster_bytes = sectors_per_cluster * disk->sector_size;
+    if(offset != desc->readahead_next) //Random access, stop reading ahead until the reads are sequential again
+    {
+        desc->readahead_next = offset + total;
+        desc->readahead_window = 0;
+        desc->readahead_end = 0;
+        return;
+    }
+    desc->readahead_next = offset + total;
+
+    uint32_t next_cluster = (offset + total + size_of_cluster_bytes - 1) / size_of_cluster_bytes; //First cluster after the read
+    if(next_cluster < desc->readahead_end)
+    {
+        return; //Still inside the last window
+    }
+
+    uint32_t max_window = CROSOS_FAT16_READAHEAD_MAX_SECTORS / sectors_per_cluster;
+    if(max_window == 0)
+    {
+        max_window = 1;
+    }
+
+    uint32_t window = desc->readahead_window ? desc->readahead_window * 2 : CROSOS_FAT16_READAHEAD_MIN_CLUSTERS;
+    if(window > max_window)
+    {
+        window = max_window;
+    }
+    desc->readahead_window = window;
+
+    uint32_t file_cluster = next_cluster > desc->readahead_end ? next_cluster : desc->readahead_end;
+    uint32_t end_cluster = next_cluster + window;
+    while(file_cluster < end_cluster)
+    {
+        struct fat_extent* extent = fat16_find_extent(&desc->extent_map, file_cluster);
+        if(!extent) //End of the file
+        {
+            break;
+        }
+
+        uint32_t run_end = extent->file_cluster + extent->total_clusters;
+        if(run_end > end_cluster)
+        {
+            run_end = end_cluster;
+        }
+
+        uint32_t cluster = extent->cluster + (file_cluster - extent->file_cluster);
+        if(disk_prefetch_block(disk, fat16_cluster_to_sector(private, cluster), (run_end - file_cluster) * sectors_per_cluster) < 0)
+        {
+            break; //Errors are reported by the read that needs the sectors
+        }
+        file_cluster = run_end;
+    }
+    desc->readahead_end = end_cluster;
+}
+
+//Reads the contents of an item whose cluster chain is already mapped
+static uint32_t fat16_read_mapped(struct disk* disk, struct fat_extent_map* map, uint32_t offset, uint32_t total, void* out)
+{
+    struct fat_private* fs_private = disk->fs_private;
+    struct disk_stream* stream = fs_private->cluster_read_stream; //Get the cluster reader stream
+    //Return the reading of all the clusters that we need to read to access the file
+    return fat16_read_internal_from_stream(disk, stream, map, offset, total, out);
+}
+
+//Reads the contents from a cluster to the total size wanted to be read
+static uint32_t fat16_read_internal(struct disk* disk, uint32_t stating_cluster, uint32_t offset, uint32_t total, void* out)
+{
+    struct fat_extent_map map;
+    int32_t res = fat16_build_extent_map(disk, stating_cluster, &map); //Only used for this read
+    if(res < 0)
+    {
+        return res;
+    }
+
+    res = fat16_read_mapped(disk, &map, offset, total, out);
+    fat16_free_extent_map(&map);
+    return res;
+}
+
+//Links new clusters to the end of an open file until it can hold 'size' bytes. The extent map of the file is kept up to date
+static int32_t fat16_extend_file(struct disk* disk, struct fat_file_descriptor* desc, uint32_t size)
+{
+    struct fat_private* private = disk->fs_private;
+    struct fat_directory_item* item = desc->item->item;
+    struct fat_extent_map* map = &desc->extent_map;
+    uint32_t size_of_cluster_bytes = private->header.primary_header.sectors_per_cluster * disk->sector_size;
+    if(!map->extents && fat16_is_next_cluster(fat16_get_first_cluster(item)))
+    {
+        int32_t res = fat16_build_extent_map(disk, fat16_get_first_cluster(item), map);
+        if(res < 0)
+        {
+            return res;
+        }
+    }
+
+    uint32_t needed = (size + size_of_cluster_bytes - 1) / size_of_cluster_bytes;
+    struct fat_extent* last = map->total ? &map->extents[map->total - 1] : 0;
+    uint32_t total_clusters = last ? last->file_cluster + last->total_clusters : 0;
+    while(total_clusters < needed)
+    {
+        uint32_t previous = last ? last->cluster + last->total_clusters - 1 : 0;
+        uint32_t cluster = fat16_allocate_cluster(disk, previous);
+        if(!cluster)
+        {
+            return -ENOSPC;
+        }
+
+        if(!previous) //Empty file, the directory entry points to its first cluster now
+        {
+            item->high_16_bits_first_cluster = 0;
+            item->low_16_bits_first_cluster = cluster;
+            desc->dirty = true;
+        }
+
+        if(last && cluster == previous + 1)
+        {
+            last->total_clusters++; //Contiguous, the last run grows
+        }
+        else
+        {
+            struct fat_extent* extents = kzalloc(sizeof(struct fat_extent) * (map->total + 1));
+            if(!extents)
+            {
+                return -ENOMEM; //The cluster stays linked to the file, the map is built again from the chain
+            }
+            if(map->extents)
+            {
+                memcpy(extents, map->extents, sizeof(struct fat_extent) * map->total);
+                kfree(map->extents);
+            }
+            extents[map->total].file_cluster = total_clusters;
+            extents[map->total].cluster = cluster;
+            extents[map->total].total_clusters = 1;
+            map->extents = extents;
+            map->total++;
+            last = &map->extents[map->total - 1];
+        }
+        total_clusters++;
+    }
+    return 0;
+}
+
+//Writes 'total' bytes at 'offset' of an item whose cluster chain is mapped and long enough
+//Every run of contiguous clusters is written with a single streamer write
+static int32_t fat16_write_mapped(struct disk* disk, struct fat_extent_map* map, uint32_t offset, uint32_t total, const void* in)
+{
+    int32_t res = 0;
+    struct fat_private* private = disk->fs_private;
+    struct disk_stream* stream = private->cluster_read_stream;
+    uint32_t size_of_cluster_bytes = private->header.primary_header.sectors_per_cluster * disk->sector_size;
+    while(total > 0)
+    {
+        uint32_t file_cluster = offset / size_of_cluster_bytes;
+        struct fat_extent* extent = fat16_find_extent(map, file_cluster);
+        if(!extent)
+        {
+            res = -EIO;
+            break;
+        }
+
+        uint32_t cluster_to_use = extent->cluster + (file_cluster - extent->file_cluster);
+        uint32_t starting_pos = (fat16_cluster_to_sector(private, cluster_to_use) * disk->sector_size) + (offset % size_of_cluster_bytes);
+        uint32_t run_end = (extent->file_cluster + extent->total_clusters) * size_of_cluster_bytes;
+        uint32_t total_to_write = run_end - offset;
+        if(total_to_write > total)
+        {
+            total_to_write = total;
+        }
+
+        res = diskstreamer_seek(stream, starting_pos);
+        if(res != CROSOS_ALL_OK)
+        {
+            break;
+        }
+
+        res = diskstreamer_write(stream, in, total_to_write);
+        if(res != CROSOS_ALL_OK)
+        {
+            break;
+        }
+
+        offset += total_to_write;
+        in += total_to_write;
+        total -= total_to_write;
+    }
+
+    return res;
+}
+
+//Frees a loaded directory
+void fat16_free_directory(struct fat_directory* directory)
+{
+    if(!directory)
+    {
+        return;
+    }
+
+    if(directory->item)
+    {
+        kfree(directory->item);
+    }
+
+    if(directory->index_buckets)
+    {
+        kfree(directory->index_buckets); //The chains share the same allocation
+    }
+
+    kmem_cache_free(&fat_directory_cache, directory);
+}
+
+//Frees a generic fat item
+void fat16_fat_item_free(struct fat_item* item)
+{
+    if(item->type == FAT_ITEM_TYPE_DIRECTORY)
+    {
+        fat16_free_directory(item->directory);
+    }
+    else if(item->type == FAT_ITEM_TYPE_FILE)
+    {
+        kmem_cache_free(&fat_directory_item_cache, item->item);
+    }
+
+    kmem_cache_free(&fat_item_cache, item);
+}
+
+//Returns a directory from 
+struct fat_directory* fat16_load_fat_directory(struct disk* disk, struct fat_directory_item* item)
+{
+    uint32_t res = 0;
+    struct fat_directory* directory = 0;
+    struct fat_private* fat_private = disk->fs_private;
+    if(!(item->attribute & FAT_FILE_SUBDIRECTORY)) //We dont want a file
+    {
+        res = -EINVARG;
+        goto out;
+    }
+    //Allocate the returned directory
+    directory = kmem_cache_zalloc(&fat_directory_cache);
+    if(!directory)
+    {
+        res = -ENOMEM;
+        goto out;
+    }
+
+    uint32_t cluster = fat16_get_first_cluster(item); //Get first cluster of the item
+    uint32_t cluster_sector = fat16_cluster_to_sector(fat_private, cluster); //Change the cluster to sector
+    uint32_t total_items = fat16_get_total_items_for_directory(disk, cluster_sector); //Sets the total items in the directory
+    directory->total = total_items; //Assigns the value to the returned directory
+    uint32_t directory_size = directory->total * sizeof(struct fat_directory_item); 
+    directory->item = kzalloc(directory_size); //Asigns memory for all the items in the directory + the directory struct itself
+    if(!directory->item)
+    {
+        res = -ENOMEM;
+        goto out;
+    }
+
+    //All the data is stored to directory->item
+    res = fat16_read_internal(disk, cluster, 0x00, directory_size, directory->item);
+    if(res != CROSOS_ALL_OK)
+    {
+        goto out;
+    }
+
+out:
+    if(res != CROSOS_ALL_OK)
+    {
+        fat16_free_directory(directory); //Error, we dont want the space for the created directory anymore
+        directory = 0;
+    }
+    return directory;
+}
+
+//Creates a new item to be treated from the data in 'item', to avoid memory issues, since item is not allocated
+struct fat_item* fat16_new_fat_item_for_directory_item(struct disk* disk, struct fat_directory_item* item)
+{
+    //Allocates the new item in memory
+    struct fat_item* f_item = kmem_cache_zalloc(&fat_item_cache);
+    if(!f_item)
+    {
+        return 0;
+    }
+
+    if(item->attribute & FAT_FILE_SUBDIRECTORY) //Directory case
+    {
+        f_item->directory = fat16_load_fat_directory(disk, item); //Get the directory from the 'item'
+        f_item->type = FAT_ITEM_TYPE_DIRECTORY;
         return f_item;
     }
 
-    f_item->type = FAT_ITEM_TYPE_FILE;
-    //Allocates a copy of the item to memory and inside the return value
-    f_item->item = fat16_clone_directory_item(item, sizeof(struct fat_directory_item));
-    return f_item;
+    f_item->type = FAT_ITEM_TYPE_FILE;
+    //Allocates a copy of the item to memory and inside the return value
+    f_item->item = fat16_clone_directory_item(item, sizeof(struct fat_directory_item));
+    return f_item;
+}
+
+//Case insensitive hash of a name, combined with a 'seed'
+static uint32_t fat16_name_hash(uint32_t seed, const char* name)
+{
+    uint32_t hash = seed * 31;
+    while(*name)
+    {
+        hash = (hash * 31) + (uint8_t) tolower(*name++);
+    }
+    return hash;
+}
+
+//Builds the hash index of the names of a directory
+static int32_t fat16_build_directory_index(struct fat_directory* directory)
+{
+    uint32_t total_buckets = 1;
+    while(total_buckets < directory->total)
+    {
+        total_buckets <<= 1;
+    }
+
+    //Buckets and chains in a single allocation
+    uint32_t* buckets = kmalloc(sizeof(uint32_t) * (total_buckets + directory->total));
+    if(!buckets)
+    {
+        return -ENOMEM;
+    }
+    uint32_t* next = buckets + total_buckets;
+    for(uint32_t i = 0; i < total_buckets; i++)
+    {
+        buckets[i] = FAT16_INDEX_END;
+    }
+
+    char tmp_filename[CROSOS_MAX_PATH];
+    for(uint32_t i = directory->total; i-- > 0;) //Backwards, so the first of duplicated names ends up at the front of its chain
+    {
+        if(directory->item[i].file_name[0] == CROSOS_FAT16_DELETED_ITEM)
+        {
+            next[i] = FAT16_INDEX_END; //Deleted entries are not indexed
+            continue;
+        }
+
+        fat16_get_full_relative_filename(&directory->item[i], tmp_filename, sizeof(tmp_filename));
+        uint32_t bucket = fat16_name_hash(0, tmp_filename) & (total_buckets - 1);
+        next[i] = buckets[bucket];
+        buckets[bucket] = i;
+    }
+
+    directory->index_buckets = buckets;
+    directory->index_next = next;
+    directory->index_total_buckets = total_buckets;
+    return 0;
+}
+
+//Returns the entry of a given 'directory' with the 'name' (from the parsing of the route), or 0 if it does not exist
+//The names are hashed on the first lookup, later lookups only compare the names of one bucket
+static struct fat_directory_item* fat16_find_directory_item(struct fat_directory* directory, const char* name)
+{
+    if(!directory->total)
+    {
+        return 0;
+    }
+
+    if(!directory->index_buckets && fat16_build_directory_index(directory) < 0)
+    {
+        return 0;
+    }
+
+    char tmp_filename[CROSOS_MAX_PATH]; //Create a temporary string to check coincidences on the name of the item we are looking for
+    uint32_t bucket = fat16_name_hash(0, name) & (directory->index_total_buckets - 1);
+    for(uint32_t i = directory->index_buckets[bucket]; i != FAT16_INDEX_END; i = directory->index_next[i])
+    {
+        //Get filename of the item
+        fat16_get_full_relative_filename(&directory->item[i], tmp_filename, sizeof(tmp_filename));
+
+        if(istrncmp(tmp_filename, name, sizeof(tmp_filename)) == 0) //Compare it with the name we are looking for
+        {
+            return &directory->item[i]; //Found, the first match is the one used
+        }
+    }
+
+    return 0;
+}
+
+//Copies a path component in lower case for the dentry cache. Returns false if it is too long to be cached
+static bool fat16_dentry_normalize_name(const char* name, char* out)
+{
+    uint32_t i = 0;
+    for(; name[i]; i++)
+    {
+        if(i >= FAT16_DENTRY_NAME_SIZE - 1)
+        {
+            return false;
+        }
+        out[i] = tolower(name[i]);
+    }
+    out[i] = 0x00;
+    return true;
+}
+
+//Returns the hash bucket of a component of the directory that starts at 'parent_cluster'
+static struct fat_dentry** fat16_dentry_bucket(struct fat_dentry_cache* cache, uint32_t parent_cluster, const char* name)
+{
+    return &cache->buckets[fat16_name_hash(parent_cluster, name) % FAT16_DENTRY_BUCKETS];
+}
+
+//Looks for a cached lookup of a normalized name
+static struct fat_dentry* fat16_dentry_find(struct fat_dentry_cache* cache, uint32_t parent_cluster, const char* name)
+{
+    for(struct fat_dentry* dentry = *fat16_dentry_bucket(cache, parent_cluster, name); dentry; dentry = dentry->next)
+    {
+        if(dentry->parent_cluster == parent_cluster && strncmp(dentry->name, name, FAT16_DENTRY_NAME_SIZE) == 0)
+        {
+            return dentry;
+        }
+    }
+    return 0;
+}
+
+//Caches the result of a lookup. A null 'item' means that the name does not exist
+static void fat16_dentry_insert(struct fat_dentry_cache* cache, uint32_t parent_cluster, const char* name, struct fat_directory_item* item, uint32_t item_pos)
+{
+    struct fat_dentry* dentry = &cache->entries[cache->next_victim];
+    cache->next_victim = (cache->next_victim + 1) % CROSOS_FAT16_DENTRY_CACHE_ENTRIES;
+    if(dentry->valid)
+    {
+        //Unlink the old lookup from its bucket
+        struct fat_dentry** link = fat16_dentry_bucket(cache, dentry->parent_cluster, dentry->name);
+        while(*link != dentry)
+        {
+            link = &(*link)->next;
+        }
+        *link = dentry->next;
+        cache->stats.evictions++;
+    }
+
+    dentry->valid = true;
+    dentry->negative = item == 0;
+    dentry->parent_cluster = parent_cluster;
+    strncpy(dentry->name, name, sizeof(dentry->name));
+    if(item)
+    {
+        memcpy(&dentry->item, item, sizeof(struct fat_directory_item));
+        dentry->item_pos = item_pos;
+    }
+
+    struct fat_dentry** bucket = fat16_dentry_bucket(cache, parent_cluster, name);
+    dentry->next = *bucket;
+    *bucket = dentry;
+}
+
+//Drops the cached lookup of a name whose directory entry changed
+static void fat16_dentry_forget(struct fat_dentry_cache* cache, uint32_t parent_cluster, const char* name)
+{
+    char key[FAT16_DENTRY_NAME_SIZE];
+    if(!fat16_dentry_normalize_name(name, key))
+    {
+        return; //Never cached
+    }
+
+    for(struct fat_dentry** link = fat16_dentry_bucket(cache, parent_cluster, key); *link; link = &(*link)->next)
+    {
+        struct fat_dentry* dentry = *link;
+        if(dentry->parent_cluster == parent_cluster && strncmp(dentry->name, key, FAT16_DENTRY_NAME_SIZE) == 0)
+        {
+            *link = dentry->next;
+            dentry->valid = false;
+            return;
+        }
+    }
+}
+
+//Resolves a path component inside its parent directory, through the dentry cache
+//'parent_item' is the entry of the parent directory, or 0 for the root. It is only read from the disk on a cache miss
+//The position of the entry on the disk is stored to 'item_pos' when it is not 0
+static int32_t fat16_lookup(struct disk* disk, struct fat_directory_item* parent_item, const char* name, struct fat_directory_item* out, uint32_t* item_pos)
+{
+    int32_t res = 0;
+    struct fat_private* fat_private = disk->fs_private;
+    struct fat_dentry_cache* cache = &fat_private->dentry_cache;
+    uint32_t parent_cluster = parent_item ? fat16_get_first_cluster(parent_item) : FAT16_DENTRY_ROOT_CLUSTER;
+    char key[FAT16_DENTRY_NAME_SIZE];
+    bool cacheable = fat16_dentry_normalize_name(name, key);
+    if(cacheable)
+    {
+        struct fat_dentry* dentry = fat16_dentry_find(cache, parent_cluster, key);
+        if(dentry)
+        {
+            if(dentry->negative)
+            {
+                cache->stats.negative_hits++;
+                return -EIO;
+            }
+
+            cache->stats.hits++;
+            memcpy(out, &dentry->item, sizeof(struct fat_directory_item));
+            if(item_pos)
+            {
+                *item_pos = dentry->item_pos;
+            }
+            return 0;
+        }
+    }
+    cache->stats.misses++;
+
+    struct fat_directory* directory = &fat_private->root_directory;
+    if(parent_item)
+    {
+        directory = fat16_load_fat_directory(disk, parent_item);
+        if(!directory)
+        {
+            return -EIO;
+        }
+    }
+
+    struct fat_directory_item* item = fat16_find_directory_item(directory, name);
+    uint32_t pos = 0;
+    if(item)
+    {
+        memcpy(out, item, sizeof(struct fat_directory_item));
+        pos = fat16_directory_item_position(disk, parent_cluster, item - directory->item);
+        if(item_pos)
+        {
+            *item_pos = pos;
+        }
+    }
+    else
+    {
+        res = -EIO;
+    }
+
+    if(cacheable)
+    {
+        fat16_dentry_insert(cache, parent_cluster, key, item, pos);
+    }
+
+    if(parent_item)
+    {
+        fat16_free_directory(directory);
+    }
+    return res;
 }
 
-//Return an item (directory or file) from a given 'directory', 'disk', and 'name' (from the parsing of the route)
-struct fat_item* fat16_find_item_in_directory(struct disk* disk, struct fat_directory* directory, const char* name)
+//Returns the counters of the directory entry cache of a FAT16 disk
+int32_t fat16_get_dentry_stats(struct disk* disk, struct fat16_dentry_stats* stats)
 {
-    struct fat_item* f_item = 0; //Initialize the returned item
-    char tmp_filename[CROSOS_MAX_PATH]; //Create a temporary string to check coincidences on the name of the item we are looking for
-    //Iterate all the items in a directory
-    for(uint32_t i = 0; i < directory->total; i++)
+    if(disk->filesystem != &fat16_fs || !disk->fs_private)
     {
-        //Get filename of the item
-        fat16_get_full_relative_filename(&directory->item[i], tmp_filename, sizeof(tmp_filename));
+        return -EINVARG;
+    }
 
-        if(istrncmp(tmp_filename, name, sizeof(tmp_filename)) == 0) //Compare it with the name we are looking for
+    struct fat_private* fat_private = disk->fs_private;
+    memcpy(stats, &fat_private->dentry_cache.stats, sizeof(struct fat16_dentry_stats));
+    return 0;
+}
+
+//Writes a directory entry to the disk, and to the copies of it kept in memory
+static int32_t fat16_write_directory_item(struct disk* disk, uint32_t parent_cluster, uint32_t item_pos, struct fat_directory_item* item)
+{
+    struct fat_private* fat_private = disk->fs_private;
+    struct disk_stream* stream = fat_private->directory_stream;
+    int32_t res = diskstreamer_seek(stream, item_pos);
+    if(res == CROSOS_ALL_OK)
+    {
+        res = diskstreamer_write(stream, item, sizeof(struct fat_directory_item));
+    }
+    if(res < 0)
+    {
+        return res;
+    }
+
+    if(parent_cluster == FAT16_DENTRY_ROOT_CLUSTER)
+    {
+        //The root directory stays loaded, its copy of the entry is updated
+        struct fat_directory* root = &fat_private->root_directory;
+        uint32_t index = (item_pos - (root->sector_pos * disk->sector_size)) / sizeof(struct fat_directory_item);
+        bool renamed = index >= root->total || memcmp(root->item[index].file_name, item->file_name, sizeof(item->file_name) + sizeof(item->ext)) != 0;
+        memcpy(&root->item[index], item, sizeof(struct fat_directory_item));
+        if(index >= root->total)
+        {
+            root->total = index + 1;
+        }
+
+        if(renamed && root->index_buckets)
         {
-            //Found. Create a new FAT item
-            f_item = fat16_new_fat_item_for_directory_item(disk, &directory->item[i]);
+            kfree(root->index_buckets); //The name index is built again on the next lookup
+            root->index_buckets = 0;
+            root->index_next = 0;
         }
     }
 
-    return f_item;
+    char name[CROSOS_MAX_PATH];
+    fat16_get_full_relative_filename(item, name, sizeof(name));
+    fat16_dentry_forget(&fat_private->dentry_cache, parent_cluster, name);
+    return 0;
 }
 
-//Gets an item 
-struct fat_item* fat16_get_directory_entry(struct disk* disk, struct path_part* path)
+//Converts a path component to the space padded, upper case 8.3 name of a directory entry
+static int32_t fat16_set_short_name(struct fat_directory_item* item, const char* name)
 {
-    struct fat_private* fat_private = disk->fs_private; //Get private header (filesystem info)
-    struct fat_item* current_item = 0; //Initialize returned item
-    struct fat_item* root_item 
-            = fat16_find_item_in_directory(disk, &fat_private->root_directory, path->part); //Get the root directory item
-    if(!root_item)
+    memset(item->file_name, ' ', sizeof(item->file_name));
+    memset(item->ext, ' ', sizeof(item->ext));
+
+    uint32_t i = 0;
+    for(; *name && *name != '.'; name++, i++)
     {
-        goto out;
+        if(i >= sizeof(item->file_name))
+        {
+            return -EBADPATH;
+        }
+        item->file_name[i] = toupper(*name);
+    }
+
+    if(i == 0)
+    {
+        return -EBADPATH;
+    }
+
+    if(*name == '.')
+    {
+        name++;
+        for(i = 0; *name; name++, i++)
+        {
+            if(i >= sizeof(item->ext) || *name == '.')
+            {
+                return -EBADPATH;
+            }
+            item->ext[i] = toupper(*name);
+        }
+    }
+    return 0;
+}
+
+//Adds an empty file to a directory, in its first free or deleted entry. Directories are not grown, -ENOSPC is returned when they are full
+static int32_t fat16_create_item(struct disk* disk, uint32_t parent_cluster, const char* name, struct fat_directory_item* out, uint32_t* item_pos)
+{
+    struct fat_private* fat_private = disk->fs_private;
+    struct fat_directory_item item;
+    memset(&item, 0, sizeof(item));
+    int32_t res = fat16_set_short_name(&item, name);
+    if(res < 0)
+    {
+        return res;
     }
+    item.attribute = FAT_FILE_ARCHIVED;
 
-    struct path_part* next_part = path->next;
-    current_item = root_item; //Prepares the current_item to the root_directory to start a loop
-    while(next_part != 0) //The loop iterates until the next_part is 0, meaning that we reached the file, instead of all the previous directories
+    struct disk_stream* stream = fat_private->directory_stream;
+    struct fat_directory_item slot;
+    uint32_t pos = 0;
+    for(uint32_t index = 0; ; index++)
     {
-        if(current_item->type != FAT_ITEM_TYPE_DIRECTORY) //Looking for a filesystem corruption. If the next part != 0 and the item_type we are checking is not a directory, it is a clear corruption
+        pos = fat16_directory_item_position(disk, parent_cluster, index);
+        if(!pos)
+        {
+            return -ENOSPC;
+        }
+
+        if(diskstreamer_seek(stream, pos) != CROSOS_ALL_OK || diskstreamer_read(stream, &slot, sizeof(slot)) != CROSOS_ALL_OK)
+        {
+            return -EIO;
+        }
+
+        if(slot.file_name[0] == 0x00 || slot.file_name[0] == CROSOS_FAT16_DELETED_ITEM)
         {
-            current_item = 0;
             break;
         }
+    }
 
-        //Load the next directory / file to tmp_item
-        struct fat_item* tmp_item = fat16_find_item_in_directory(disk, current_item->directory, next_part->part);
-        //Free the memory for the already used directory
-        fat16_fat_item_free(current_item);
-        //Reload it with new information (next inner directory or the final file)
-        current_item = tmp_item;
-        next_part = next_part->next;
+    res = fat16_write_directory_item(disk, parent_cluster, pos, &item);
+    if(res < 0)
+    {
+        return res;
     }
 
-out:
-    return current_item; //Return the file
+    memcpy(out, &item, sizeof(item));
+    *item_pos = pos;
+    return 0;
+}
+
+//Gets an item. The position of its directory entry on the disk is stored to 'item_pos'
+struct fat_item* fat16_get_directory_entry(struct disk* disk, struct path_part* path, uint32_t* item_pos)
+{
+    struct fat_directory_item item;
+    struct fat_directory_item parent_item;
+    struct fat_directory_item* parent = 0; //Root directory
+    for(struct path_part* part = path; part; part = part->next)
+    {
+        if(parent)
+        {
+            if(!(item.attribute & FAT_FILE_SUBDIRECTORY)) //A file in the middle of the path
+            {
+                return 0;
+            }
+            memcpy(&parent_item, &item, sizeof(struct fat_directory_item)); //The previous component is the parent of this one
+        }
+
+        if(fat16_lookup(disk, parent, part->part, &item, item_pos) < 0)
+        {
+            return 0;
+        }
+        parent = &parent_item;
+    }
+
+    //Create the returned item (file or directory) from the last component
+    return fat16_new_fat_item_for_directory_item(disk, &item);
+}
+
+//Finds or creates the file of a path opened for writing or appending, and fills the descriptor with it
+static int32_t fat16_open_for_write(struct disk* disk, struct path_part* path, FILE_MODE mode, struct fat_file_descriptor* descriptor)
+{
+    struct fat_private* private = disk->fs_private;
+    if(!private->cluster_bitmap)
+    {
+        return -ERDONLY;
+    }
+
+    //Every component but the last one is a directory
+    struct fat_directory_item item;
+    struct fat_directory_item parent_item;
+    struct fat_directory_item* parent = 0; //Root directory
+    struct path_part* part = path;
+    for(; part->next; part = part->next)
+    {
+        if(fat16_lookup(disk, parent, part->part, &parent_item, 0) < 0 || !(parent_item.attribute & FAT_FILE_SUBDIRECTORY))
+        {
+            return -EIO;
+        }
+        parent = &parent_item;
+    }
+
+    uint32_t parent_cluster = parent ? fat16_get_first_cluster(parent) : FAT16_DENTRY_ROOT_CLUSTER;
+    uint32_t item_pos = 0;
+    int32_t res = fat16_lookup(disk, parent, part->part, &item, &item_pos);
+    if(res < 0)
+    {
+        res = fat16_create_item(disk, parent_cluster, part->part, &item, &item_pos);
+        if(res < 0)
+        {
+            return res;
+        }
+    }
+
+    if(item.attribute & (FAT_FILE_SUBDIRECTORY | FAT_FILE_VOLUME_LABEL))
+    {
+        return -EINVARG;
+    }
+    if(item.attribute & FAT_FILE_READ_ONLY)
+    {
+        return -ERDONLY;
+    }
+
+    for(struct fat_file_descriptor* reader = private->write_denied; reader; reader = reader->next_denied)
+    {
+        if(reader->item_pos == item_pos)
+        {
+            return -EISTKN; //A running program maps its pages from the clusters of the file
+        }
+    }
+
+    //Every writer keeps its own copy of the directory entry and writes it back, so a second one would overwrite the size and first cluster of the other
+    for(struct fat_file_descriptor* writer = private->writers; writer; writer = writer->next_writer)
+    {
+        if(writer->parent_cluster == parent_cluster && writer->item_pos == item_pos)
+        {
+            return -EISTKN;
+        }
+    }
+
+    descriptor->item = fat16_new_fat_item_for_directory_item(disk, &item);
+    if(!descriptor->item)
+    {
+        return -ENOMEM;
+    }
+    descriptor->parent_cluster = parent_cluster;
+    descriptor->item_pos = item_pos;
+
+    struct fat_directory_item* file = descriptor->item->item;
+    if(mode == FILE_MODE_WRITE && (file->file_size || fat16_get_first_cluster(file))) //Truncate
+    {
+        fat16_free_cluster_chain(disk, fat16_get_first_cluster(file));
+        file->high_16_bits_first_cluster = 0;
+        file->low_16_bits_first_cluster = 0;
+        file->file_size = 0;
+        descriptor->dirty = true;
+    }
+    else if(mode == FILE_MODE_APPEND)
+    {
+        descriptor->pos = file->file_size;
+    }
+
+    descriptor->next_writer = private->writers;
+    private->writers = descriptor;
+    return 0;
 }
 
 //Loads a file from path and mode
@@ -687,22 +1733,29 @@ void* fat16_open(struct disk* disk, struct path_part* path, FILE_MODE mode) //Im
 {
     struct fat_file_descriptor* descriptor = 0;
     int err_code = 0;
-    //Read only supported for now
-    if(mode != FILE_MODE_READ)
-    {
-        err_code = -ERDONLY;
-        goto err;
-    }
 
     //Create and allocate a file_descriptor, containing an item (directory or file) and a position
-    descriptor = kzalloc(sizeof(struct fat_file_descriptor));
+    descriptor = kmem_cache_zalloc(&fat_file_descriptor_cache);
     if(!descriptor)
     {
         err_code = -ENOMEM;
         goto err;
     }
+    descriptor->disk = disk;
+    descriptor->mode = mode;
+
+    if(mode != FILE_MODE_READ)
+    {
+        err_code = fat16_open_for_write(disk, path, mode, descriptor);
+        if(err_code < 0)
+        {
+            goto err;
+        }
+        return descriptor;
+    }
+
     //Get the directory entry, from path and disk
-    descriptor->item = fat16_get_directory_entry(disk, path);
+    descriptor->item = fat16_get_directory_entry(disk, path, &descriptor->item_pos);
     if(!descriptor->item)
     {
         err_code = -EIO;
@@ -715,22 +1768,115 @@ void* fat16_open(struct disk* disk, struct path_part* path, FILE_MODE mode) //Im
 err:
     if(descriptor)
     {
-        kfree(descriptor);
+        if(descriptor->item)
+        {
+            fat16_fat_item_free(descriptor->item);
+        }
+        kmem_cache_free(&fat_file_descriptor_cache, descriptor);
     }
     return ERROR(err_code);
 }
 
+//Keeps a file open for reading from being opened for writing until the descriptor is closed
+//Fails with -EISTKN if the file is being written already
+int32_t fat16_deny_write(struct disk* disk, void* private)
+{
+    struct fat_file_descriptor* desc = private;
+    struct fat_private* fat_private = disk->fs_private;
+    if(desc->mode != FILE_MODE_READ)
+    {
+        return -EINVARG;
+    }
+
+    for(struct fat_file_descriptor* writer = fat_private->writers; writer; writer = writer->next_writer)
+    {
+        if(writer->item_pos == desc->item_pos)
+        {
+            return -EISTKN;
+        }
+    }
+
+    if(!desc->deny_write)
+    {
+        desc->deny_write = true;
+        desc->next_denied = fat_private->write_denied;
+        fat_private->write_denied = desc;
+    }
+    return 0;
+}
+
 //Frees an item and its descriptor
 static void fat16_free_file_descriptor(struct fat_file_descriptor* desc)
 {
     fat16_fat_item_free(desc->item); //Deallocates the item struct of the private desriptor
-    kfree(desc); //Deallocates the private descriptor
+    fat16_free_extent_map(&desc->extent_map);
+    kmem_cache_free(&fat_file_descriptor_cache, desc); //Deallocates the private descriptor
+}
+
+//Writes the directory entry of an open file if its size or first cluster changed
+static int32_t fat16_flush_writer(struct fat_file_descriptor* desc)
+{
+    if(!desc->dirty)
+    {
+        return 0;
+    }
+
+    int32_t res = fat16_write_directory_item(desc->disk, desc->parent_cluster, desc->item_pos, desc->item->item);
+    if(res == 0)
+    {
+        desc->dirty = false;
+    }
+    return res;
 }
 
 //Close an item
 uint32_t fat16_close(void* private) //Frees the allocated spae for the descriptor used for the file
 {
-    fat16_free_file_descriptor((struct fat_file_descriptor*) private);
+    struct fat_file_descriptor* desc = private;
+    if(desc->mode != FILE_MODE_READ)
+    {
+        //The file stays open if its data cannot be written, so the close can be retried
+        int32_t res = fat16_flush_writer(desc);
+        if(res == 0)
+        {
+            res = fat16_flush_fat(desc->disk);
+        }
+        if(res == 0)
+        {
+            res = disk_sync(desc->disk);
+        }
+        if(res < 0)
+        {
+            return res;
+        }
+
+        struct fat_private* fat_private = desc->disk->fs_private;
+        struct fat_file_descriptor** writer = &fat_private->writers;
+        while(*writer && *writer != desc)
+        {
+            writer = &(*writer)->next_writer;
+        }
+        if(*writer)
+        {
+            *writer = desc->next_writer;
+        }
+    }
+
+    if(desc->deny_write)
+    {
+        struct fat_private* fat_private = desc->disk->fs_private;
+        struct fat_file_descriptor** reader = &fat_private->write_denied;
+        while(*reader && *reader != desc)
+        {
+            reader = &(*reader)->next_denied;
+        }
+        if(*reader)
+        {
+            *reader = desc->next_denied;
+        }
+    }
+
+    fat16_free_file_descriptor(desc);
     return 0;
 }
 
@@ -748,6 +1894,7 @@ uint32_t fat16_stat(struct disk* disk, void* private, struct file_stat* stat)
 
     struct fat_directory_item* ritem = desc_item->item;
     stat->filesize = ritem->file_size; //Gets size from item descriptor
+    stat->id = fat16_get_first_cluster(ritem);
     stat->flags = 0x00;
     if(ritem->attribute & FAT_FILE_READ_ONLY)
     {
@@ -766,10 +1913,20 @@ uint32_t fat16_read(struct disk* disk, void* descriptor, uint32_t size, uint32_t
     struct fat_file_descriptor* fat_desc = descriptor;
     struct fat_directory_item* item = fat_desc->item->item; //Gets the item descriptor
     uint32_t offset = fat_desc->pos;
+    if(!fat_desc->extent_map.extents)
+    {
+        //First read, map the cluster chain once. Later reads locate their clusters with a binary search
+        res = fat16_build_extent_map(disk, fat16_get_first_cluster(item), &fat_desc->extent_map);
+        if(ISERR(res))
+        {
+            goto out;
+        }
+    }
+
     for(uint32_t i = 0; i < nmemb; i++) // A read every nmemb bytes
     {
-        //Read from first cluster, offset and size
-        res = fat16_read_internal(disk, fat16_get_first_cluster(item), offset, size, out_ptr);
+        //Read from the mapped clusters, offset and size
+        res = fat16_read_mapped(disk, &fat_desc->extent_map, offset, size, out_ptr);
         if(ISERR(res))
         {
             goto out;
@@ -779,6 +1936,8 @@ uint32_t fat16_read(struct disk* disk, void* descriptor, uint32_t size, uint32_t
         offset += size;
     }
 
+    fat16_read_ahead(disk, fat_desc, fat_desc->pos, size * nmemb);
+    fat_desc->pos = offset; //The next read continues after this one, as the writes do
     res = nmemb; //Return number of rounds for reading
 
 out:
@@ -786,6 +1945,84 @@ out:
 
 }
 
+//Writes to a file opened for writing or appending, at its position. The position is moved after the written bytes
+uint32_t fat16_write(struct disk* disk, void* descriptor, uint32_t size, uint32_t nmemb, const char* in_ptr)
+{
+    uint32_t res = 0;
+    struct fat_file_descriptor* fat_desc = descriptor;
+    if(fat_desc->mode == FILE_MODE_READ)
+    {
+        res = -ERDONLY;
+        goto out;
+    }
+
+    struct fat_directory_item* item = fat_desc->item->item;
+    uint32_t total = size * nmemb;
+    uint32_t end = fat_desc->pos + total;
+    if(end < fat_desc->pos)
+    {
+        res = -EINVARG;
+        goto out;
+    }
+
+    //All the clusters are allocated first, so the data goes to the disk in runs as long as possible
+    res = fat16_extend_file(disk, fat_desc, end);
+    if(ISERR(res))
+    {
+        goto out;
+    }
+
+    res = fat16_write_mapped(disk, &fat_desc->extent_map, fat_desc->pos, total, in_ptr);
+    if(ISERR(res))
+    {
+        goto out;
+    }
+
+    fat_desc->pos = end;
+    if(end > item->file_size)
+    {
+        item->file_size = end;
+        fat_desc->dirty = true;
+    }
+    res = nmemb;
+
+out:
+    return res;
+}
+
+//Writes the directory entries of the open files, the changed FAT sectors and the dirty cached sectors of a disk
+uint32_t fat16_sync(struct disk* disk)
+{
+    int32_t res = 0;
+    struct fat_private* private = disk->fs_private;
+    if(!private)
+    {
+        return 0;
+    }
+
+    for(struct fat_file_descriptor* writer = private->writers; writer; writer = writer->next_writer)
+    {
+        int32_t writer_res = fat16_flush_writer(writer);
+        if(writer_res < 0)
+        {
+            res = writer_res;
+        }
+    }
+
+    int32_t fat_res = fat16_flush_fat(disk);
+    if(fat_res < 0)
+    {
+        res = fat_res;
+    }
+
+    int32_t disk_res = disk_sync(disk);
+    if(disk_res < 0)
+    {
+        res = disk_res;
+    }
+    return res;
+}
+
 //Sets the offset prior to read a file
 uint32_t fat16_seek(void* private, uint32_t offset, FILE_SEEK_MODE seek_mode)
 {
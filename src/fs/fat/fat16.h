@@ -1,7 +1,19 @@
 #ifndef FAT16_h
 #define FAT16_H
 #include "fs/file.h"
+#include <stdint.h>
 
+//Counters of the directory entry cache of a disk
+struct fat16_dentry_stats
+{
+    uint32_t hits;
+    uint32_t negative_hits; //Hits that answered that the name does not exist
+    uint32_t misses;
+    uint32_t evictions;
+};
+
+struct disk;
 struct filesystem* fat16_init();
+int32_t fat16_get_dentry_stats(struct disk* disk, struct fat16_dentry_stats* stats);
 
 #endif
\ No newline at end of file
@@ -2,14 +2,20 @@
 #include "config.h"
 #include "memory/memory.h"
 #include "memory/heap/kheap.h"
+#include "memory/heap/slab.h"
 #include "status.h"
 #include "kernel.h"
 #include "fat/fat16.h"
 #include "disk/disk.h"
 #include "string/string.h"
+#include "task/task.h"
 
 struct filesystem* filesystems[CROSOS_MAX_FILESYSTEMS]; //Filesystems supported by OS
 struct file_descriptor* file_descriptors[CROSOS_MAX_FILE_DESCRIPTORS]; // File descriptors handled in the OS
+static struct kmem_cache file_descriptor_cache = KMEM_CACHE_INIT("file_descriptor", sizeof(struct file_descriptor));
+
+static uint32_t file_sync_ticks = 0; //Clock ticks since the last periodic sync
+static bool file_sync_due = false; //Set by the clock, the periodic sync runs on the next system call
 
 //Returns an empty position of the filesystems array of the OS
 static struct filesystem** fs_get_free_filesystem()
@@ -64,7 +70,7 @@ void fs_init()
 static void file_free_descriptor(struct file_descriptor* desc)
 {
     file_descriptors[desc->index-1] = 0x00;
-    kfree(desc);
+    kmem_cache_free(&file_descriptor_cache, desc);
 }
 
 //Sets a new descriptor into the array
@@ -76,7 +82,11 @@ static uint32_t file_new_descriptor(struct file_descriptor** desc_out)
     {
         if(file_descriptors[i] == 0) //If the index is empty
         {
-        struct file_descriptor* desc = kzalloc(sizeof(struct file_descriptor)); //Allocate a new file descriptor
+        struct file_descriptor* desc = kmem_cache_zalloc(&file_descriptor_cache); //Allocate a new file descriptor
+        if(!desc)
+        {
+            break;
+        }
         //Descriptors start at 1
         desc->index = i + 1;
         file_descriptors[i] = desc;
@@ -177,7 +187,10 @@ uint32_t fopen(const char* filename, const char* mode_str)
     //Up to this point we have the disk loaded to 'disk', the path parsed to the 'root_path' with the linked subdirectories in it and the mode of opening a file to 'mode'
 
     //Call the filesystem custom implementation of fopen and store the result at the 'descriptor_private_data'
+    //A task can sleep in the middle of a filesystem call waiting for the disk. The rest of calls on the same disk wait for it to finish
+    task_mutex_lock(&disk->lock);
     void* descriptor_private_data = disk->filesystem->open(disk, root_path->first, mode);
+    task_mutex_unlock(&disk->lock);
     if(ISERR(descriptor_private_data))
     {
         res = ERROR_I(descriptor_private_data);
@@ -217,12 +230,35 @@ uint32_t fstat(uint32_t fd, struct file_stat* stat)
         goto out;
     }
 
+    task_mutex_lock(&desc->disk->lock);
     res = desc->filesystem->stat(desc->disk, desc->private, stat); //Calls filesystem function
+    task_mutex_unlock(&desc->disk->lock);
 
 out:
     return res;
 }
 
+//Keeps the file of a descriptor opened for reading from being opened for writing until the descriptor is closed
+//Used for files whose data must not change under their reader, like the image of a running program
+int32_t fdenywrite(uint32_t fd)
+{
+    struct file_descriptor* desc = file_get_descriptor(fd);
+    if(!desc)
+    {
+        return -EIO;
+    }
+
+    if(!desc->filesystem->deny_write)
+    {
+        return -EUNIMP;
+    }
+
+    task_mutex_lock(&desc->disk->lock);
+    int32_t res = desc->filesystem->deny_write(desc->disk, desc->private);
+    task_mutex_unlock(&desc->disk->lock);
+    return res;
+}
+
 //Closes a file by calling the appropiate filesystem close function
 uint32_t fclose(uint32_t fd)
 {
@@ -234,7 +270,9 @@ uint32_t fclose(uint32_t fd)
         goto out;
     }
 
+    task_mutex_lock(&desc->disk->lock);
     res = desc->filesystem->close(desc->private);
+    task_mutex_unlock(&desc->disk->lock);
     if(res == CROSOS_ALL_OK)
     {
         file_free_descriptor(desc); //Frees the descriptor of the OS, the contents in the private descriptor arae freed inside the filesystem function
@@ -255,7 +293,9 @@ uint32_t fseek(uint32_t fd, uint32_t offset, FILE_SEEK_MODE whence)
         goto out;
     }
 
+    task_mutex_lock(&desc->disk->lock);
     res = desc->filesystem->seek(desc->private, offset, whence); //Call filesystem function
+    task_mutex_unlock(&desc->disk->lock);
     
 out:
     return res;
@@ -279,8 +319,90 @@ uint32_t fread(void* ptr, uint32_t size, uint32_t nmemb, uint32_t fd)
         goto out;
     }
 
+    task_mutex_lock(&desc->disk->lock);
     res = desc->filesystem->read(desc->disk, desc->private, size, nmemb, (char*) ptr); //Calls filesystem function
+    task_mutex_unlock(&desc->disk->lock);
+
+out:
+    return res;
+}
+
+//Writes to a file
+uint32_t fwrite(const void* ptr, uint32_t size, uint32_t nmemb, uint32_t fd)
+{
+    uint32_t res = 0;
+    if (size == 0 || nmemb == 0 || fd < 1) //Argument checks
+    {
+        res = -EINVARG;
+        goto out;
+    }
+
+    struct file_descriptor* desc = file_get_descriptor(fd);
+    if(!desc)
+    {
+        res = -EINVARG;
+        goto out;
+    }
+
+    if(!desc->filesystem->write)
+    {
+        res = -ERDONLY;
+        goto out;
+    }
+
+    task_mutex_lock(&desc->disk->lock);
+    res = desc->filesystem->write(desc->disk, desc->private, size, nmemb, (const char*) ptr); //Calls filesystem function
+    task_mutex_unlock(&desc->disk->lock);
 
 out:
     return res;
+}
+
+//Syncs a disk if its filesystem supports it. The lock of the disk must be held
+static int32_t fs_sync_disk(struct disk* disk)
+{
+    if(!disk->filesystem || !disk->filesystem->sync)
+    {
+        return 0;
+    }
+    return disk->filesystem->sync(disk);
+}
+
+//Writes the pending metadata and the dirty cached sectors to the disks
+int32_t fs_sync()
+{
+    int32_t res = 0;
+    struct disk* disk = 0;
+    for(uint32_t i = 0; (disk = disk_get(i)) != 0; i++)
+    {
+        task_mutex_lock(&disk->lock);
+        int32_t disk_res = fs_sync_disk(disk);
+        task_mutex_unlock(&disk->lock);
+        if(disk_res < 0)
+        {
+            res = disk_res; //Keep syncing the other disks
+        }
+    }
+    file_sync_ticks = 0;
+    file_sync_due = false;
+    return res;
+}
+
+//Called on every clock tick. It only marks the periodic sync as due every CROSOS_FS_SYNC_INTERVAL_TICKS
+//The write back sleeps on locks and disk I/O, so it never runs inside the interrupt
+void fs_sync_tick()
+{
+    if(++file_sync_ticks >= CROSOS_FS_SYNC_INTERVAL_TICKS)
+    {
+        file_sync_due = true;
+    }
+}
+
+//Runs the periodic sync if the clock marked it as due. Called when a system call returns, in the context of the calling task
+void fs_sync_if_due()
+{
+    if(file_sync_due)
+    {
+        fs_sync();
+    }
 }
\ No newline at end of file
@@ -31,6 +31,7 @@ struct file_stat
 {
     FILE_STAT_FLAGS flags;
     uint32_t filesize;
+    uint32_t id; //Identifies the data of the file inside its disk, 0 if the filesystem has no such value
 };
 
 struct disk;
@@ -39,8 +40,11 @@ typedef void* (*FS_OPEN_FUNCTION) (struct disk* disk, struct path_part* path, FI
 typedef uint32_t (*FS_RESOLVE_FUNCTION) (struct disk* disk);
 typedef uint32_t (*FS_SEEK_FUNCTION) (void* private, uint32_t offset, FILE_SEEK_MODE seek_mode);
 typedef uint32_t (*FS_READ_FUNCTION) (struct disk* disk, void* private, uint32_t size, uint32_t nmemb, char* out);
+typedef uint32_t (*FS_WRITE_FUNCTION) (struct disk* disk, void* private, uint32_t size, uint32_t nmemb, const char* in);
+typedef uint32_t (*FS_SYNC_FUNCTION) (struct disk* disk);
 typedef uint32_t (*FS_CLOSE_FUNCTION) (void* private);
 typedef uint32_t (*FS_STAT_FUNCTION) (struct disk* disk, void* private, struct file_stat* stat);
+typedef int32_t (*FS_DENY_WRITE_FUNCTION) (struct disk* disk, void* private);
 
 struct filesystem
 {
@@ -48,9 +52,12 @@ struct filesystem
     FS_RESOLVE_FUNCTION resolve; // Function pointer of every filesystem to guess if the disk is using this filesystem
     FS_OPEN_FUNCTION open; // Open function according to a given filesystem
     FS_READ_FUNCTION read; //Reads the file loaded with open
+    FS_WRITE_FUNCTION write; //Writes to a file opened for writing or appending
     FS_SEEK_FUNCTION seek; // Sets the pointer to a given position in the file
     FS_STAT_FUNCTION stat; // Gets flags and size of the file
     FS_CLOSE_FUNCTION close; //Closes the file
+    FS_SYNC_FUNCTION sync; //Writes the pending metadata and dirty sectors of the disk
+    FS_DENY_WRITE_FUNCTION deny_write; //Keeps an open file from being opened for writing until it is closed
     char name[20]; // Name of the filesystem, i.e. FAT16 or NTFS
 };
 
@@ -70,9 +77,14 @@ struct file_descriptor
 void fs_init();
 uint32_t fopen(const char* filename, const char* mode_string); //Open file function
 uint32_t fread(void* ptr, uint32_t size, uint32_t nmemb, uint32_t fd); //Read contents of the file
+uint32_t fwrite(const void* ptr, uint32_t size, uint32_t nmemb, uint32_t fd); //Write contents to the file
+int32_t fs_sync(); //Write back the dirty data of every disk
+void fs_sync_tick(); //Called on every clock tick, marks the periodic sync as due
+void fs_sync_if_due(); //Called outside interrupts, runs the periodic sync when it is due
 uint32_t fclose(uint32_t fd); //Close the file, freeing the descriptors loaded
 uint32_t fseek(uint32_t fd, uint32_t offset, FILE_SEEK_MODE whence); // Set the pointer position in the file
 uint32_t fstat(uint32_t fd, struct file_stat* stat); //Get the stat flags of the file and its size
+int32_t fdenywrite(uint32_t fd); //Keep the file from being opened for writing while 'fd' is open
 void fs_insert_filesystem(struct filesystem* filesystem); // Add new filesystem to the supported filesystems of the OS
 struct filesystem* fs_resolve(struct disk* disk); //Resolve filesystem for a given disk
 #endif
\ No newline at end of file
@@ -2,9 +2,13 @@
 #include "kernel.h"
 #include "string/string.h"
 #include "memory/memory.h"
-#include "memory/heap/kheap.h"
+#include "memory/heap/slab.h"
 #include "status.h"
 
+static struct kmem_cache path_root_cache = KMEM_CACHE_INIT("path_root", sizeof(struct path_root));
+static struct kmem_cache path_part_cache = KMEM_CACHE_INIT("path_part", sizeof(struct path_part));
+static struct kmem_cache path_part_name_cache = KMEM_CACHE_INIT("path_part_name", CROSOS_MAX_PATH);
+
 //Checks the format and length of the path provided
 static uint32_t pathparser_path_valid_format(const char* filename)
 {
@@ -31,7 +35,11 @@ static uint32_t pathparser_get_drive_by_path(const char** path)
 //Allocates a root path from a drive number
 static struct path_root* pathparser_create_root(uint32_t drive_number)
 {
-    struct path_root* path_r = kzalloc(sizeof(struct path_root)); //Allocates the needed memory for the root path
+    struct path_root* path_r = kmem_cache_zalloc(&path_root_cache); //Allocates the needed memory for the root path
+    if(!path_r)
+    {
+        return 0;
+    }
     path_r->drive_no = drive_number; //Stores the value of the drive number
     path_r->first = 0; // Temporary value which will further be modified
     return path_r;
@@ -40,7 +48,11 @@ static struct path_root* pathparser_create_root(uint32_t drive_number)
 //Returns the part of a path
 static const char* pathparser_get_path_part(const char** path)
 {
-    char* result_path_part = kzalloc(CROSOS_MAX_PATH); //Allocates space for the path part that will be parsed
+    char* result_path_part = kmem_cache_zalloc(&path_part_name_cache); //Allocates space for the path part that will be parsed
+    if(!result_path_part)
+    {
+        return 0;
+    }
     uint32_t i = 0;
     while(**path != '/' && **path != 0x00)
     {
@@ -57,7 +69,7 @@ static const char* pathparser_get_path_part(const char** path)
 
     if(i == 0)
     {
-        kfree(result_path_part); //Free the contents of the path part, since we reached the end of the absolut path string
+        kmem_cache_free(&path_part_name_cache, result_path_part); //Free the contents of the path part, since we reached the end of the absolut path string
         result_path_part = 0; //Clear the pointer
     }
 
@@ -73,7 +85,12 @@ struct path_part* pathparser_parse_path_part(struct path_part* last_part, const
         return 0; //End of the path
     }
 
-    struct path_part* part = kzalloc(sizeof(struct path_part));
+    struct path_part* part = kmem_cache_zalloc(&path_part_cache);
+    if(!part)
+    {
+        kmem_cache_free(&path_part_name_cache, (void*) path_part_str);
+        return 0;
+    }
     part->part = path_part_str; //Initialize the part with the name parsed
     part->next = 0x00; //Temporary next value
 
@@ -92,12 +109,12 @@ void pathparser_free(struct path_root* root)
     while(part) //Repeat until part is null (last part)
     {
         struct path_part* next_part = part->next; //Gets the next part
-        kfree((void*) part->part); // Frees the contents on the string of the path part
-        kfree(part); // Frees the actual structure
+        kmem_cache_free(&path_part_name_cache, (void*) part->part); // Frees the contents on the string of the path part
+        kmem_cache_free(&path_part_cache, part); // Frees the actual structure
         part = next_part; //References the part variable to the next part address, to repeat the loop
     }
 
-    kfree(root); //Free root part of the path.
+    kmem_cache_free(&path_root_cache, root); //Free root part of the path.
 }
 
 //Parses an absolut path, getting every folder and file as a path part
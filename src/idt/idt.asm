@@ -4,12 +4,15 @@ extern int21h_handler
 extern interrupt_handler
 extern no_interrupt_handler
 extern isr80h_handler
+extern idt_page_fault
 
 global idt_load
 global no_interrupt
 global enable_interrupts
 global disable_interrupts
+global idt_wait_for_interrupt
 global isr80h_wrapper
+global page_fault_wrapper
 global interrupt_pointer_table
 
 enable_interrupts:
@@ -20,6 +23,12 @@ disable_interrupts:
     cli
     ret
 
+idt_wait_for_interrupt: ; Halts until an interrupt is handled. Interrupts are disabled again when it returns
+    sti ; The interrupt cannot be taken between sti and hlt
+    hlt
+    cli
+    ret
+
 idt_load:
     push ebp ; Push base pointer to stack
     mov ebp, esp ; Change scope of the base pointer to stack pointer
@@ -82,9 +91,24 @@ isr80h_wrapper:
     mov eax, [tmp_res] ; Move back the tmp_res value to eax, the return value for C functions
     iretd
 
+page_fault_wrapper:
+    ;The processor pushes an error code on top of the interrupt frame for this exception
+    ;It is removed so the stack has the same layout as the rest of interrupts
+    pop dword[tmp_page_fault_error]
+
+    pushad
+    push esp
+    push dword[tmp_page_fault_error] ; Error code for the handler
+    call idt_page_fault
+    add esp, 8
+    popad
+    iret ; Executes again the instruction that faulted
+
 section .data
 ;Stores the temporary return result from the isr80h_handler
 tmp_res: dd 0
+;Stores the error code of the page fault being handled
+tmp_page_fault_error: dd 0
 
 %macro interrupt_array_entry 1
     dd int%1 ; Gets the addres of every function created by the above macro
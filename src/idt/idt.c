@@ -6,6 +6,9 @@
 #include "task/task.h"
 #include "status.h"
 #include "task/process.h"
+#include "task/vm.h"
+#include "memory/paging/paging.h"
+#include "fs/file.h"
 
 struct idt_desc idt_descriptors[CROSOS_TOTAL_INTERRUPTS];
 struct idtr_desc idtr_descriptor;
@@ -20,6 +23,7 @@ extern void idt_load(struct idtr_desc* ptr);
 extern void int21h();
 extern void no_interrupt();
 extern void isr80h_wrapper();
+extern void page_fault_wrapper();
 
 //No interrupt implemented
 void no_interrupt_handler()
@@ -27,17 +31,37 @@ void no_interrupt_handler()
     outb(0x20, 0x20); // ACK sent to successfully release the interrupt
 }
 
+//Sends the end of interrupt to the PICs that delivered it
+static void idt_acknowledge(int32_t interrupt)
+{
+    if(interrupt >= 0x28 && interrupt < 0x30)
+    {
+        outb(0xA0, 0x20); //IRQs 8-15 come from the slave PIC
+    }
+    outb(0x20, 0x20); // ACK sent to successfully release the interrupt
+}
+
 //This function is called when an interrupt happens
+//Interrupts can also arrive inside the kernel while a task sleeps, there is no user state to save then
 void interrupt_handler(int32_t interrupt, struct interrupt_frame* frame)
 {
+    bool from_user = frame->cs & 0x03;
     kernel_page();
     if(interrupt_callbacks[interrupt] != 0)
     {
-        task_current_save_state(frame);
+        if(from_user)
+        {
+            task_current_save_state(frame);
+        }
         interrupt_callbacks[interrupt](frame); //Call the interrupt function number, stored in the array
     }
-    task_page();
-    outb(0x20, 0x20); // ACK sent to successfully release the interrupt
+    idt_acknowledge(interrupt);
+
+    if(from_user)
+    {
+        task_run_woken(); //A task waiting for this interrupt runs now, the interrupted one continues later
+        task_page();
+    }
 }
 
 //Interrupt divide by zero handler
@@ -65,10 +89,42 @@ void idt_handle_exception()
     task_next(); //Switch to next task
 }
 
+//Called by the page fault wrapper in ASM. Maps the missing page of the current process or kills it
+void idt_page_fault(uint32_t error_code, struct interrupt_frame* frame)
+{
+    void* address = paging_get_fault_address();
+    kernel_page();
+    struct task* task = task_current();
+    if(task && process_vm_handle_fault(task->process, address, error_code) == 0)
+    {
+        if(frame->cs & 0x03)
+        {
+            task_page(); //Fault from user land, go back to the user segments
+        }
+        return; //The instruction is executed again
+    }
+
+    if(!task || !(frame->cs & 0x03))
+    {
+        //System calls check user pointers before using them, so a kernel fault that could not be resolved is a kernel bug.
+        //The frame holds kernel registers, saving it as the task state would resume the task with garbage
+        panic("Page fault in the kernel\n");
+    }
+
+    task_current_save_state(frame);
+    idt_handle_exception();
+}
+
 //Interrupt handler for a clock tick
-void idt_clock()
+void idt_clock(struct interrupt_frame* frame)
 {
+    if(!(frame->cs & 0x03))
+    {
+        return; //The kernel was halted waiting for an interrupt, the waiting code switches tasks itself
+    }
+
     outb(0x20, 0x20); // ACK sent to successfully release the interrupt
+    fs_sync_tick(); //Only counts, the write back runs on the next system call
     task_next(); //Switch to the next task
 }
 
@@ -85,6 +141,7 @@ void idt_init()
     }
     idt_set(0, idt_zero); // Set the Interrupt 0. It does not use the iret, so it is a bad design even though it works
     idt_set(0x80, isr80h_wrapper); //User land interrupts
+    idt_set(14, page_fault_wrapper); //Page faults push an error code, they need their own wrapper
 
     for(int i = 0; i < 20; i++)
     {
@@ -108,6 +165,17 @@ int32_t idt_register_interrupt_callback(int32_t interrupt, INTERRUPT_CALLBACK_FU
     return CROSOS_ALL_OK;
 }
 
+//Unmasks an IRQ line in the PICs. The ones of the slave PIC also need the cascade line (IRQ2) of the master
+void idt_enable_irq(uint8_t irq)
+{
+    if(irq >= 8)
+    {
+        outb(0xA1, insb(0xA1) & ~(1 << (irq - 8)));
+        irq = 2;
+    }
+    outb(0x21, insb(0x21) & ~(1 << irq));
+}
+
 //Registers a pointer to a function that handles a user interrupt (0x80)
 void isr80h_register_command(int32_t command_id, ISR80H_COMMAND command)
 {
@@ -148,9 +216,10 @@ void* isr80h_handle_command(int32_t command, struct interrupt_frame* frame)
 void* isr80h_handler(uint32_t command, struct interrupt_frame* frame) 
 {
     void* res = 0;
-    kernel_page(); //Activates the kernel page directory and segment registers of the GDT
+    kernel_page(); //Activates the kernel segment registers of the GDT. The task page directory stays loaded
     task_current_save_state(frame); //Save registers of the task
     res = isr80h_handle_command(command, frame); //Handles the command of the interrupt
-    task_page(); //Activates again the user task page directory
+    fs_sync_if_due(); //Periodic write back of the dirty data, the task can sleep here unlike in the clock interrupt
+    task_page(); //Activates again the user segments, and the task page directory if a command switched it
     return res; //Return result from interrupt command function
 }
\ No newline at end of file
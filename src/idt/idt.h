@@ -43,6 +43,8 @@ struct interrupt_frame
 void idt_init();
 void enable_interrupts();
 void disable_interrupts();
+void idt_wait_for_interrupt();
 void isr80h_register_command(int32_t command_id, ISR80H_COMMAND command);
 int32_t idt_register_interrupt_callback(int32_t interrupt, INTERRUPT_CALLBACK_FUNCTION interrupt_callback);
+void idt_enable_irq(uint8_t irq);
 #endif
\ No newline at end of file
@@ -4,6 +4,8 @@ global insb
 global insw
 global outb
 global outw
+global insl
+global outl
 
 insb:
     push ebp
@@ -48,3 +50,24 @@ outw:
 
     pop ebp
     ret
+
+insl:
+    push ebp
+    mov ebp, esp
+
+    mov edx, [ebp+8] ; pass port parameter to edx
+    in eax, dx ; get a double word from the port
+
+    pop ebp
+    ret
+
+outl:
+    push ebp
+    mov ebp, esp
+
+    mov eax, [ebp+12] ; Second parameter
+    mov edx, [ebp+8] ; First parameter
+    out dx, eax
+
+    pop ebp
+    ret
\ No newline at end of file
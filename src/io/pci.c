@@ -0,0 +1,93 @@
+#include "pci.h"
+#include "io.h"
+#include "status.h"
+
+//Address of a configuration register for the legacy configuration mechanism
+static uint32_t pci_config_address(struct pci_device* device, uint8_t offset)
+{
+    return 0x80000000 | (device->bus << 16) | (device->device << 11) | (device->function << 8) | (offset & 0xFC);
+}
+
+//Reads a double word of the configuration space of a PCI function
+uint32_t pci_config_read(struct pci_device* device, uint8_t offset)
+{
+    outl(PCI_CONFIG_ADDRESS_PORT, pci_config_address(device, offset));
+    return insl(PCI_CONFIG_DATA_PORT);
+}
+
+//Writes a double word of the configuration space of a PCI function
+void pci_config_write(struct pci_device* device, uint8_t offset, uint32_t value)
+{
+    outl(PCI_CONFIG_ADDRESS_PORT, pci_config_address(device, offset));
+    outl(PCI_CONFIG_DATA_PORT, value);
+}
+
+//Callback that decides if a PCI function is the one looked for
+typedef int (*PCI_MATCH_FUNCTION)(struct pci_device* device, uint32_t id, uint32_t class, uint32_t data);
+
+//Walks every function of every bus until 'match' accepts one. The first 'skip' accepted functions are passed over
+static int32_t pci_find(PCI_MATCH_FUNCTION match, uint32_t data, uint32_t skip, struct pci_device* out)
+{
+    struct pci_device device;
+    for(uint32_t bus = 0; bus < PCI_MAX_BUSES; bus++)
+    {
+        for(uint32_t dev = 0; dev < PCI_MAX_DEVICES; dev++)
+        {
+            for(uint32_t function = 0; function < PCI_MAX_FUNCTIONS; function++)
+            {
+                device.bus = bus;
+                device.device = dev;
+                device.function = function;
+                uint32_t id = pci_config_read(&device, PCI_CONFIG_VENDOR_ID);
+                if((id & 0xFFFF) == PCI_VENDOR_NONE)
+                {
+                    if(function == 0)
+                    {
+                        break; //No device in this slot
+                    }
+                    continue;
+                }
+
+                if(match(&device, id, pci_config_read(&device, PCI_CONFIG_CLASS), data))
+                {
+                    if(skip == 0)
+                    {
+                        *out = device;
+                        return 0;
+                    }
+                    skip--;
+                }
+
+                if(function == 0 && !(pci_config_read(&device, PCI_CONFIG_HEADER_TYPE) & 0x00800000))
+                {
+                    break; //Single function device
+                }
+            }
+        }
+    }
+    return -EIO;
+}
+
+//Matches the class and subclass packed in 'data'
+static int pci_match_class(struct pci_device* device, uint32_t id, uint32_t class, uint32_t data)
+{
+    return (class >> 16) == data;
+}
+
+//Finds the first PCI function of a class and subclass
+int32_t pci_find_class(uint8_t class, uint8_t subclass, struct pci_device* out)
+{
+    return pci_find(pci_match_class, (class << 8) | subclass, 0, out);
+}
+
+//Matches the vendor and device ids packed in 'data', as they are in the first register of the configuration space
+static int pci_match_device(struct pci_device* device, uint32_t id, uint32_t class, uint32_t data)
+{
+    return id == data;
+}
+
+//Finds the PCI function number 'index' (0 for the first one) with a vendor and device id
+int32_t pci_find_device(uint16_t vendor_id, uint16_t device_id, uint32_t index, struct pci_device* out)
+{
+    return pci_find(pci_match_device, ((uint32_t) device_id << 16) | vendor_id, index, out);
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#ifndef PCI_H
+#define PCI_H
+
+#include <stdint.h>
+
+#define PCI_CONFIG_ADDRESS_PORT 0xCF8
+#define PCI_CONFIG_DATA_PORT 0xCFC
+#define PCI_MAX_BUSES 256
+#define PCI_MAX_DEVICES 32
+#define PCI_MAX_FUNCTIONS 8
+
+//Offsets of the configuration space header
+#define PCI_CONFIG_VENDOR_ID 0x00
+#define PCI_CONFIG_COMMAND 0x04
+#define PCI_CONFIG_CLASS 0x08 // Revision, programming interface, subclass and class
+#define PCI_CONFIG_HEADER_TYPE 0x0C
+#define PCI_CONFIG_BAR0 0x10
+#define PCI_CONFIG_BAR4 0x20
+#define PCI_CONFIG_INTERRUPT_LINE 0x3C
+
+#define PCI_COMMAND_IO_SPACE 0x01
+#define PCI_COMMAND_BUS_MASTER 0x04
+#define PCI_BAR_IO_MASK 0xFFFFFFFC // I/O space bars keep the flags in the low 2 bits
+
+#define PCI_VENDOR_NONE 0xFFFF
+
+//Location of a function in the PCI bus
+struct pci_device
+{
+    uint8_t bus;
+    uint8_t device;
+    uint8_t function;
+};
+
+uint32_t pci_config_read(struct pci_device* device, uint8_t offset);
+void pci_config_write(struct pci_device* device, uint8_t offset, uint32_t value);
+int32_t pci_find_class(uint8_t class, uint8_t subclass, struct pci_device* out);
+int32_t pci_find_device(uint16_t vendor_id, uint16_t device_id, uint32_t index, struct pci_device* out);
+
+#endif
@@ -0,0 +1,37 @@
+#include "pit.h"
+#include "io.h"
+
+//Reads the current count of channel 0, that goes down and reloads when it reaches 0
+static uint16_t pit_read_count()
+{
+    outb(PIT_COMMAND_PORT, PIT_COMMAND_LATCH_CHANNEL0);
+    uint16_t count = insb(PIT_CHANNEL0_PORT);
+    count |= insb(PIT_CHANNEL0_PORT) << 8;
+    return count;
+}
+
+//Counts of channel 0 in a millisecond. In square wave mode, the BIOS default, the count goes down by 2 at every input clock
+static uint32_t pit_counts_per_ms()
+{
+    outb(PIT_COMMAND_PORT, PIT_COMMAND_READ_BACK_STATUS0);
+    uint8_t mode = (insb(PIT_CHANNEL0_PORT) >> 1) & 0x07;
+    uint32_t counts = PIT_INPUT_HZ / 1000;
+    return mode == 3 || mode == 7 ? counts * 2 : counts;
+}
+
+//Starts a timer that expires after 'milliseconds'. It must be checked more often than channel 0 reloads, at least every 27ms
+void pit_timer_start(struct pit_timer* timer, uint32_t milliseconds)
+{
+    timer->last_count = pit_read_count();
+    timer->elapsed = 0;
+    timer->limit = milliseconds * pit_counts_per_ms();
+}
+
+//Adds the counts since the last check. Returns true once the time of the timer has passed
+bool pit_timer_expired(struct pit_timer* timer)
+{
+    uint16_t count = pit_read_count();
+    timer->elapsed += (uint16_t) (timer->last_count - count); //The BIOS reload value is 0x10000, so the count wraps around like a uint16_t
+    timer->last_count = count;
+    return timer->elapsed >= timer->limit;
+}
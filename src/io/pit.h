@@ -0,0 +1,24 @@
+#ifndef PIT_H
+#define PIT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PIT_CHANNEL0_PORT 0x40
+#define PIT_COMMAND_PORT 0x43
+#define PIT_COMMAND_LATCH_CHANNEL0 0x00
+#define PIT_COMMAND_READ_BACK_STATUS0 0xE2 // Read back the status of channel 0, not its count
+#define PIT_INPUT_HZ 1193182
+
+//Measures time by the count of channel 0, which keeps running at the rate the BIOS left it
+struct pit_timer
+{
+    uint16_t last_count;
+    uint32_t elapsed; //Counts since the timer started
+    uint32_t limit;
+};
+
+void pit_timer_start(struct pit_timer* timer, uint32_t milliseconds);
+bool pit_timer_expired(struct pit_timer* timer);
+
+#endif
@@ -0,0 +1,199 @@
+#include "file.h"
+#include "task/task.h"
+#include "task/process.h"
+#include "fs/file.h"
+#include "fs/fat/fat16.h"
+#include "disk/disk.h"
+#include "memory/memory.h"
+#include "memory/heap/kheap.h"
+#include "config.h"
+#include "status.h"
+
+//Returns the kernel descriptor of a file handle of the process, 0 if the handle is not open
+static uint32_t isr80h_file_get(struct process* process, uint32_t handle)
+{
+    if(handle < 1 || handle > CROSOS_MAX_PROCESS_FILES)
+    {
+        return 0;
+    }
+    return process->files[handle - 1];
+}
+
+//Moves 'total' bytes from the memory of the current process to an open file, or the other way around, through a kernel buffer
+//The filesystem never touches user memory, so the page faults of the copies happen without the disk lock held
+static int32_t isr80h_file_transfer(uint32_t fd, void* user_ptr, uint32_t total, bool to_file)
+{
+    if(process_user_range_size(task_current()->process, user_ptr, !to_file) < total)
+    {
+        return -EINVARG; //The buffer must be memory of the process, writable when the file is read into it
+    }
+
+    void* buffer = kmalloc(CROSOS_FILE_SYSCALL_BUFFER_SIZE);
+    if(!buffer)
+    {
+        return -ENOMEM;
+    }
+
+    int32_t res = 0;
+    while(total > 0 && res == 0)
+    {
+        uint32_t chunk = total > CROSOS_FILE_SYSCALL_BUFFER_SIZE ? CROSOS_FILE_SYSCALL_BUFFER_SIZE : total;
+        if(to_file)
+        {
+            memcpy(buffer, user_ptr, chunk);
+            res = (int32_t) fwrite(buffer, chunk, 1, fd);
+        }
+        else
+        {
+            res = (int32_t) fread(buffer, chunk, 1, fd);
+            if(res == 1)
+            {
+                memcpy(user_ptr, buffer, chunk);
+            }
+        }
+
+        if(res == 1)
+        {
+            res = 0;
+        }
+        else if(res >= 0)
+        {
+            res = -EIO;
+        }
+        user_ptr += chunk;
+        total -= chunk;
+    }
+
+    kfree(buffer);
+    return res;
+}
+
+//Opens a file for the current process. Returns its handle, or 0 if it could not be opened
+void* isr80h_command13_fopen(struct interrupt_frame* frame)
+{
+    struct task* task = task_current();
+    struct process* process = task->process;
+    char filename[CROSOS_MAX_PATH];
+    char mode[4];
+    if(copy_string_from_task(task, task_get_stack_item(task, 0), filename, sizeof(filename)) < 0 ||
+        copy_string_from_task(task, task_get_stack_item(task, 1), mode, sizeof(mode)) < 0)
+    {
+        return 0;
+    }
+
+    for(uint32_t i = 0; i < CROSOS_MAX_PROCESS_FILES; i++)
+    {
+        if(process->files[i] == 0)
+        {
+            uint32_t fd = fopen(filename, mode);
+            if(!fd)
+            {
+                return 0;
+            }
+            process->files[i] = fd;
+            return (void*) (i + 1);
+        }
+    }
+    return 0; //Too many open files
+}
+
+//Reads 'nmemb' items of 'size' bytes at the position of a file. Returns 'nmemb' or a negative error
+void* isr80h_command14_fread(struct interrupt_frame* frame)
+{
+    struct task* task = task_current();
+    void* ptr = task_get_stack_item(task, 0);
+    uint32_t size = (uint32_t) task_get_stack_item(task, 1);
+    uint32_t nmemb = (uint32_t) task_get_stack_item(task, 2);
+    uint32_t fd = isr80h_file_get(task->process, (uint32_t) task_get_stack_item(task, 3));
+    if(!fd || size == 0 || nmemb == 0 || size * nmemb / size != nmemb)
+    {
+        return (void*) -EINVARG;
+    }
+
+    int32_t res = isr80h_file_transfer(fd, ptr, size * nmemb, false);
+    return (void*) (res < 0 ? res : (int32_t) nmemb);
+}
+
+//Writes 'nmemb' items of 'size' bytes at the position of a file opened with "w" or "a". Returns 'nmemb' or a negative error
+void* isr80h_command15_fwrite(struct interrupt_frame* frame)
+{
+    struct task* task = task_current();
+    void* ptr = task_get_stack_item(task, 0);
+    uint32_t size = (uint32_t) task_get_stack_item(task, 1);
+    uint32_t nmemb = (uint32_t) task_get_stack_item(task, 2);
+    uint32_t fd = isr80h_file_get(task->process, (uint32_t) task_get_stack_item(task, 3));
+    if(!fd || size == 0 || nmemb == 0 || size * nmemb / size != nmemb)
+    {
+        return (void*) -EINVARG;
+    }
+
+    int32_t res = isr80h_file_transfer(fd, ptr, size * nmemb, true);
+    return (void*) (res < 0 ? res : (int32_t) nmemb);
+}
+
+//Moves the position of a file. Returns 0 or a negative error
+void* isr80h_command16_fseek(struct interrupt_frame* frame)
+{
+    struct task* task = task_current();
+    uint32_t fd = isr80h_file_get(task->process, (uint32_t) task_get_stack_item(task, 0));
+    uint32_t offset = (uint32_t) task_get_stack_item(task, 1);
+    FILE_SEEK_MODE whence = (FILE_SEEK_MODE) task_get_stack_item(task, 2);
+    if(!fd)
+    {
+        return (void*) -EINVARG;
+    }
+    return (void*) fseek(fd, offset, whence);
+}
+
+//Copies the size and flags of an open file to the structure of the process. Returns 0 or a negative error
+void* isr80h_command17_fstat(struct interrupt_frame* frame)
+{
+    struct task* task = task_current();
+    uint32_t fd = isr80h_file_get(task->process, (uint32_t) task_get_stack_item(task, 0));
+    struct file_stat* user_stat = task_get_stack_item(task, 1);
+    if(!fd || process_user_range_size(task->process, user_stat, true) < sizeof(struct file_stat))
+    {
+        return (void*) -EINVARG;
+    }
+
+    struct file_stat stat;
+    int32_t res = fstat(fd, &stat);
+    if(res == 0)
+    {
+        memcpy(user_stat, &stat, sizeof(stat));
+    }
+    return (void*) res;
+}
+
+//Closes a file of the process. A file being written is flushed to the disk first. Returns 0 or a negative error
+void* isr80h_command18_fclose(struct interrupt_frame* frame)
+{
+    struct task* task = task_current();
+    uint32_t handle = (uint32_t) task_get_stack_item(task, 0);
+    uint32_t fd = isr80h_file_get(task->process, handle);
+    if(!fd)
+    {
+        return (void*) -EINVARG;
+    }
+
+    int32_t res = fclose(fd);
+    if(res == 0)
+    {
+        task->process->files[handle - 1] = 0; //A close that could not flush can be retried
+    }
+    return (void*) res;
+}
+
+//Copies the counters of the directory entry cache of a disk to the structure of the process. Returns 0 or a negative error
+void* isr80h_command22_dentry_stats(struct interrupt_frame* frame)
+{
+    struct task* task = task_current();
+    struct disk* disk = disk_get((uint32_t) task_get_stack_item(task, 0));
+    struct fat16_dentry_stats* user_stats = task_get_stack_item(task, 1);
+    if(!disk || process_user_range_size(task->process, user_stats, true) < sizeof(struct fat16_dentry_stats))
+    {
+        return (void*) -EINVARG;
+    }
+
+    return (void*) fat16_get_dentry_stats(disk, user_stats); //Fails if the disk is not FAT16
+}
@@ -1,6 +1,11 @@
 #include "heap.h"
 #include "task/task.h"
 #include "task/process.h"
+#include "memory/heap/heap.h"
+#include "memory/heap/kheap.h"
+#include "memory/frame/kframe.h"
+#include "memory/memory.h"
+#include "status.h"
 #include <stddef.h>
 #include <stdint.h>
 
@@ -16,4 +21,93 @@ void* isr80h_command5_free(struct interrupt_frame* frame)
 {
     void* ptr_to_free = task_get_stack_item(task_current(), 0); //Get pointer to free
     process_free(task_current()->process, ptr_to_free); //Free it
-}
\ No newline at end of file
+}
+
+//Grows or shrinks the heap of the current process, used by the user land allocator to get large chunks at once
+void* isr80h_command10_sbrk(struct interrupt_frame* frame)
+{
+    int32_t increment = (int32_t) task_get_stack_item(task_current(), 0); //Get bytes to move the break
+    return process_sbrk(task_current()->process, increment);
+}
+
+//Copies the kernel heap counters to the structure provided by the current process
+void* isr80h_command11_heap_stats(struct interrupt_frame* frame)
+{
+    struct heap_stats* stats = task_get_stack_item(task_current(), 0); //Get pointer to the user structure
+    if(process_user_range_size(task_current()->process, stats, true) < sizeof(struct heap_stats))
+    {
+        return (void*) -EINVARG; //The whole structure must be writable memory of the process, not of the kernel
+    }
+
+    kheap_get_stats(stats); //The task page directory is loaded, the structure is written directly
+    return 0;
+}
+//Copies the usage and fragmentation of the page frame pool to the structure provided by the current process
+void* isr80h_command19_frame_stats(struct interrupt_frame* frame)
+{
+    struct buddy_stats* stats = task_get_stack_item(task_current(), 0); //Get pointer to the user structure
+    if(process_user_range_size(task_current()->process, stats, true) < sizeof(struct buddy_stats))
+    {
+        return (void*) -EINVARG;
+    }
+
+    kframe_get_stats(stats);
+    return 0;
+}
+
+//Runs the page frame stress test for some rounds and copies its result to the structure provided by the current process
+void* isr80h_command20_frame_churn(struct interrupt_frame* frame)
+{
+    uint32_t rounds = (uint32_t) task_get_stack_item(task_current(), 0); //Get rounds of the test
+    struct kframe_churn_result* result = task_get_stack_item(task_current(), 1);
+    if(process_user_range_size(task_current()->process, result, true) < sizeof(struct kframe_churn_result))
+    {
+        return (void*) -EINVARG;
+    }
+
+    return (void*) kframe_churn_test(rounds, result);
+}
+
+//Times a version of a kernel memory function on kernel buffers, so the SSE2 versions can be measured from user land.
+//The run is described by a structure of the current process, the cycles are written back to it
+void* isr80h_command23_memory_benchmark(struct interrupt_frame* frame)
+{
+    struct memory_benchmark* user_bench = task_get_stack_item(task_current(), 0); //Get pointer to the user structure
+    if(process_user_range_size(task_current()->process, user_bench, true) < sizeof(struct memory_benchmark))
+    {
+        return (void*) -EINVARG;
+    }
+
+    struct memory_benchmark bench;
+    memcpy(&bench, user_bench, sizeof(bench));
+    if(bench.size == 0 || bench.size > MEMORY_BENCHMARK_MAX_SIZE || bench.dest_offset >= MEMORY_BENCHMARK_MAX_OFFSET ||
+        bench.src_offset >= MEMORY_BENCHMARK_MAX_OFFSET || bench.iterations == 0 || bench.iterations > MEMORY_BENCHMARK_MAX_ITERATIONS)
+    {
+        return (void*) -EINVARG;
+    }
+
+    int32_t res = -ENOMEM;
+    uint8_t* dest = kframe_alloc(MEMORY_BENCHMARK_MAX_SIZE + MEMORY_BENCHMARK_MAX_OFFSET);
+    uint8_t* src = kframe_alloc(MEMORY_BENCHMARK_MAX_SIZE + MEMORY_BENCHMARK_MAX_OFFSET);
+    if(!dest || !src)
+    {
+        goto out;
+    }
+
+    res = memory_benchmark(bench.op, bench.variant, dest + bench.dest_offset, src + bench.src_offset, bench.size, bench.iterations, &bench.cycles);
+    if(res == 0)
+    {
+        user_bench->cycles = bench.cycles;
+    }
+
+out:
+    if(dest)
+    {
+        kframe_free(dest);
+    }
+    if(src)
+    {
+        kframe_free(src);
+    }
+    return (void*) res;
+}
@@ -4,5 +4,10 @@
 struct interrupt_frame;
 void* isr80h_command4_malloc(struct interrupt_frame* frame);
 void* isr80h_command5_free(struct interrupt_frame* frame);
+void* isr80h_command10_sbrk(struct interrupt_frame* frame);
+void* isr80h_command11_heap_stats(struct interrupt_frame* frame);
+void* isr80h_command19_frame_stats(struct interrupt_frame* frame);
+void* isr80h_command20_frame_churn(struct interrupt_frame* frame);
+void* isr80h_command23_memory_benchmark(struct interrupt_frame* frame);
 
 #endif
\ No newline at end of file
@@ -2,14 +2,23 @@
 #include "task/task.h"
 #include "kernel.h"
 #include "keyboard/keyboard.h"
+#include "fs/file.h"
+#include "task/process.h"
+#include "disk/cache.h"
+#include "disk/disk.h"
+#include "memory/memory.h"
+#include "status.h"
 
 // Prints a message pushed on the stack
 void* isr80h_command1_print(struct interrupt_frame* frame)
 {
     void* user_space_msg_buff = task_get_stack_item(task_current(), 0); //Get pointer to the message
     char buff[1024];
-    copy_string_from_task(task_current(), user_space_msg_buff, buff, sizeof(buff)); //Copy from virtual address
-    
+    if(copy_string_from_task(task_current(), user_space_msg_buff, buff, sizeof(buff)) < 0) //Copy from virtual address
+    {
+        return 0;
+    }
+
     print(buff); //Print the message
     return 0;
 }
@@ -27,4 +36,52 @@ void* isr80h_command3_putchar(struct interrupt_frame* frame)
     char c = (char)(int) task_get_stack_item(task_current(), 0); //Gets the character from the stack
     terminal_writechar(c, 15); //Prints it
     return 0;
-}
\ No newline at end of file
+}
+
+//Writes the dirty data of every disk. Returns 0 or a negative error
+void* isr80h_command12_sync(struct interrupt_frame* frame)
+{
+    return (void*) fs_sync();
+}
+
+//Copies the counters of the disk block cache to the structure provided by the current process
+void* isr80h_command21_disk_cache_stats(struct interrupt_frame* frame)
+{
+    struct disk_cache_stats* stats = task_get_stack_item(task_current(), 0); //Get pointer to the user structure
+    if(process_user_range_size(task_current()->process, stats, true) < sizeof(struct disk_cache_stats))
+    {
+        return (void*) -EINVARG;
+    }
+
+    disk_cache_get_stats(stats);
+    return 0;
+}
+
+//Times raw transfers of a disk, skipping the sector cache. The run is described by a structure of the current process,
+//the cycles are written back to it. Returns 0 or a negative error
+void* isr80h_command24_disk_benchmark(struct interrupt_frame* frame)
+{
+    struct disk_benchmark* user_bench = task_get_stack_item(task_current(), 0); //Get pointer to the user structure
+    if(process_user_range_size(task_current()->process, user_bench, true) < sizeof(struct disk_benchmark))
+    {
+        return (void*) -EINVARG;
+    }
+
+    struct disk_benchmark bench;
+    memcpy(&bench, user_bench, sizeof(bench));
+    struct disk* disk = disk_get(bench.drive);
+    if(!disk)
+    {
+        return (void*) -EINVARG;
+    }
+
+    fs_sync(); //The metadata of the filesystem reaches the cache and the disk before the sectors are rewritten
+    task_mutex_lock(&disk->lock);
+    int32_t res = disk_benchmark(disk, &bench);
+    task_mutex_unlock(&disk->lock);
+    if(res == 0)
+    {
+        user_bench->kcycles = bench.kcycles;
+    }
+    return (void*) res;
+}
@@ -6,4 +6,7 @@ struct interrupt_frame;
 void* isr80h_command1_print(struct interrupt_frame* frame);
 void* isr80h_command2_getkey(struct interrupt_frame* frame);
 void* isr80h_command3_putchar(struct interrupt_frame* frame);
+void* isr80h_command12_sync(struct interrupt_frame* frame);
+void* isr80h_command21_disk_cache_stats(struct interrupt_frame* frame);
+void* isr80h_command24_disk_benchmark(struct interrupt_frame* frame);
 #endif
\ No newline at end of file
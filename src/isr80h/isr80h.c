@@ -4,6 +4,7 @@
 #include "io.h"
 #include "heap.h"
 #include "process.h"
+#include "file.h"
 
 //Registers all the commands of the interrupts 0x80, from userland to kernel
 void isr80h_register_commands()
@@ -18,4 +19,19 @@ void isr80h_register_commands()
     isr80h_register_command(SYSTEM_COMMAND7_INVOKE_SYSTEM_COMMAND, isr80h_command7_invoke_system_command);
     isr80h_register_command(SYSTEM_COMMAND8_GET_PROGRAM_ARGUMENTS, isr80h_command8_get_program_arguments);
     isr80h_register_command(SYSTEM_COMMAND9_EXIT_PROCESS, isr80h_command9_exit);
+    isr80h_register_command(SYSTEM_COMMAND10_SBRK, isr80h_command10_sbrk);
+    isr80h_register_command(SYSTEM_COMMAND11_HEAP_STATS, isr80h_command11_heap_stats);
+    isr80h_register_command(SYSTEM_COMMAND12_SYNC, isr80h_command12_sync);
+    isr80h_register_command(SYSTEM_COMMAND13_FOPEN, isr80h_command13_fopen);
+    isr80h_register_command(SYSTEM_COMMAND14_FREAD, isr80h_command14_fread);
+    isr80h_register_command(SYSTEM_COMMAND15_FWRITE, isr80h_command15_fwrite);
+    isr80h_register_command(SYSTEM_COMMAND16_FSEEK, isr80h_command16_fseek);
+    isr80h_register_command(SYSTEM_COMMAND17_FSTAT, isr80h_command17_fstat);
+    isr80h_register_command(SYSTEM_COMMAND18_FCLOSE, isr80h_command18_fclose);
+    isr80h_register_command(SYSTEM_COMMAND19_FRAME_STATS, isr80h_command19_frame_stats);
+    isr80h_register_command(SYSTEM_COMMAND20_FRAME_CHURN, isr80h_command20_frame_churn);
+    isr80h_register_command(SYSTEM_COMMAND21_DISK_CACHE_STATS, isr80h_command21_disk_cache_stats);
+    isr80h_register_command(SYSTEM_COMMAND22_DENTRY_STATS, isr80h_command22_dentry_stats);
+    isr80h_register_command(SYSTEM_COMMAND23_MEMORY_BENCHMARK, isr80h_command23_memory_benchmark);
+    isr80h_register_command(SYSTEM_COMMAND24_DISK_BENCHMARK, isr80h_command24_disk_benchmark);
 }
\ No newline at end of file
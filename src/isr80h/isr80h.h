@@ -14,6 +14,21 @@ enum SYSTEM_COMMANDS
     SYSTEM_COMMAND7_INVOKE_SYSTEM_COMMAND,
     SYSTEM_COMMAND8_GET_PROGRAM_ARGUMENTS,
     SYSTEM_COMMAND9_EXIT_PROCESS,
+    SYSTEM_COMMAND10_SBRK,
+    SYSTEM_COMMAND11_HEAP_STATS,
+    SYSTEM_COMMAND12_SYNC,
+    SYSTEM_COMMAND13_FOPEN,
+    SYSTEM_COMMAND14_FREAD,
+    SYSTEM_COMMAND15_FWRITE,
+    SYSTEM_COMMAND16_FSEEK,
+    SYSTEM_COMMAND17_FSTAT,
+    SYSTEM_COMMAND18_FCLOSE,
+    SYSTEM_COMMAND19_FRAME_STATS,
+    SYSTEM_COMMAND20_FRAME_CHURN,
+    SYSTEM_COMMAND21_DISK_CACHE_STATS,
+    SYSTEM_COMMAND22_DENTRY_STATS,
+    SYSTEM_COMMAND23_MEMORY_BENCHMARK,
+    SYSTEM_COMMAND24_DISK_BENCHMARK,
 };
 
 void isr80h_register_commands();
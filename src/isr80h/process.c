@@ -36,8 +36,8 @@ out:
 //Calls a system command (process + argument)
 void* isr80h_command7_invoke_system_command(struct interrupt_frame* frame)
 {
-    //Get arguments from stack
-    struct command_argument* arguments = task_virtual_address_to_physical(task_current(), task_get_stack_item(task_current(), 0));
+    //Get arguments from stack. The task page directory is loaded, so its pages fault in if they were not touched yet
+    struct command_argument* arguments = task_get_stack_item(task_current(), 0);
     if(!arguments || strlen(arguments[0].argument) == 0)
     {
         return ERROR(-EINVARG);
@@ -72,7 +72,7 @@ void* isr80h_command7_invoke_system_command(struct interrupt_frame* frame)
 void* isr80h_command8_get_program_arguments(struct interrupt_frame* frame)
 {
     struct process* process = task_current()->process;
-    struct process_arguments* arguments = task_virtual_address_to_physical(task_current(), task_get_stack_item(task_current(), 0));
+    struct process_arguments* arguments = task_get_stack_item(task_current(), 0);
 
     process_get_arguments(process, &arguments->argc, &arguments->argv);
     return 0;
@@ -29,10 +29,30 @@ _start:
     mov al, 0x20 ; Interrupt 0x20 is where master ISR should start
     out 0x21, al ; Tell the master PIC
 
+    mov al, 00000100b ; The slave PIC is attached to the IRQ2
+    out 0x21, al
+
     mov al, 00000001b ; PIC in x86 mode
     out 0x21, al
     ;End remap of master PIC
 
+    ; Remap the slave PIC right after the master one, so the disk IRQs 14 and 15 are the interrupts 0x2E and 0x2F
+    mov al, 00010001b ; Init slave PIC code
+    out 0xA0, al
+
+    mov al, 0x28 ; Interrupt 0x28 is where slave ISR should start
+    out 0xA1, al
+
+    mov al, 00000010b ; Cascade identity of the slave
+    out 0xA1, al
+
+    mov al, 00000001b ; PIC in x86 mode
+    out 0xA1, al
+
+    mov al, 00111111b ; Only the IRQ14 and IRQ15 (primary and secondary ATA channels) are unmasked in the slave
+    out 0xA1, al
+    ;End remap of slave PIC
+
     call kernel_main
     jmp $
 
@@ -4,6 +4,7 @@
 #include "idt/idt.h"
 #include "io/io.h"
 #include "memory/heap/kheap.h"
+#include "memory/frame/kframe.h"
 #include "memory/paging/paging.h"
 #include "fs/file.h"
 #include "disk/disk.h"
@@ -114,10 +115,10 @@ void panic(const char* msg)
 }
 
 //Sets the processor to kernel land
+//The kernel is mapped in every page directory, so the current one is kept and the TLB is not flushed
 void kernel_page()
 {
     kernel_registers(); //Sets the kernel segment registers to the offset of the GDT for kernel_data
-    paging_switch(kernel_chunk); //Loads the page directory of kernel
 }
 
 struct tss tss;
@@ -137,6 +138,9 @@ void kernel_main()
     terminal_initialize();
     print("CrosOS initializing\n");
 
+    //Select the memory functions for this processor
+    memory_init();
+
     memset(gdt_real, 0x00, sizeof(gdt_real));
     gdt_structured_to_gdt(gdt_real, gdt_structured, CROSOS_TOTAL_GDT_SEGMENTS);
     gdt_load(gdt_real, sizeof(gdt_real));
@@ -144,6 +148,9 @@ void kernel_main()
     //Initialize the heap
     kheap_init();
 
+    //Initialize the page frame allocator
+    kframe_init();
+
     //Initialize filesystems
     fs_init();
 
@@ -162,11 +169,16 @@ void kernel_main()
     tss_load(0x28); //GDT offset of the TSS segment
 
     //Setup paging
-    kernel_chunk = paging_new_4gb(PAGING_IS_WRITABLE | PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL); //Creates a new page directory + tables with the flags specified.
+    kernel_chunk = paging_new_kernel_4gb(PAGING_IS_WRITABLE | PAGING_IS_PRESENT); //Creates the kernel page directory + tables, shared by every task. Only the kernel can access them
+    if(!kernel_chunk)
+    {
+        panic("Failed to create the kernel page directory\n");
+    }
     paging_switch(kernel_chunk); // Loads the new address that contains the address of the new paging directory
 
     //Enable paging
     enable_paging();
+    paging_enable_global_pages();
 
     //Register kernel commands from user land
     isr80h_register_commands();
@@ -174,6 +186,9 @@ void kernel_main()
     //Initialize all system keyboard
     keyboard_init();
 
+    //Disk requests sleep until IRQ14 from now on
+    disk_enable_interrupts();
+
     struct process* process = 0;
     int32_t res = process_load_switch("0:/blank.elf", &process);
     if(res != CROSOS_ALL_OK)
@@ -72,10 +72,9 @@ uint8_t classic_keyboard_scancode_to_char(uint8_t scancode)
     return c;
 }
 
-//Handler for a keyboard interrupt
+//Handler for a keyboard interrupt. interrupt_handler sets the kernel segments and restores the user ones if the key came while in user land
 void classic_keyboard_handle_interrupt()
 {
-    kernel_page(); //Switch to kernel page directory
     uint8_t scancode = 0;
     scancode = insb(KEYBOARD_INPUT_PORT); //Scan the code from the input port
     insb(KEYBOARD_INPUT_PORT); //See PC2 driver for more info.
@@ -91,9 +90,6 @@ void classic_keyboard_handle_interrupt()
     {
         keyboard_push(c); //Push it to the process' keyboard buffer
     }
-
-    task_page(); //Go back to user page directory
-
 }
 
 //Classic keyboard getter
@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include "memory/memory.h"
 #include "memory/heap/kheap.h"
+#include "memory/frame/kframe.h"
 #include "string/string.h"
 #include "memory/paging/paging.h"
 #include "kernel.h"
@@ -12,6 +13,9 @@
 //The following signature is verified to determine if the file parsed is elf formatted
 const char elf_signature[] = {0x7f, 'E', 'L', 'F'};
 
+//Images in use, so every process that runs the same file gets the same one
+static struct elf_file* elf_images = 0;
+
 //Compares an input buffer with the signature
 static bool elf_valid_signature(void* buffer)
 {
@@ -55,12 +59,6 @@ struct elf_header* elf_header(struct elf_file* file)
     return file->elf_memory;
 }
 
-//Returns the address of the section's headers table
-struct elf32_shdr* elf_sheader(struct elf_header* header)
-{
-    return (struct elf32_shdr*) ((int32_t) header + header->e_shoff);
-}
-
 //Returns the address of the program's headers table
 struct elf32_phdr* elf_pheader(struct elf_header* header)
 {
@@ -78,64 +76,137 @@ struct elf32_phdr* elf_program_header(struct elf_header* header, int32_t index)
     return &elf_pheader(header)[index];
 }
 
-//Gets a section header from the table and an index
-struct elf32_shdr* elf_section(struct elf_header* header, int32_t index)
+//Returns the virtual base address
+void* elf_virtual_base(struct elf_file* file)
 {
-    return &elf_sheader(header)[index];
+    return file->virtual_base_address;
 }
 
-//Physical address of the part described by the program header
-void* elf_phdr_phys_address(struct elf_file* file, struct elf32_phdr* phdr)
+//Returns the virtual end address
+void* elf_virtual_end(struct elf_file* file)
 {
-    return elf_memory(file) + phdr->p_offset;
+    return file->virtual_end_address;
 }
 
-//Gets string table address address
-char* elf_str_table(struct elf_header* header)
+//Validates signature, class and ecoding
+int32_t elf_validate_loaded(struct elf_header* header)
 {
-    return (char*) header + elf_section(header, header-> e_shstrndx)->sh_offset;
+    return (elf_valid_signature(header) && elf_valid_class(header) && elf_valid_encoding(header) && elf_has_program_header(header) ? CROSOS_ALL_OK : -EINFORMAT);
 }
 
-//Returns the virtual base address
-void* elf_virtual_base(struct elf_file* file)
+//Reads 'size' bytes of the file from 'offset'. Used to fill the pages of the segments on their first touch
+int32_t elf_read(struct elf_file* file, uint32_t offset, uint32_t size, void* out)
 {
-    return file->virtual_base_address;
-}
+    if(offset >= file->file_size || size > file->file_size - offset)
+    {
+        return -EINFORMAT; //The segment goes past the end of the file
+    }
 
-//Returns the virtual end address
-void* elf_virtual_end(struct elf_file* file)
-{
-    return file->virtual_end_address;
+    task_mutex_lock(&file->lock);
+    int32_t res = fseek(file->fd, offset, SEEK_SET);
+    if(res == 0)
+    {
+        res = fread(out, size, 1, file->fd);
+    }
+    task_mutex_unlock(&file->lock);
+    return res < 0 ? res : 0;
 }
 
-//Returns the physical base addres
-void* elf_phys_base(struct elf_file* file)
+//Returns the frame shared by the processes for the page of the file at 'offset', filled with 'size' bytes of the file
+//The page is read on the first call. -EINVARG means that the page was shared with a different size, the caller needs a copy of its own
+int32_t elf_get_shared_page(struct elf_file* file, uint32_t offset, uint32_t size, void** frame_out)
 {
-    return file->physical_base_address;
+    if(!paging_is_aligned((void*) offset) || size > PAGING_PAGE_SIZE)
+    {
+        return -EINVARG;
+    }
+
+    if(!file->shared_pages)
+    {
+        file->total_pages = (file->file_size + PAGING_PAGE_SIZE - 1) / PAGING_PAGE_SIZE;
+        file->shared_pages = kzalloc(sizeof(struct elf_shared_page) * file->total_pages);
+        if(!file->shared_pages)
+        {
+            return -ENOMEM;
+        }
+    }
+
+    uint32_t index = offset / PAGING_PAGE_SIZE;
+    if(index >= file->total_pages)
+    {
+        return -EINFORMAT;
+    }
+
+    struct elf_shared_page* page = &file->shared_pages[index];
+    if(!page->frame)
+    {
+        void* frame = kframe_zalloc(PAGING_PAGE_SIZE);
+        if(!frame)
+        {
+            return -ENOMEM;
+        }
+
+        int32_t res = elf_read(file, offset, size, frame);
+        if(res < 0)
+        {
+            kframe_free(frame);
+            return res;
+        }
+
+        if(page->frame) //Another process read the page while this one was waiting for the disk
+        {
+            kframe_free(frame);
+        }
+        else
+        {
+            page->frame = frame;
+            page->size = size;
+        }
+    }
+
+    if(page->size != size)
+    {
+        return -EINVARG;
+    }
+
+    *frame_out = page->frame;
+    return 0;
 }
 
-//Returns the physical end addres
-void* elf_phys_end(struct elf_file* file)
+//Checks if 'frame' is the shared frame of the page of the file at 'offset'. Shared frames are freed with the image
+bool elf_is_shared_page(struct elf_file* file, uint32_t offset, void* frame)
 {
-    return file->physical_end_address;
+    uint32_t index = offset / PAGING_PAGE_SIZE;
+    return file->shared_pages && index < file->total_pages && file->shared_pages[index].frame == frame;
 }
 
-//Validates signature, class and ecoding
-int32_t elf_validate_loaded(struct elf_header* header)
+//Looks for an image of the same file in use. Images are only kept while they are in use, and their file cannot be opened
+//for writing meanwhile, so the path, size and file id still identify the data that was loaded
+static struct elf_file* elf_find_image(const char* filename, struct file_stat* stat)
 {
-    return (elf_valid_signature(header) && elf_valid_class(header) && elf_valid_encoding(header) && elf_has_program_header(header) ? CROSOS_ALL_OK : -EINFORMAT);
+    for(struct elf_file* image = elf_images; image; image = image->next)
+    {
+        if(image->file_size == stat->filesize && image->file_id == stat->id && strncmp(image->filename, filename, sizeof(image->filename)) == 0)
+        {
+            return image;
+        }
+    }
+    return 0;
 }
 
-//Processes the "load" program header. Calculates virtual and physical base addresses
+//Processes the "load" program header. Calculates virtual base and end addresses
 int32_t elf_process_phdr_pt_load(struct elf_file* elf_file, struct elf32_phdr* phdr) 
 {
+    if(phdr->p_filesz > phdr->p_memsz || (phdr->p_filesz && (phdr->p_offset >= elf_file->file_size || phdr->p_filesz > elf_file->file_size - phdr->p_offset)))
+    {
+        return -EINFORMAT; //The segment is not inside the file, it could not be read when it is touched
+    }
+
     //If the virtual base address is not set or the found value is smaller, set it to that value
     //This is done because we may iterate through several "load" program headers, which all of them contain a v_addr. We need the lowest one
     if(elf_file->virtual_base_address >= (void*) phdr->p_vaddr || elf_file->virtual_base_address == 0x00)
     {
         elf_file->virtual_base_address = (void*) phdr->p_vaddr; //The vaddr is specified at the header
-
-        elf_file->physical_base_address = elf_memory(elf_file)+phdr->p_offset; //Sets physical base address
     }
 
     uint32_t end_virtual_address = phdr->p_vaddr + phdr->p_filesz; //End address local varialbe
@@ -143,7 +214,6 @@ int32_t elf_process_phdr_pt_load(struct elf_file* elf_file, struct elf32_phdr* p
     if(elf_file->virtual_end_address <= (void*) (end_virtual_address) || elf_file->virtual_end_address == 0x00)
     {
         elf_file->virtual_end_address = (void*) end_virtual_address;
-        elf_file->physical_end_address = elf_memory(elf_file) + phdr->p_offset + phdr->p_filesz; //Base address of the file + address of the program + program size
     }
     return 0;
 }
@@ -199,28 +269,87 @@ out:
     return res;
 }
 
-//Loads an elf file into memory and parses its contents
+//Opens an elf file and parses its headers. Only the elf header and the program header table are read
+//The segments are read when the program touches them, the section headers and debug information are never read
 int32_t elf_load(const char* filename, struct elf_file** file_out)
 {
+    int res = 0;
+    struct elf_header header;
     struct elf_file* elf_file = kzalloc(sizeof(struct elf_file)); //Allocate a struct
-    int32_t fd = 0;
-    int res = fopen(filename, "r"); //Open the file
+    if(!elf_file)
+    {
+        res = -ENOMEM;
+        goto out;
+    }
+
+    res = fopen(filename, "r"); //Open the file
     if(res <= 0)
     {
         res = -EIO;
         goto out;
     }
+    elf_file->fd = res;
+
+    //The pages of the program are read from the file while it runs, so its clusters must not be rewritten or freed meanwhile
+    res = fdenywrite(elf_file->fd);
+    if(res < 0 && res != -EUNIMP)
+    {
+        goto out;
+    }
 
-    fd = res;
     struct file_stat stat;
-    res = fstat(fd, &stat); //Gets size
+    res = fstat(elf_file->fd, &stat); //Gets size
     if( res < 0)
     {
         goto out;
     }
 
-    elf_file->elf_memory = kzalloc(stat.filesize); //Allocates space for the file and stores the address at 'elf_memory'
-    res = fread(elf_file->elf_memory, stat.filesize, 1, fd); //Places the file in the allocated space
+    struct elf_file* image = elf_find_image(filename, &stat);
+    if(image) //The file is running already, share its image
+    {
+        image->refcount++;
+        elf_close(elf_file);
+        *file_out = image;
+        return 0;
+    }
+
+    strncpy(elf_file->filename, filename, sizeof(elf_file->filename));
+    elf_file->file_size = stat.filesize;
+    elf_file->file_id = stat.id;
+    elf_file->refcount = 1;
+
+    //The elf header says how much of the beginning of the file holds the program headers
+    res = elf_read(elf_file, 0, sizeof(header), &header);
+    if(res < 0)
+    {
+        goto out;
+    }
+
+    res = elf_validate_loaded(&header);
+    if(res < 0)
+    {
+        goto out;
+    }
+
+    if(header.e_phentsize != sizeof(struct elf32_phdr))
+    {
+        res = -EINFORMAT;
+        goto out;
+    }
+
+    uint32_t headers_size = header.e_phoff + (header.e_phnum * sizeof(struct elf32_phdr));
+    if(headers_size < sizeof(header))
+    {
+        headers_size = sizeof(header);
+    }
+
+    elf_file->elf_memory = kzalloc(headers_size);
+    if(!elf_file->elf_memory)
+    {
+        res = -ENOMEM;
+        goto out;
+    }
+    res = elf_read(elf_file, 0, headers_size, elf_file->elf_memory);
     if(res < 0)
     {
         goto out;
@@ -233,19 +362,61 @@ int32_t elf_load(const char* filename, struct elf_file** file_out)
         goto out;
     }
 
+    elf_file->next = elf_images;
+    elf_images = elf_file;
     *file_out = elf_file; //Returns the address of the allocated struct
 out:
-    fclose(fd); //Closes the filesystem handler
+    if(res < 0)
+    {
+        elf_close(elf_file);
+    }
     return res;
 }
 
-//Frees the allocations set for an elf file
+//Releases an image of an elf file. The last process that uses it frees its allocations and closes the file
+//The pages of the process must be unmapped first, they may be shared frames of the image
 void elf_close(struct elf_file* file)
 {
     if(!file)
     {
         return;
     }
-    kfree(file->elf_memory); //Free allocated space from loaded file
+
+    if(file->refcount > 1)
+    {
+        file->refcount--;
+        return;
+    }
+
+    for(struct elf_file** link = &elf_images; *link; link = &(*link)->next)
+    {
+        if(*link == file)
+        {
+            *link = file->next;
+            break;
+        }
+    }
+
+    if(file->shared_pages)
+    {
+        for(uint32_t i = 0; i < file->total_pages; i++)
+        {
+            if(file->shared_pages[i].frame)
+            {
+                kframe_free(file->shared_pages[i].frame);
+            }
+        }
+        kfree(file->shared_pages);
+    }
+
+    if(file->fd)
+    {
+        fclose(file->fd); //Closes the filesystem handler
+    }
+
+    if(file->elf_memory)
+    {
+        kfree(file->elf_memory); //Free the loaded headers
+    }
     kfree(file); //Free allocated space for structure
 }
\ No newline at end of file
@@ -3,17 +3,47 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
 
 #include "elf.h"
 #include "config.h"
+#include "task/task.h"
 
+//Frame shared by every process that maps a page of a read-only segment
+struct elf_shared_page
+{
+    void* frame; //0 until a process touches the page
+    uint32_t size; //Bytes of the file held at the beginning of the frame, the rest is zero
+};
+
+//Image of an elf file. Processes running the same file share it, it is freed when the last one closes it
 struct elf_file
 {
     char filename[CROSOS_MAX_PATH];
 
-    int in_memory_size;
+    //Identity of the file, checked before the image is shared
+    uint32_t file_id;
+
+    //Processes using the image
+    uint32_t refcount;
+
+    //Held from the seek to the end of the read, the processes of the image share its file descriptor
+    struct task_mutex lock;
+
+    //Frames of the read-only segments, a slot for every page of the file. Allocated on the first shared page
+    struct elf_shared_page* shared_pages;
+    uint32_t total_pages;
 
-    //Pointer to the physical address where the elf file is loaded at
+    //Next image in the cache
+    struct elf_file* next;
+
+    //File descriptor kept open while the program runs, its segments are read from it when they are touched
+    uint32_t fd;
+
+    //Size of the file in bytes
+    uint32_t file_size;
+
+    //Beginning of the file, from the elf header to the end of the program header table. The rest is never loaded
     void* elf_memory;
 
     //Virtual base address of the binary
@@ -21,26 +51,18 @@ struct elf_file
 
     //Ending virtual address
     void* virtual_end_address;
-
-    //Physical base address
-    void* physical_base_address; 
-
-    //Physical end address of the binary
-    void* physical_end_address;   
 };
 
 int32_t elf_load(const char* filename, struct elf_file** file_out);
 void elf_close(struct elf_file* file);
 void* elf_virtual_base(struct elf_file* file);
 void* elf_virtual_end(struct elf_file* file);
-void* elf_phys_base(struct elf_file* file);
-void* elf_phys_end(struct elf_file* file);
 struct elf_header* elf_header(struct elf_file* file);
-struct elf32_shdr* elf_sheader(struct elf_header* header);
 struct elf32_phdr* elf_pheader(struct elf_header* header);
 void* elf_memory(struct elf_file* file);
 struct elf32_phdr* elf_program_header(struct elf_header* header, int32_t index);
-struct elf32_shdr* elf_section(struct elf_header* header, int32_t index);
-void* elf_phdr_phys_address(struct elf_file* file, struct elf32_phdr* phdr);
+int32_t elf_read(struct elf_file* file, uint32_t offset, uint32_t size, void* out);
+int32_t elf_get_shared_page(struct elf_file* file, uint32_t offset, uint32_t size, void** frame_out);
+bool elf_is_shared_page(struct elf_file* file, uint32_t offset, void* frame);
 
 #endif
\ No newline at end of file
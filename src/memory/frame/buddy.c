@@ -0,0 +1,198 @@
+#include "buddy.h"
+#include "status.h"
+#include "memory/memory.h"
+#include <stdbool.h>
+
+//Translates a page index to its address
+static void* buddy_page_to_address(struct buddy_allocator* buddy, uint32_t page)
+{
+    return buddy->saddr + (page * BUDDY_PAGE_SIZE);
+}
+
+//Translates an address to its page index
+static uint32_t buddy_address_to_page(struct buddy_allocator* buddy, void* address)
+{
+    return ((uint32_t) (address - buddy->saddr)) / BUDDY_PAGE_SIZE;
+}
+
+//Pushes a free block to the list of its order and marks its first page
+static void buddy_push_free(struct buddy_allocator* buddy, uint32_t page, uint32_t order)
+{
+    struct buddy_block* block = buddy_page_to_address(buddy, page);
+    block->prev = 0;
+    block->next = buddy->free_lists[order];
+    if(block->next)
+    {
+        block->next->prev = block;
+    }
+    buddy->free_lists[order] = block;
+    buddy->free_blocks[order]++;
+    buddy->pages[page] = BUDDY_PAGE_FREE | order;
+}
+
+//Removes a free block from the list of its order and clears the mark of its first page
+static void buddy_remove_free(struct buddy_allocator* buddy, uint32_t page, uint32_t order)
+{
+    struct buddy_block* block = buddy_page_to_address(buddy, page);
+    if(block->prev)
+    {
+        block->prev->next = block->next;
+    }
+    else
+    {
+        buddy->free_lists[order] = block->next;
+    }
+
+    if(block->next)
+    {
+        block->next->prev = block->prev;
+    }
+    buddy->free_blocks[order]--;
+    buddy->pages[page] = 0;
+}
+
+//Create a new buddy allocator
+//ptr and end delimit the managed memory, both page aligned
+//pages is the per page table, already placed in memory with one entry per page
+int buddy_create(struct buddy_allocator* buddy, void* ptr, void* end, BUDDY_PAGE_ENTRY* pages)
+{
+    int res = CROSOS_ALL_OK;
+    if(((uint32_t) ptr % BUDDY_PAGE_SIZE) || ((uint32_t) end % BUDDY_PAGE_SIZE) || end <= ptr)
+    {
+        res = -EINVARG;
+        goto out;
+    }
+
+    memset(buddy, 0, sizeof(struct buddy_allocator));
+    buddy->saddr = ptr;
+    buddy->total_pages = (uint32_t) (end - ptr) / BUDDY_PAGE_SIZE;
+    buddy->pages = pages;
+    memset(pages, 0, buddy->total_pages * sizeof(BUDDY_PAGE_ENTRY));
+
+    //Carve the memory into the biggest naturally aligned blocks that fit
+    uint32_t page = 0;
+    while(page < buddy->total_pages)
+    {
+        uint32_t order = BUDDY_MAX_ORDER;
+        while((page % (1 << order)) || (page + (1 << order)) > buddy->total_pages)
+        {
+            order--;
+        }
+        buddy_push_free(buddy, page, order);
+        page += 1 << order;
+    }
+    buddy->free_pages = buddy->total_pages;
+
+out:
+    return res;
+}
+
+//Gets the smallest order whose blocks can hold 'size' bytes
+uint32_t buddy_order_for_size(size_t size)
+{
+    uint32_t order = 0;
+    while(order <= BUDDY_MAX_ORDER && ((size_t) BUDDY_PAGE_SIZE << order) < size)
+    {
+        order++;
+    }
+    return order;
+}
+
+//Allocates a block of 2^order pages. Bigger blocks are split in halves until the order is reached
+void* buddy_alloc(struct buddy_allocator* buddy, uint32_t order)
+{
+    if(order > BUDDY_MAX_ORDER)
+    {
+        buddy->failed_allocations++;
+        return 0;
+    }
+
+    //Smallest order with a free block
+    uint32_t current = order;
+    while(current <= BUDDY_MAX_ORDER && !buddy->free_lists[current])
+    {
+        current++;
+    }
+
+    if(current > BUDDY_MAX_ORDER)
+    {
+        buddy->failed_allocations++;
+        return 0; //No space left
+    }
+
+    uint32_t page = buddy_address_to_page(buddy, buddy->free_lists[current]);
+    buddy_remove_free(buddy, page, current);
+    while(current > order)
+    {
+        //Keep the lower half and give the upper half back to the lower order list
+        current--;
+        buddy_push_free(buddy, page + (1 << current), current);
+    }
+
+    buddy->pages[page] = BUDDY_PAGE_HEAD | order;
+    buddy->free_pages -= 1 << order;
+    buddy->allocations++;
+    return buddy_page_to_address(buddy, page);
+}
+
+//Frees a block and merges it with its buddy while the buddy is free as a whole
+void buddy_free(struct buddy_allocator* buddy, void* ptr)
+{
+    if(ptr < buddy->saddr)
+    {
+        return;
+    }
+
+    uint32_t page = buddy_address_to_page(buddy, ptr);
+    if(page >= buddy->total_pages || !(buddy->pages[page] & BUDDY_PAGE_HEAD))
+    {
+        return; //Not the start of an allocated block
+    }
+
+    uint32_t order = buddy->pages[page] & BUDDY_PAGE_ORDER_MASK;
+    buddy->pages[page] = 0;
+    buddy->free_pages += 1 << order;
+    buddy->frees++;
+
+    while(order < BUDDY_MAX_ORDER)
+    {
+        uint32_t buddy_page = page ^ (1 << order);
+        if(buddy_page + (1 << order) > buddy->total_pages || buddy->pages[buddy_page] != (BUDDY_PAGE_FREE | order))
+        {
+            break; //The buddy is in use or split
+        }
+
+        buddy_remove_free(buddy, buddy_page, order);
+        if(buddy_page < page)
+        {
+            page = buddy_page; //The merged block starts at the lower buddy
+        }
+        order++;
+    }
+
+    buddy_push_free(buddy, page, order);
+}
+
+//Fills 'stats' with the usage and fragmentation of the allocator
+void buddy_get_stats(struct buddy_allocator* buddy, struct buddy_stats* stats)
+{
+    memset(stats, 0, sizeof(struct buddy_stats));
+    stats->total_pages = buddy->total_pages;
+    stats->free_pages = buddy->free_pages;
+    stats->allocations = buddy->allocations;
+    stats->frees = buddy->frees;
+    stats->failed_allocations = buddy->failed_allocations;
+    for(uint32_t order = 0; order <= BUDDY_MAX_ORDER; order++)
+    {
+        stats->free_blocks[order] = buddy->free_blocks[order];
+        if(buddy->free_blocks[order])
+        {
+            stats->largest_free_pages = 1 << order;
+        }
+    }
+
+    if(stats->free_pages)
+    {
+        stats->fragmentation = 100 - ((stats->largest_free_pages * 100) / stats->free_pages);
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef BUDDY_H
+#define BUDDY_H
+#include <stdint.h>
+#include <stddef.h>
+
+#define BUDDY_PAGE_SIZE 4096
+#define BUDDY_MAX_ORDER 12 // Biggest block is 2^12 pages (16MB)
+
+//Per page marks. Only the first page of a block is marked, the rest of the pages stay at 0
+#define BUDDY_PAGE_FREE 0b10000000 // First page of a free block
+#define BUDDY_PAGE_HEAD 0b01000000 // First page of an allocated block
+#define BUDDY_PAGE_ORDER_MASK 0b00111111
+
+typedef unsigned char BUDDY_PAGE_ENTRY;
+
+//Node of a free list. It is stored inside the first page of the free block itself
+struct buddy_block
+{
+    struct buddy_block* next;
+    struct buddy_block* prev;
+};
+
+struct buddy_stats
+{
+    uint32_t total_pages;
+    uint32_t free_pages;
+    uint32_t free_blocks[BUDDY_MAX_ORDER + 1]; //Free blocks of every order
+    uint32_t largest_free_pages; //Pages of the biggest block that can be allocated right now
+    uint32_t fragmentation; //Percentage of free pages that are not part of the largest free block
+    uint32_t allocations;
+    uint32_t frees;
+    uint32_t failed_allocations;
+};
+
+struct buddy_allocator
+{
+    void* saddr; //Start address, page aligned
+    uint32_t total_pages;
+    BUDDY_PAGE_ENTRY* pages; //One entry per page, placed by the caller
+    struct buddy_block* free_lists[BUDDY_MAX_ORDER + 1]; //Free blocks of every order
+    uint32_t free_blocks[BUDDY_MAX_ORDER + 1];
+    uint32_t free_pages;
+    uint32_t allocations;
+    uint32_t frees;
+    uint32_t failed_allocations;
+};
+
+int buddy_create(struct buddy_allocator* buddy, void* ptr, void* end, BUDDY_PAGE_ENTRY* pages);
+uint32_t buddy_order_for_size(size_t size);
+void* buddy_alloc(struct buddy_allocator* buddy, uint32_t order);
+void buddy_free(struct buddy_allocator* buddy, void* ptr);
+void buddy_get_stats(struct buddy_allocator* buddy, struct buddy_stats* stats);
+
+#endif
@@ -0,0 +1,124 @@
+#include "kframe.h"
+#include "buddy.h"
+#include "config.h"
+#include "kernel.h"
+#include "memory/memory.h"
+#include "memory/heap/kheap.h"
+#include "status.h"
+
+struct buddy_allocator kernel_frames; //Page frames used for page tables, stacks and program images
+static BUDDY_PAGE_ENTRY kernel_frame_pages[CROSOS_FRAME_POOL_SIZE_BYTES / BUDDY_PAGE_SIZE];
+
+//Initializes the kernel page frame allocator
+void kframe_init()
+{
+    void* end = (void*) CROSOS_FRAME_POOL_ADDRESS + CROSOS_FRAME_POOL_SIZE_BYTES;
+    int res = buddy_create(&kernel_frames, (void*) CROSOS_FRAME_POOL_ADDRESS, end, kernel_frame_pages);
+    if(res < 0)
+    {
+        print("Failed to create page frame allocator\n");
+    }
+}
+
+//Allocates page aligned frames for 'size' bytes. The size is rounded up to a power of two pages
+void* kframe_alloc(size_t size)
+{
+    return buddy_alloc(&kernel_frames, buddy_order_for_size(size));
+}
+
+//Allocates page frames and initializes them to 0s
+void* kframe_zalloc(size_t size)
+{
+    void* ptr = kframe_alloc(size);
+    if(!ptr)
+    {
+        return 0;
+    }
+    memset(ptr, 0x00, size);
+    return ptr;
+}
+
+//Frees frames returned by kframe_alloc
+void kframe_free(void* ptr)
+{
+    buddy_free(&kernel_frames, ptr);
+}
+
+//Gets usage and fragmentation of the frame pool
+void kframe_get_stats(struct buddy_stats* stats)
+{
+    buddy_get_stats(&kernel_frames, stats);
+}
+
+//Pseudo random numbers for the stress test, the same sequence on every run
+static uint32_t kframe_churn_random(uint32_t* seed)
+{
+    *seed = *seed * 1103515245 + 12345;
+    return *seed >> 16;
+}
+
+//Stress test of the frame pool: every round frees about half of a set of small blocks of random sizes, allocates new ones
+//in the empty slots and then tries a large block. Shows if large allocations keep succeeding while the pool is churned
+int32_t kframe_churn_test(uint32_t rounds, struct kframe_churn_result* result)
+{
+    if(rounds == 0 || rounds > KFRAME_CHURN_MAX_ROUNDS)
+    {
+        return -EINVARG;
+    }
+
+    void** slots = kzalloc(sizeof(void*) * KFRAME_CHURN_SLOTS);
+    if(!slots)
+    {
+        return -ENOMEM;
+    }
+
+    memset(result, 0, sizeof(struct kframe_churn_result));
+    uint32_t seed = 1;
+    struct buddy_stats stats;
+    for(uint32_t round = 0; round < rounds; round++)
+    {
+        for(uint32_t i = 0; i < KFRAME_CHURN_SLOTS; i++)
+        {
+            if(slots[i] && kframe_churn_random(&seed) % 2)
+            {
+                buddy_free(&kernel_frames, slots[i]);
+                slots[i] = 0;
+            }
+            else if(!slots[i])
+            {
+                slots[i] = buddy_alloc(&kernel_frames, kframe_churn_random(&seed) % (KFRAME_CHURN_SMALL_MAX_ORDER + 1));
+                if(!slots[i])
+                {
+                    result->small_failures++;
+                }
+            }
+        }
+
+        void* large = buddy_alloc(&kernel_frames, KFRAME_CHURN_LARGE_ORDER);
+        if(large)
+        {
+            result->large_successes++;
+            buddy_free(&kernel_frames, large);
+        }
+
+        kframe_get_stats(&stats);
+        if(stats.fragmentation > result->peak_fragmentation)
+        {
+            result->peak_fragmentation = stats.fragmentation;
+        }
+        result->rounds++;
+    }
+
+    for(uint32_t i = 0; i < KFRAME_CHURN_SLOTS; i++)
+    {
+        if(slots[i])
+        {
+            buddy_free(&kernel_frames, slots[i]);
+        }
+    }
+    kfree(slots);
+
+    kframe_get_stats(&stats);
+    result->end_fragmentation = stats.fragmentation;
+    return 0;
+}
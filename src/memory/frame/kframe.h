@@ -0,0 +1,29 @@
+#ifndef KFRAME_H
+#define KFRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "buddy.h"
+
+#define KFRAME_CHURN_SLOTS 256 // Small blocks the stress test keeps allocated at once
+#define KFRAME_CHURN_SMALL_MAX_ORDER 3 // Small blocks are 1 to 8 pages
+#define KFRAME_CHURN_LARGE_ORDER 8 // Large block tried every round, 1MB like a program image
+#define KFRAME_CHURN_MAX_ROUNDS 100000
+
+//Result of kframe_churn_test
+struct kframe_churn_result
+{
+    uint32_t rounds;
+    uint32_t small_failures; //Small blocks that could not be allocated
+    uint32_t large_successes; //Rounds whose large block was allocated
+    uint32_t peak_fragmentation; //Highest fragmentation percentage seen after a round
+    uint32_t end_fragmentation; //Fragmentation once the test freed its blocks
+};
+
+void kframe_init();
+void* kframe_alloc(size_t size);
+void* kframe_zalloc(size_t size);
+void kframe_free(void* ptr);
+void kframe_get_stats(struct buddy_stats* stats);
+int32_t kframe_churn_test(uint32_t rounds, struct kframe_churn_result* result);
+#endif
@@ -59,6 +59,16 @@ int heap_create(struct heap* heap, void* ptr, void* end, struct heap_table* tabl
     size_t table_size = sizeof(HEAP_BLOCK_TABLE_ENTRY) * table->total;
     memset(table->entries, HEAP_BLOCK_TABLE_ENTRY_FREE, table_size);
 
+    //Clear the bitmap and mark the padding bits of the last word as taken, so no run can go past the end of the heap
+    size_t bitmap_words = HEAP_BITMAP_WORDS(table->total);
+    memset(table->bitmap, 0x00, bitmap_words * sizeof(uint32_t));
+    uint32_t used_bits = table->total % HEAP_BITMAP_BITS_PER_WORD;
+    if(used_bits)
+    {
+        table->bitmap[bitmap_words - 1] = HEAP_BITMAP_WORD_FULL << used_bits;
+    }
+    heap->free_hint = 0;
+
 out:
     return res;
 }
@@ -76,49 +86,122 @@ static uint32_t heap_align_value_to_upper(uint32_t val)
     return val;
 }
 
-//Gets the entry type by masking the table entry
-static int heap_get_entry_type(HEAP_BLOCK_TABLE_ENTRY entry) 
+//Sets or clears the bitmap bits for a run of blocks, a whole word at a time when possible
+static void heap_bitmap_set_range(struct heap* heap, uint32_t start_block, uint32_t total_blocks, bool taken)
 {
-    return entry & 0x0F; 
+    uint32_t* bitmap = heap->table->bitmap;
+    uint32_t block = start_block;
+    uint32_t end_block = start_block + total_blocks;
+    while(block < end_block)
+    {
+        uint32_t word = block / HEAP_BITMAP_BITS_PER_WORD;
+        uint32_t bit = block % HEAP_BITMAP_BITS_PER_WORD;
+        uint32_t count = HEAP_BITMAP_BITS_PER_WORD - bit; //Bits left in this word
+        if(count > end_block - block)
+        {
+            count = end_block - block;
+        }
+
+        uint32_t mask = count == HEAP_BITMAP_BITS_PER_WORD ? HEAP_BITMAP_WORD_FULL : ((1u << count) - 1) << bit;
+        if(taken)
+        {
+            bitmap[word] |= mask;
+        }
+        else
+        {
+            bitmap[word] &= ~mask;
+        }
+        block += count;
+    }
 }
 
-//Get start block by checking the flags on the entries of the table
-uint32_t heap_get_start_block(struct heap* heap, uint32_t total_blocks)
+//Finds a single free block. Every word below the hint is full, so this is O(1) amortized
+static int32_t heap_get_single_block(struct heap* heap)
 {
     struct heap_table* table = heap->table;
-    int bc = 0; // Current block number accumulated
-    int bs = -1; //First free block when found
+    uint32_t total_words = HEAP_BITMAP_WORDS(table->total);
+    for(uint32_t w = heap->free_hint; w < total_words; w++)
+    {
+        if(table->bitmap[w] != HEAP_BITMAP_WORD_FULL)
+        {
+            heap->free_hint = w;
+            return (w * HEAP_BITMAP_BITS_PER_WORD) + __builtin_ctz(~table->bitmap[w]); //First zero bit of the word
+        }
+    }
 
-    for(size_t i = 0; i < table->total; i++)
+    heap->free_hint = total_words;
+    return -ENOMEM;
+}
+
+//Get start block of a free run by scanning the bitmap one machine word at a time
+//Full words are skipped and empty words add 32 blocks to the run without looking at their bits
+int32_t heap_get_start_block(struct heap* heap, uint32_t total_blocks)
+{
+    if(total_blocks == 1)
+    {
+        return heap_get_single_block(heap);
+    }
+
+    struct heap_table* table = heap->table;
+    uint32_t total_words = HEAP_BITMAP_WORDS(table->total);
+    uint32_t bc = 0; // Current block number accumulated
+    int32_t bs = -1; //First free block when found
+
+    for(uint32_t w = heap->free_hint; w < total_words; w++)
     {
-        if(heap_get_entry_type(table->entries[i]) != HEAP_BLOCK_TABLE_ENTRY_FREE)
+        uint32_t word = table->bitmap[w];
+        if(word == HEAP_BITMAP_WORD_FULL)
         {
-            //Entry occupied, go to next iteration and restart
+            //Whole word occupied, restart the run
+            if(w == heap->free_hint)
+            {
+                heap->free_hint++; //Still a prefix of full words, future searches can skip it
+            }
             bc = 0;
             bs = -1;
             continue;
         }
 
-        //If its free and this is the first block
-        if(bs == -1) 
+        if(word == 0)
         {
-            bs = i;
+            //Whole word free, extend the run by all of its blocks at once
+            if(bs == -1)
+            {
+                bs = w * HEAP_BITMAP_BITS_PER_WORD;
+            }
+            bc += HEAP_BITMAP_BITS_PER_WORD;
+            if(bc >= total_blocks)
+            {
+                return bs;
+            }
+            continue;
         }
-        bc++;
-        if(bc == total_blocks) // Enough blocks already
+
+        for(uint32_t bit = 0; bit < HEAP_BITMAP_BITS_PER_WORD; bit++)
         {
-            break;
+            if(word & (1u << bit))
+            {
+                //Block occupied, restart the run
+                bc = 0;
+                bs = -1;
+                continue;
+            }
+
+            //If its free and this is the first block
+            if(bs == -1)
+            {
+                bs = (w * HEAP_BITMAP_BITS_PER_WORD) + bit;
+            }
+            bc++;
+            if(bc == total_blocks) // Enough blocks already
+            {
+                return bs;
+            }
         }
-
     }
 
     // Not found enough space
-        if(bs == -1)
-        {
-            return -ENOMEM;
-        }
-
-        return bs;
+    return -ENOMEM;
 }
 
 //Translates a heap block to an address
@@ -147,16 +230,29 @@ void heap_mark_blocks_taken(struct heap* heap, uint32_t start_block, uint32_t to
             entry |= HEAP_BLOCK_HAS_NEXT;
         }
     }
+
+    heap_bitmap_set_range(heap, start_block, total_blocks, true);
+
+    heap->used_blocks += total_blocks;
+    if(heap->used_blocks > heap->peak_used_blocks)
+    {
+        heap->peak_used_blocks = heap->used_blocks;
+    }
 }
 
 //Allocates blocks to the heap
 void* heap_malloc_blocks(struct heap* heap, uint32_t total_blocks)
 {
     void* address = 0;
+    if(total_blocks == 0)
+    {
+        goto out;
+    }
 
-    int start_block = heap_get_start_block(heap, total_blocks);
+    int32_t start_block = heap_get_start_block(heap, total_blocks);
     if(start_block < 0)
     {
+        heap->failed_allocations++;
         goto out; //No space in the heap
     }
 
@@ -179,15 +275,30 @@ uint32_t heap_address_to_block(struct heap* heap, void* address)
 void heap_mark_blocks_free(struct heap* heap, uint32_t starting_block) 
 {
     struct heap_table* table = heap->table;
+    uint32_t total_blocks = 0;
     for(int i = starting_block; i < (uint32_t) table->total; i++) 
     {
         HEAP_BLOCK_TABLE_ENTRY entry = table->entries[i];
         table->entries[i] = HEAP_BLOCK_TABLE_ENTRY_FREE; // Clear the state back to entry free
+        total_blocks++;
         if(!(entry & HEAP_BLOCK_HAS_NEXT)) //Checking if it is last block
         {
             break;
         }
     }
+
+    if(total_blocks == 0)
+    {
+        return; //Block outside of the heap
+    }
+
+    heap_bitmap_set_range(heap, starting_block, total_blocks, false);
+    heap->used_blocks -= total_blocks;
+    heap->frees++;
+    if(starting_block / HEAP_BITMAP_BITS_PER_WORD < heap->free_hint)
+    {
+        heap->free_hint = starting_block / HEAP_BITMAP_BITS_PER_WORD; //The freed word is not full anymore
+    }
 }
 
 //Alloc given size to the given heap
@@ -196,7 +307,14 @@ void* heap_malloc(struct heap* heap, size_t size)
     size_t aligned_size = heap_align_value_to_upper(size);
     uint32_t total_blocks = aligned_size / CROSOS_HEAP_BLOCK_SIZE;
 
-    return heap_malloc_blocks(heap, total_blocks); //Alloc required blocks
+    void* ptr = heap_malloc_blocks(heap, total_blocks); //Alloc required blocks
+    if(ptr)
+    {
+        heap->allocations++;
+        heap->bytes_requested += size;
+        heap->blocks_allocated += total_blocks;
+    }
+    return ptr;
 }
 
 //Frees space of a given pointer
@@ -204,4 +322,60 @@ void heap_free(struct heap* heap, void* ptr)
 {
     //It frees a group of blocks of the heap's table. The data in the heap is not cleared, it stays there as garbage
     heap_mark_blocks_free(heap, heap_address_to_block(heap, ptr));
+}
+
+//Returns the longest run of free blocks, walking the bitmap a word at a time
+static uint32_t heap_largest_free_run(struct heap* heap)
+{
+    struct heap_table* table = heap->table;
+    uint32_t total_words = HEAP_BITMAP_WORDS(table->total);
+    uint32_t largest = 0;
+    uint32_t run = 0;
+    for(uint32_t w = heap->free_hint; w < total_words; w++) //Words below the hint are full
+    {
+        uint32_t word = table->bitmap[w];
+        if(word == HEAP_BITMAP_WORD_FULL)
+        {
+            run = 0;
+            continue;
+        }
+
+        if(word == 0)
+        {
+            run += HEAP_BITMAP_BITS_PER_WORD;
+        }
+        else
+        {
+            for(uint32_t bit = 0; bit < HEAP_BITMAP_BITS_PER_WORD; bit++)
+            {
+                run = (word & (1u << bit)) ? 0 : run + 1;
+                if(run > largest)
+                {
+                    largest = run;
+                }
+            }
+        }
+
+        if(run > largest)
+        {
+            largest = run;
+        }
+    }
+    return largest;
+}
+
+//Fills 'stats' with the counters of the heap and its current fragmentation
+void heap_get_stats(struct heap* heap, struct heap_stats* stats)
+{
+    memset(stats, 0, sizeof(struct heap_stats));
+    stats->total_blocks = heap->table->total;
+    stats->used_blocks = heap->used_blocks;
+    stats->free_blocks = heap->table->total - heap->used_blocks;
+    stats->peak_used_blocks = heap->peak_used_blocks;
+    stats->largest_free_blocks = heap_largest_free_run(heap);
+    stats->allocations = heap->allocations;
+    stats->frees = heap->frees;
+    stats->failed_allocations = heap->failed_allocations;
+    stats->bytes_requested = heap->bytes_requested;
+    stats->blocks_allocated = heap->blocks_allocated;
 }
\ No newline at end of file
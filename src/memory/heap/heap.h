@@ -10,22 +10,54 @@
 #define HEAP_BLOCK_HAS_NEXT 0b10000000
 #define HEAP_BLOCK_IS_FIRST 0b01000000
 
+#define HEAP_BITMAP_BITS_PER_WORD 32
+#define HEAP_BITMAP_WORD_FULL 0xFFFFFFFF
+#define HEAP_BITMAP_WORDS(total_blocks) (((total_blocks) + HEAP_BITMAP_BITS_PER_WORD - 1) / HEAP_BITMAP_BITS_PER_WORD)
+
 typedef unsigned char HEAP_BLOCK_TABLE_ENTRY;
 
 struct heap_table
 {
     HEAP_BLOCK_TABLE_ENTRY* entries;
     size_t total;
+    //One bit per block, set when the block is taken. Must hold HEAP_BITMAP_WORDS(total) words
+    uint32_t* bitmap;
 };
 
 struct heap
 {
     struct heap_table* table; // Pointer to the table
     void* saddr; //Start address
+    uint32_t free_hint; //Every bitmap word below this index is full, searches start here
+
+    //Live counters, reported by heap_get_stats
+    uint32_t used_blocks;
+    uint32_t peak_used_blocks; //High water mark of 'used_blocks'
+    uint32_t allocations;
+    uint32_t frees;
+    uint32_t failed_allocations;
+    uint32_t bytes_requested; //Bytes asked by all the allocations
+    uint32_t blocks_allocated; //Blocks given to all the allocations, compared with 'bytes_requested' it shows the rounding waste
+};
+
+//Snapshot of the state of a heap
+struct heap_stats
+{
+    uint32_t total_blocks;
+    uint32_t used_blocks;
+    uint32_t free_blocks;
+    uint32_t peak_used_blocks;
+    uint32_t largest_free_blocks; //Longest run of free blocks, the biggest allocation that can succeed right now
+    uint32_t allocations;
+    uint32_t frees;
+    uint32_t failed_allocations;
+    uint32_t bytes_requested;
+    uint32_t blocks_allocated;
 };
 
 int heap_create(struct heap* heap, void* ptr, void* end, struct heap_table* table);
 void* heap_malloc(struct heap* heap, size_t size);
 void heap_free(struct heap* heap, void* ptr);
+void heap_get_stats(struct heap* heap, struct heap_stats* stats);
 
 #endif
\ No newline at end of file
@@ -6,6 +6,7 @@
 
 struct heap kernel_heap; //Made of the table and the start address of the heap
 struct heap_table kernel_heap_table; //Contains 4096B entries and size of the same table
+static uint32_t kernel_heap_bitmap[HEAP_BITMAP_WORDS(CROSOS_HEAP_SIZE_BYTES / CROSOS_HEAP_BLOCK_SIZE)]; //Free block index of the kernel heap
 
 //Initializes the kernel heap
 void kheap_init()
@@ -13,6 +14,7 @@ void kheap_init()
     int total_table_entries = CROSOS_HEAP_SIZE_BYTES / CROSOS_HEAP_BLOCK_SIZE;
     kernel_heap_table.entries =  (HEAP_BLOCK_TABLE_ENTRY*) CROSOS_HEAP_TABLE_ADDRESS; //Allocating the table at the address CROSOS_HEAP_TABLE_ADDRESS
     kernel_heap_table.total = total_table_entries; // Struct contents defined. The entries need to be initialized
+    kernel_heap_table.bitmap = kernel_heap_bitmap;
 
     void* end = (void*) CROSOS_HEAP_ADDRESS + CROSOS_HEAP_SIZE_BYTES; //Last address of the heap
     int res = heap_create(&kernel_heap, (void*) (CROSOS_HEAP_ADDRESS), end, &kernel_heap_table);
@@ -45,4 +47,10 @@ void* kzalloc(size_t size)
 void kfree(void* ptr)
 {
     heap_free(&kernel_heap, ptr);
+}
+
+//Returns the counters of the kernel heap
+void kheap_get_stats(struct heap_stats* stats)
+{
+    heap_get_stats(&kernel_heap, stats);
 }
\ No newline at end of file
@@ -3,8 +3,11 @@
 
 #include <stdint.h>
 #include <stddef.h>
+
+struct heap_stats;
 void kheap_init();
 void* kmalloc(size_t size);
 void kfree(void* ptr);
 void* kzalloc(size_t size);
+void kheap_get_stats(struct heap_stats* stats);
 #endif
\ No newline at end of file
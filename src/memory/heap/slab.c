@@ -0,0 +1,167 @@
+#include "slab.h"
+#include "kheap.h"
+#include "memory/memory.h"
+#include <stdbool.h>
+
+//Size of every object slot, big enough to hold the free list link
+static size_t kmem_cache_slot_size(struct kmem_cache* cache)
+{
+    size_t size = cache->object_size < sizeof(void*) ? sizeof(void*) : cache->object_size;
+    return (size + KMEM_OBJECT_ALIGN - 1) & ~(KMEM_OBJECT_ALIGN - 1);
+}
+
+//Offset of the first object inside a slab
+static size_t kmem_slab_objects_offset()
+{
+    return (sizeof(struct kmem_slab) + KMEM_OBJECT_ALIGN - 1) & ~(KMEM_OBJECT_ALIGN - 1);
+}
+
+//Number of objects that fit in a slab. 0 when the objects are too big for slabs
+static uint32_t kmem_cache_objects_per_slab(struct kmem_cache* cache)
+{
+    return (KMEM_SLAB_SIZE - kmem_slab_objects_offset()) / kmem_cache_slot_size(cache);
+}
+
+//Gets the slab of an object. Slabs are heap blocks, so they are aligned to their size
+static struct kmem_slab* kmem_slab_of(void* ptr)
+{
+    return (struct kmem_slab*) ((uint32_t) ptr & ~(KMEM_SLAB_SIZE - 1));
+}
+
+//Links a slab at the front of the partial list of its cache
+static void kmem_slab_link(struct kmem_cache* cache, struct kmem_slab* slab)
+{
+    slab->prev = 0;
+    slab->next = cache->partial;
+    if(cache->partial)
+    {
+        cache->partial->prev = slab;
+    }
+    cache->partial = slab;
+}
+
+//Unlinks a slab from the partial list of its cache
+static void kmem_slab_unlink(struct kmem_cache* cache, struct kmem_slab* slab)
+{
+    if(slab->prev)
+    {
+        slab->prev->next = slab->next;
+    }
+    else
+    {
+        cache->partial = slab->next;
+    }
+
+    if(slab->next)
+    {
+        slab->next->prev = slab->prev;
+    }
+    slab->next = 0;
+    slab->prev = 0;
+}
+
+//Takes a new block from the kernel heap and threads all its objects in the free list
+static struct kmem_slab* kmem_slab_new(struct kmem_cache* cache)
+{
+    struct kmem_slab* slab = kmalloc(KMEM_SLAB_SIZE);
+    if(!slab)
+    {
+        return 0;
+    }
+
+    memset(slab, 0x00, sizeof(struct kmem_slab));
+    slab->cache = cache;
+
+    size_t slot_size = kmem_cache_slot_size(cache);
+    uint32_t total = kmem_cache_objects_per_slab(cache);
+    char* object = (char*) slab + kmem_slab_objects_offset();
+    for(uint32_t i = 0; i < total; i++)
+    {
+        *(void**) object = slab->free_list; //Push the object to the free list
+        slab->free_list = object;
+        object += slot_size;
+    }
+
+    cache->total_slabs++;
+    kmem_slab_link(cache, slab);
+    return slab;
+}
+
+//Allocates an object from the cache. The contents are not initialized
+void* kmem_cache_alloc(struct kmem_cache* cache)
+{
+    if(!kmem_cache_objects_per_slab(cache))
+    {
+        return kmalloc(cache->object_size); //Objects too big for a slab go straight to the heap
+    }
+
+    struct kmem_slab* slab = cache->partial;
+    if(!slab)
+    {
+        slab = kmem_slab_new(cache);
+        if(!slab)
+        {
+            return 0;
+        }
+    }
+
+    void* object = slab->free_list; //Pop the first free object
+    slab->free_list = *(void**) object;
+    slab->inuse++;
+    cache->active_objects++;
+
+    if(!slab->free_list)
+    {
+        kmem_slab_unlink(cache, slab); //Slab full, no more allocations from it
+    }
+
+    return object;
+}
+
+//Allocates an object from the cache and initializes it to 0s
+void* kmem_cache_zalloc(struct kmem_cache* cache)
+{
+    void* object = kmem_cache_alloc(cache);
+    if(!object)
+    {
+        return 0;
+    }
+
+    memset(object, 0x00, cache->object_size);
+    return object;
+}
+
+//Returns an object to its slab. Empty slabs are given back to the heap, except the last one with free objects
+void kmem_cache_free(struct kmem_cache* cache, void* ptr)
+{
+    if(!ptr)
+    {
+        return;
+    }
+
+    if(!kmem_cache_objects_per_slab(cache))
+    {
+        kfree(ptr);
+        return;
+    }
+
+    struct kmem_slab* slab = kmem_slab_of(ptr);
+    bool was_full = slab->free_list == 0;
+    *(void**) ptr = slab->free_list; //Push the object to the free list
+    slab->free_list = ptr;
+    slab->inuse--;
+    cache->active_objects--;
+
+    if(was_full)
+    {
+        kmem_slab_link(cache, slab); //It has a free object again
+    }
+
+    if(slab->inuse == 0 && (slab->next || slab->prev))
+    {
+        //Empty and there are other slabs to allocate from
+        kmem_slab_unlink(cache, slab);
+        cache->total_slabs--;
+        kfree(slab);
+    }
+}
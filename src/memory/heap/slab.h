@@ -0,0 +1,39 @@
+#ifndef SLAB_H
+#define SLAB_H
+#include "config.h"
+#include <stdint.h>
+#include <stddef.h>
+
+//Every slab is a single kernel heap block. Its header sits at the start of the block, followed by the objects
+#define KMEM_SLAB_SIZE CROSOS_HEAP_BLOCK_SIZE
+#define KMEM_OBJECT_ALIGN 4
+
+struct kmem_cache;
+
+//Header of a slab, placed at the beginning of the heap block that holds its objects
+struct kmem_slab
+{
+    struct kmem_cache* cache; //Cache that owns the slab
+    struct kmem_slab* next; //Next slab with free objects
+    struct kmem_slab* prev; //Previous slab with free objects
+    void* free_list; //Free objects, linked through their first word
+    uint32_t inuse; //Objects handed out from this slab
+};
+
+//Cache of equally sized objects. It can be statically initialized with KMEM_CACHE_INIT
+struct kmem_cache
+{
+    const char* name;
+    size_t object_size; //Size requested by the user of the cache
+    struct kmem_slab* partial; //Slabs with at least one free object
+    uint32_t total_slabs; //Slabs currently taken from the kernel heap
+    uint32_t active_objects; //Objects currently handed out
+};
+
+#define KMEM_CACHE_INIT(cache_name, size) { .name = (cache_name), .object_size = (size) }
+
+void* kmem_cache_alloc(struct kmem_cache* cache);
+void* kmem_cache_zalloc(struct kmem_cache* cache);
+void kmem_cache_free(struct kmem_cache* cache, void* ptr);
+
+#endif
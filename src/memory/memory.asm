@@ -0,0 +1,124 @@
+[BITS 32]
+
+section .asm
+
+global memory_copy_dwords
+global memory_set_dwords
+global memory_copy_blocks_sse2
+global memory_set_blocks_sse2
+global memory_cpu_features
+global memory_enable_sse
+global memory_read_cycles
+
+; void memory_copy_dwords(void* dest, void* src, uint32_t count)
+memory_copy_dwords:
+    push ebp
+    mov ebp, esp
+    push edi
+    push esi
+    mov edi, [ebp+8] ; destination
+    mov esi, [ebp+12] ; source
+    mov ecx, [ebp+16] ; number of 4 byte words
+    cld ; copy forward
+    rep movsd
+    pop esi
+    pop edi
+    pop ebp
+    ret
+
+; void memory_set_dwords(void* dest, uint32_t value, uint32_t count)
+memory_set_dwords:
+    push ebp
+    mov ebp, esp
+    push edi
+    mov edi, [ebp+8] ; destination
+    mov eax, [ebp+12] ; value repeated on every word
+    mov ecx, [ebp+16] ; number of 4 byte words
+    cld
+    rep stosd
+    pop edi
+    pop ebp
+    ret
+
+; void memory_copy_blocks_sse2(void* dest, void* src, uint32_t blocks)
+; Copies 'blocks' chunks of 64 bytes. 'dest' must be 16 byte aligned, 'src' may be unaligned
+memory_copy_blocks_sse2:
+    push ebp
+    mov ebp, esp
+    mov edx, [ebp+8] ; destination
+    mov eax, [ebp+12] ; source
+    mov ecx, [ebp+16] ; number of blocks
+    test ecx, ecx
+    jz .out
+.loop:
+    movdqu xmm0, [eax]
+    movdqu xmm1, [eax+16]
+    movdqu xmm2, [eax+32]
+    movdqu xmm3, [eax+48]
+    movdqa [edx], xmm0
+    movdqa [edx+16], xmm1
+    movdqa [edx+32], xmm2
+    movdqa [edx+48], xmm3
+    add eax, 64
+    add edx, 64
+    dec ecx
+    jnz .loop
+.out:
+    pop ebp
+    ret
+
+; void memory_set_blocks_sse2(void* dest, uint32_t value, uint32_t blocks)
+; Fills 'blocks' chunks of 64 bytes with 'value'. 'dest' must be 16 byte aligned
+memory_set_blocks_sse2:
+    push ebp
+    mov ebp, esp
+    mov edx, [ebp+8] ; destination
+    movd xmm0, [ebp+12] ; value
+    pshufd xmm0, xmm0, 0 ; repeat it on the four words of the register
+    mov ecx, [ebp+16] ; number of blocks
+    test ecx, ecx
+    jz .out
+.loop:
+    movdqa [edx], xmm0
+    movdqa [edx+16], xmm0
+    movdqa [edx+32], xmm0
+    movdqa [edx+48], xmm0
+    add edx, 64
+    dec ecx
+    jnz .loop
+.out:
+    pop ebp
+    ret
+
+; uint32_t memory_cpu_features()
+; Returns the EDX feature flags of CPUID leaf 1
+memory_cpu_features:
+    push ebp
+    mov ebp, esp
+    push ebx ; cpuid overwrites ebx
+    mov eax, 1
+    cpuid
+    mov eax, edx
+    pop ebx
+    pop ebp
+    ret
+
+; void memory_enable_sse()
+memory_enable_sse:
+    push ebp
+    mov ebp, esp
+    mov eax, cr0
+    and eax, ~0x4 ; clear EM, no x87 emulation
+    or eax, 0x2 ; set MP
+    mov cr0, eax
+    mov eax, cr4
+    or eax, 0x600 ; set OSFXSR and OSXMMEXCPT, SSE instructions are allowed
+    mov cr4, eax
+    pop ebp
+    ret
+
+; uint64_t memory_read_cycles()
+; Returns the time stamp counter, rdtsc leaves it in edx:eax where a 64 bit value is returned
+memory_read_cycles:
+    rdtsc
+    ret
@@ -1,21 +1,114 @@
 #include "memory.h"
+#include <stdbool.h>
+#include "status.h"
 
-//Allocates the 'c' parameter on the values pointed by 'ptr', and the pointer increments 'size' times
-void* memset(void* ptr, uint32_t c, size_t size)
+//Calls to ASM code
+extern void memory_copy_dwords(void* dest, void* src, uint32_t count);
+extern void memory_set_dwords(void* dest, uint32_t value, uint32_t count);
+extern void memory_copy_blocks_sse2(void* dest, void* src, uint32_t blocks);
+extern void memory_set_blocks_sse2(void* dest, uint32_t value, uint32_t blocks);
+extern uint32_t memory_cpu_features();
+extern void memory_enable_sse();
+
+static bool memory_use_sse2 = false; //Selected at boot by memory_init
+
+//Checks the processor features and enables the SSE2 versions of the memory functions when they are available
+void memory_init()
+{
+    uint32_t features = memory_cpu_features();
+    if((features & MEMORY_CPUID_FXSR) && (features & MEMORY_CPUID_SSE2))
+    {
+        memory_enable_sse();
+        memory_use_sse2 = true;
+    }
+}
+
+//Returns the version of the memory functions selected at boot
+static uint32_t memory_default_variant()
+{
+    return memory_use_sse2 ? MEMORY_VARIANT_SSE2 : MEMORY_VARIANT_DWORDS;
+}
+
+//Returns the alignment for the destination of a bulk operation of 'size' bytes
+static uint32_t memory_bulk_alignment(size_t size, uint32_t variant)
+{
+    return variant == MEMORY_VARIANT_SSE2 && size >= MEMORY_SSE2_MIN_SIZE ? MEMORY_SSE2_ALIGN : sizeof(uint32_t);
+}
+
+//memset with the given version of the bulk loop
+static void* memory_set(void* ptr, uint32_t c, size_t size, uint32_t variant)
 {
-    char* c_ptr = (char*) ptr;
-    for(int i = 0; i < size; i++)
+    uint8_t* d = ptr;
+    if(variant == MEMORY_VARIANT_BYTES)
     {
-        c_ptr[i] = (char) c;
+        while(size--)
+        {
+            *d++ = (uint8_t) c;
+        }
+        return ptr;
+    }
+
+    uint32_t pattern = (uint8_t) c * 0x01010101; //The byte repeated on a whole word
+    uint32_t align = memory_bulk_alignment(size, variant);
+    while(size && ((uint32_t) d & (align - 1))) //Bytes until the destination is aligned
+    {
+        *d++ = (uint8_t) c;
+        size--;
+    }
+
+    if(align == MEMORY_SSE2_ALIGN)
+    {
+        uint32_t blocks = size / MEMORY_SSE2_BLOCK_SIZE;
+        memory_set_blocks_sse2(d, pattern, blocks);
+        d += blocks * MEMORY_SSE2_BLOCK_SIZE;
+        size -= blocks * MEMORY_SSE2_BLOCK_SIZE;
+    }
+
+    uint32_t words = size / sizeof(uint32_t);
+    memory_set_dwords(d, pattern, words);
+    d += words * sizeof(uint32_t);
+    size -= words * sizeof(uint32_t);
+
+    while(size--) //Remaining tail
+    {
+        *d++ = (uint8_t) c;
     }
     return ptr;
 }
 
-//Compares the contents of two pointers for 'count' positions
-uint32_t memcmp(void* s1, void* s2, uint32_t count)
+//Allocates the 'c' parameter on the values pointed by 'ptr', and the pointer increments 'size' times
+void* memset(void* ptr, uint32_t c, size_t size)
+{
+    return memory_set(ptr, c, size, memory_default_variant());
+}
+
+//memcmp with the given version. There is no SSE2 version, the word loop stops at the first difference anyway
+static uint32_t memory_compare(void* s1, void* s2, uint32_t count, uint32_t variant)
 {
     char* c1 = s1;
     char* c2 = s2;
+    if(variant != MEMORY_VARIANT_BYTES && (((uint32_t) c1 ^ (uint32_t) c2) & (sizeof(uint32_t) - 1)) == 0)
+    {
+        //Same alignment, compare whole words until the first difference
+        while(count && ((uint32_t) c1 & (sizeof(uint32_t) - 1)))
+        {
+            if(*c1 != *c2)
+            {
+                return *c1 < *c2 ? -1:1;
+            }
+            c1++;
+            c2++;
+            count--;
+        }
+
+        while(count >= sizeof(uint32_t) && *(uint32_t*) c1 == *(uint32_t*) c2)
+        {
+            c1 += sizeof(uint32_t);
+            c2 += sizeof(uint32_t);
+            count -= sizeof(uint32_t);
+        }
+    }
+
     while(count-- > 0)
     {
         if(*c1++ != *c2++)
@@ -27,14 +120,91 @@ uint32_t memcmp(void* s1, void* s2, uint32_t count)
     return 0;
 }
 
-//Copies 'len' address contents from 'src' to 'dest'
-void* memcpy(void* dest, void* src, uint32_t len)
+//Compares the contents of two pointers for 'count' positions
+uint32_t memcmp(void* s1, void* s2, uint32_t count)
+{
+    return memory_compare(s1, s2, count, MEMORY_VARIANT_DWORDS);
+}
+
+//memcpy with the given version of the bulk loop
+static void* memory_copy(void* dest, void* src, uint32_t len, uint32_t variant)
 {
-    char *d = dest;
-    char* s = src;
-    while(len--)
+    uint8_t* d = dest;
+    uint8_t* s = src;
+    if(variant == MEMORY_VARIANT_BYTES)
+    {
+        while(len--)
+        {
+            *d++ = *s++;
+        }
+        return dest;
+    }
+
+    uint32_t align = memory_bulk_alignment(len, variant);
+    while(len && ((uint32_t) d & (align - 1))) //Bytes until the destination is aligned
+    {
+        *d++ = *s++;
+        len--;
+    }
+
+    if(align == MEMORY_SSE2_ALIGN)
+    {
+        uint32_t blocks = len / MEMORY_SSE2_BLOCK_SIZE;
+        memory_copy_blocks_sse2(d, s, blocks);
+        d += blocks * MEMORY_SSE2_BLOCK_SIZE;
+        s += blocks * MEMORY_SSE2_BLOCK_SIZE;
+        len -= blocks * MEMORY_SSE2_BLOCK_SIZE;
+    }
+
+    uint32_t words = len / sizeof(uint32_t);
+    memory_copy_dwords(d, s, words);
+    d += words * sizeof(uint32_t);
+    s += words * sizeof(uint32_t);
+    len -= words * sizeof(uint32_t);
+
+    while(len--) //Remaining tail
     {
         *d++ = *s++;
     }
     return dest;
-}
\ No newline at end of file
+}
+
+//Copies 'len' address contents from 'src' to 'dest'
+void* memcpy(void* dest, void* src, uint32_t len)
+{
+    return memory_copy(dest, src, len, memory_default_variant());
+}
+
+//Runs one version of a memory function 'iterations' times on 'size' bytes and gives the processor cycles it took.
+//'src' is only used by copies and compares. Returns -EUNIMP for the SSE2 versions when the processor has no SSE2
+int32_t memory_benchmark(uint32_t op, uint32_t variant, void* dest, void* src, uint32_t size, uint32_t iterations, uint32_t* cycles)
+{
+    if(op > MEMORY_OP_COMPARE || variant > MEMORY_VARIANT_SSE2 || (op == MEMORY_OP_COMPARE && variant == MEMORY_VARIANT_SSE2))
+    {
+        return -EINVARG;
+    }
+    if(variant == MEMORY_VARIANT_SSE2 && !memory_use_sse2)
+    {
+        return -EUNIMP;
+    }
+
+    memory_copy(dest, src, size, MEMORY_VARIANT_DWORDS); //Same contents, so the compares go through the whole size
+    uint32_t start = memory_read_cycles();
+    for(uint32_t i = 0; i < iterations; i++)
+    {
+        if(op == MEMORY_OP_COPY)
+        {
+            memory_copy(dest, src, size, variant);
+        }
+        else if(op == MEMORY_OP_SET)
+        {
+            memory_set(dest, i, size, variant);
+        }
+        else
+        {
+            memory_compare(dest, src, size, variant);
+        }
+    }
+    *cycles = memory_read_cycles() - start; //The low 32 bits of the time stamp counter are enough for the short runs
+    return 0;
+}
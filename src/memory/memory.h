@@ -4,7 +4,43 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#define MEMORY_CPUID_FXSR (1 << 24) // FXSAVE/FXRSTOR, needed to enable SSE
+#define MEMORY_CPUID_SSE2 (1 << 26)
+#define MEMORY_SSE2_ALIGN 16 // Destination alignment of the SSE2 stores
+#define MEMORY_SSE2_BLOCK_SIZE 64 // Bytes moved per iteration of the SSE2 loops
+#define MEMORY_SSE2_MIN_SIZE 256 // Smaller sizes are not worth aligning to 16 bytes
+
+//Versions of the memory functions, memory_benchmark runs any of them
+#define MEMORY_VARIANT_BYTES 0
+#define MEMORY_VARIANT_DWORDS 1
+#define MEMORY_VARIANT_SSE2 2 // Copy and set only
+
+#define MEMORY_OP_COPY 0
+#define MEMORY_OP_SET 1
+#define MEMORY_OP_COMPARE 2
+
+#define MEMORY_BENCHMARK_MAX_SIZE 65536
+#define MEMORY_BENCHMARK_MAX_OFFSET 64
+#define MEMORY_BENCHMARK_MAX_ITERATIONS 65536
+
+//A run of memory_benchmark asked by a process
+struct memory_benchmark
+{
+    uint32_t op;
+    uint32_t variant;
+    uint32_t size;
+    uint32_t dest_offset; //Bytes after a page boundary, to time unaligned buffers
+    uint32_t src_offset;
+    uint32_t iterations;
+    uint32_t cycles; //Written by the kernel
+};
+
+void memory_init();
+uint64_t memory_read_cycles();
+
 void* memset(void* ptr, uint32_t c, size_t size);
 uint32_t memcmp(void* s1, void* s2, uint32_t count);
 void* memcpy(void* dest, void* src, uint32_t len);
+int32_t memory_benchmark(uint32_t op, uint32_t variant, void* dest, void* src, uint32_t size, uint32_t iterations, uint32_t* cycles);
+
 #endif
\ No newline at end of file
@@ -4,6 +4,9 @@ section .asm
 
 global paging_load_directory
 global enable_paging
+global paging_invalidate_page
+global paging_enable_global_pages
+global paging_get_fault_address
 
 paging_load_directory:
     push ebp
@@ -20,4 +23,32 @@ enable_paging:
     or eax, 0x80000000; set bit that enables paging
     mov cr0, eax ; in the cr0 register
     pop ebp ; Recover original base pointer
+    ret
+
+paging_invalidate_page:
+    push ebp
+    mov ebp, esp
+    mov eax, [ebp+8] ; virtual address of the page
+    invlpg [eax] ; drop its translation from the TLB, global or not
+    pop ebp
+    ret
+
+paging_get_fault_address:
+    mov eax, cr2 ; address that caused the last page fault
+    ret
+
+paging_enable_global_pages:
+    push ebp
+    mov ebp, esp
+    push ebx ; cpuid overwrites ebx
+    mov eax, 1
+    cpuid
+    test edx, 0x2000 ; PGE feature bit
+    jz .out ; Not supported, the global bit of the entries is ignored
+    mov eax, cr4
+    or eax, 0x80 ; set bit that enables global pages
+    mov cr4, eax
+.out:
+    pop ebx
+    pop ebp
     ret
\ No newline at end of file
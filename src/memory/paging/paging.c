@@ -1,55 +1,154 @@
 #include "paging.h"
 #include "memory/heap/kheap.h"
+#include "memory/heap/slab.h"
+#include "memory/frame/kframe.h"
 #include "status.h"
 
 
 extern void paging_load_directory(uint32_t* directory);
+extern void paging_invalidate_page(void* virt);
 
 static uint32_t* current_directory = 0;
+static struct kmem_cache paging_chunk_cache = KMEM_CACHE_INIT("paging_4gb_chunk", sizeof(struct paging_4gb_chunk));
 
-//Create new page directory and tables to manage 4GB of memory
-//The addresses stores on the tables are linear. This means that there is no mapping from the directory + table entries
+//Kernel address space. Its page tables are shared by every other page directory
+static struct paging_4gb_chunk* kernel_chunk = 0;
+
+//Number of directory slots that hold the identity mapped kernel memory
+static uint32_t paging_identity_tables()
+{
+    return (CROSOS_PAGING_IDENTITY_END + PAGING_TABLE_SPAN - 1) / PAGING_TABLE_SPAN;
+}
+
+//Allocates the chunk that holds an empty page directory
+static struct paging_4gb_chunk* paging_new_chunk()
+{
+    uint32_t* directory = kframe_zalloc(sizeof(uint32_t) * PAGING_TOTAL_ENTRIES_PER_TABLE); //Allocate the page directory, all entries not present
+    if(!directory)
+    {
+        return 0;
+    }
+
+    struct paging_4gb_chunk* chunk_4gb = kmem_cache_zalloc(&paging_chunk_cache); //Allocate the struct that points to the page directory address
+    if(!chunk_4gb)
+    {
+        kframe_free(directory);
+        return 0;
+    }
+    chunk_4gb->directory_entry = directory; // Save the page directory address
+    return chunk_4gb;
+}
+
+//Checks if a directory entry points to one of the page tables of the kernel
+static bool paging_is_kernel_table(uint32_t directory_index, uint32_t entry)
+{
+    if(!kernel_chunk || directory_index >= paging_identity_tables())
+    {
+        return false;
+    }
+
+    return (entry & PAGING_ADDRESS_MASK) == (kernel_chunk->directory_entry[directory_index] & PAGING_ADDRESS_MASK);
+}
+
+//Create the kernel page directory
+//Only the kernel memory, up to CROSOS_PAGING_IDENTITY_END, gets page tables. The rest of the directory stays unmapped and its tables are created when something is mapped there
+//These tables are shared by all the other page directories and their pages are global, so they survive the TLB flush of a page directory switch
+//The addresses stored on the kernel tables are linear. This means that there is no mapping from the directory + table entries
 //Directory entry 0 table entry 0 points to the address 0
 //Directory entry 4 table entry 3 points to the addres 0x1000000 + 0x3000 = 0x1003000. NO TRICKS, just in order.
-struct paging_4gb_chunk* paging_new_4gb(uint8_t flags)
+struct paging_4gb_chunk* paging_new_kernel_4gb(uint8_t flags)
 {
-    uint32_t* directory = kzalloc(sizeof(uint32_t) * PAGING_TOTAL_ENTRIES_PER_TABLE); //Allocate all the page directory
-    int offset = 0;
-    for(int i = 0; i < PAGING_TOTAL_ENTRIES_PER_TABLE; i++) 
+    struct paging_4gb_chunk* chunk_4gb = paging_new_chunk();
+    if(!chunk_4gb)
     {
-        uint32_t* entry = kzalloc(sizeof(uint32_t) * PAGING_TOTAL_ENTRIES_PER_TABLE); //Allocate every page table
+        return 0;
+    }
+
+    uint32_t* directory = chunk_4gb->directory_entry;
+    uint32_t offset = 0;
+    for(uint32_t i = 0; i < paging_identity_tables(); i++) 
+    {
+        uint32_t* entry = kframe_alloc(sizeof(uint32_t) * PAGING_TOTAL_ENTRIES_PER_TABLE); //Allocate the page table, all its entries are written below
+        if(!entry)
+        {
+            paging_free_4gb(chunk_4gb);
+            return 0;
+        }
+
         for(int b = 0; b < PAGING_TOTAL_ENTRIES_PER_TABLE; b++) 
         {
-            entry[b] = (offset + (b * PAGING_PAGE_SIZE)) | flags; //Assign physical address to every page table entry, considering the flags
+            entry[b] = (offset + (b * PAGING_PAGE_SIZE)) | flags | PAGING_IS_GLOBAL; //Assign physical address to every page table entry, considering the flags
         }
-        offset += PAGING_TOTAL_ENTRIES_PER_TABLE * PAGING_PAGE_SIZE; //Increase offset for the following table physical addres, which is incremented
+        offset += PAGING_TABLE_SPAN; //Increase offset for the following table physical addres, which is incremented
         directory[i] = (uint32_t) entry | flags | PAGING_IS_WRITABLE; // Saves the created page table to the page directory, including the flags. The flags may specify that every table entry is not writable, but we want to enforce that every emtry in the page directory is writable
     }
 
-    struct paging_4gb_chunk* chunk_4gb = kzalloc(sizeof(struct paging_4gb_chunk)); //Allocate the struct that points to the page directory address
-    chunk_4gb->directory_entry = directory; // Save the page directory address
+    kernel_chunk = chunk_4gb;
+    return chunk_4gb;
+}
+
+//Create new page directory for a 4GB address space
+//The kernel memory is mapped by referencing the page tables of the kernel directory. 'flags' are set on those directory entries, the access to every page is decided by the kernel tables
+//A kernel table is copied into the new directory the first time the directory changes one of its entries
+struct paging_4gb_chunk* paging_new_4gb(uint8_t flags)
+{
+    if(!kernel_chunk)
+    {
+        return 0; //The kernel directory must be created first
+    }
+
+    struct paging_4gb_chunk* chunk_4gb = paging_new_chunk();
+    if(!chunk_4gb)
+    {
+        return 0;
+    }
+
+    for(uint32_t i = 0; i < paging_identity_tables(); i++)
+    {
+        uint32_t* table = (uint32_t*) (kernel_chunk->directory_entry[i] & PAGING_ADDRESS_MASK);
+        chunk_4gb->directory_entry[i] = (uint32_t) table | flags | PAGING_IS_WRITABLE;
+    }
+
     return chunk_4gb;
 }
 
-//Switches the current page directory
+//Switches the current page directory. Nothing is done if it is already loaded, to not flush the TLB for nothing
 void paging_switch(struct paging_4gb_chunk* directory)
 {
+    if(current_directory == directory->directory_entry)
+    {
+        return;
+    }
+
     paging_load_directory(directory->directory_entry); //Load to cr3 register the address of the page directory
     current_directory = directory->directory_entry; // Update the current directory, for when it is changed
 }
 
-//Frees all the page directory
+//Frees all the page directory. The shared kernel tables are not freed
 void paging_free_4gb(struct paging_4gb_chunk* chunk)
 {
-    for(uint32_t i = 0; i < 1024; i++)
+    if(current_directory == chunk->directory_entry && kernel_chunk && chunk != kernel_chunk)
+    {
+        paging_switch(kernel_chunk); //Never free the directory the processor is using
+    }
+
+    for(uint32_t i = 0; i < PAGING_TOTAL_ENTRIES_PER_TABLE; i++)
     {
         uint32_t entry = chunk->directory_entry[i]; //Gets the directory entry
-        uint32_t* table = (uint32_t*) (entry & 0xfffff000); //Gets the table address
-        kfree(table); //Frees the table
+        if(!(entry & PAGING_IS_PRESENT))
+        {
+            continue; //No table was ever created for this slot
+        }
+        if(chunk != kernel_chunk && paging_is_kernel_table(i, entry))
+        {
+            continue; //Shared with every other directory
+        }
+        uint32_t* table = (uint32_t*) (entry & PAGING_ADDRESS_MASK); //Gets the table address
+        kframe_free(table); //Frees the table
     }
 
-    kfree(chunk->directory_entry); //Frees the directory entries
-    kfree(chunk); //Frees the whole chunk
+    kframe_free(chunk->directory_entry); //Frees the directory entries
+    kmem_cache_free(&paging_chunk_cache, chunk); //Frees the whole chunk
 }
 
 //Gets the page directory
@@ -127,6 +226,21 @@ int32_t paging_map_range(struct paging_4gb_chunk* directory, void* virt, void* p
     return res;
 }
 
+//Removes 'count' pages from a page directory
+int32_t paging_unmap_range(struct paging_4gb_chunk* directory, void* virt, int32_t count)
+{
+    int32_t res = 0;
+    for(int32_t i = 0; i < count; i++)
+    {
+        res = paging_set(directory->directory_entry, virt, 0x00);
+        if(res < 0)
+            break;
+        virt += PAGING_PAGE_SIZE;
+    }
+
+    return res;
+}
+
 //Maps a physical address range to virtual addresses
 int32_t paging_map_to(struct paging_4gb_chunk* directory, void* virt, void* phys, void* phys_end, int32_t flags)
 {
@@ -180,8 +294,54 @@ uint32_t paging_set(uint32_t* directory, void* virt, uint32_t val)
     }
 
     uint32_t entry = directory[directory_index]; //Get directory entry
-    uint32_t* table = (uint32_t*) (entry & 0xfffff000); // Ignoring the flags of the entry and keep the address of the table
+    bool kernel_directory = kernel_chunk && directory == kernel_chunk->directory_entry;
+    if(!kernel_directory && paging_is_kernel_table(directory_index, entry))
+    {
+        //The directory is about to differ from the kernel in this slot, so it gets its own copy of the kernel table
+        uint32_t* kernel_table = (uint32_t*) (entry & PAGING_ADDRESS_MASK);
+        uint32_t* private_table = kframe_alloc(PAGING_PAGE_SIZE);
+        if(!private_table)
+        {
+            return -ENOMEM;
+        }
+
+        for(int i = 0; i < PAGING_TOTAL_ENTRIES_PER_TABLE; i++)
+        {
+            private_table[i] = kernel_table[i] & ~PAGING_IS_GLOBAL; //Global pages only come from the shared tables
+        }
+        entry = (uint32_t) private_table | (entry & ~PAGING_ADDRESS_MASK);
+        directory[directory_index] = entry;
+
+        //The kernel mapping of this page must not stay in the TLB across directory switches anymore
+        kernel_table[table_index] &= ~PAGING_IS_GLOBAL;
+    }
+    else if(!kernel_directory && directory_index < paging_identity_tables() && kernel_chunk)
+    {
+        //Private copy already exists, make sure the kernel entry of this page is not global either
+        uint32_t* kernel_table = (uint32_t*) (kernel_chunk->directory_entry[directory_index] & PAGING_ADDRESS_MASK);
+        kernel_table[table_index] &= ~PAGING_IS_GLOBAL;
+    }
+
+    if(!(entry & PAGING_IS_PRESENT))
+    {
+        if(!(val & PAGING_IS_PRESENT))
+        {
+            return 0; //Unmapping from a slot without table, nothing to do
+        }
+
+        //First mapping in this 4MB slot, create its page table
+        uint32_t* new_table = kframe_zalloc(PAGING_PAGE_SIZE);
+        if(!new_table)
+        {
+            return -ENOMEM;
+        }
+        entry = (uint32_t) new_table | PAGING_IS_PRESENT | PAGING_IS_WRITABLE | PAGING_ACCESS_FROM_ALL; //Access is restricted by the table entries
+        directory[directory_index] = entry;
+    }
+
+    uint32_t* table = (uint32_t*) (entry & PAGING_ADDRESS_MASK); // Ignoring the flags of the entry and keep the address of the table
     table[table_index] = val; // Set the address + flags to the pagins table
+    paging_invalidate_page(virt); //Drop the old translation from the TLB, even if it was global
 
     return 0;
 }
@@ -201,6 +361,10 @@ uint32_t paging_get(uint32_t* directory, void* virt)
     uint32_t table_index = 0;
     paging_get_indexes(virt, &directory_index, &table_index); //Get directory and table indexes
     uint32_t entry = directory[directory_index]; //Get entry of the directory
-    uint32_t* table = (uint32_t*) (entry & 0xFFFFF000); //Get table addres by ignoring flags
+    if(!(entry & PAGING_IS_PRESENT))
+    {
+        return 0; //Nothing mapped in this slot
+    }
+    uint32_t* table = (uint32_t*) (entry & PAGING_ADDRESS_MASK); //Get table addres by ignoring flags
     return table[table_index]; //Return table entry for the 'virt'
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <stddef.h>
 #include <stdbool.h>
 
+#define PAGING_IS_GLOBAL 0b100000000 // Kept in the TLB when the page directory is switched
 #define PAGING_CACHE_DISABLED 0b00010000
 #define PAGING_WRITE_THROUGH 0b00001000
 #define PAGING_ACCESS_FROM_ALL 0b00000100 // Accessed from all rings or only kernel
@@ -13,6 +14,8 @@
 
 #define PAGING_TOTAL_ENTRIES_PER_TABLE 1024
 #define PAGING_PAGE_SIZE 4096
+#define PAGING_TABLE_SPAN (PAGING_TOTAL_ENTRIES_PER_TABLE * PAGING_PAGE_SIZE) // Bytes covered by a page table (4MB)
+#define PAGING_ADDRESS_MASK 0xfffff000
 
 //Struct that represents the page directory for the kernel
 struct paging_4gb_chunk
@@ -22,7 +25,10 @@ struct paging_4gb_chunk
 
 void paging_switch(struct paging_4gb_chunk* directory);
 struct paging_4gb_chunk* paging_new_4gb(uint8_t flags);
+struct paging_4gb_chunk* paging_new_kernel_4gb(uint8_t flags);
 void enable_paging();
+void paging_enable_global_pages();
+void* paging_get_fault_address();
 
 bool paging_is_aligned(void* address);
 uint32_t paging_set(uint32_t* directory, void* virt, uint32_t val);
@@ -33,6 +39,7 @@ uint32_t* paging_4gb_chunk_get_directory(struct paging_4gb_chunk* chunk);
 int32_t paging_map_to(struct paging_4gb_chunk* directory, void* virt, void* phys, void* phys_end, int32_t flags);
 int32_t paging_map_range(struct paging_4gb_chunk* directory, void* virt, void* phys, int32_t count, int32_t flags);
 int32_t paging_map(struct paging_4gb_chunk* directory, void* virt, void* phys, int32_t flags);
+int32_t paging_unmap_range(struct paging_4gb_chunk* directory, void* virt, int32_t count);
 void* paging_align_address(void* ptr);
 uint32_t paging_get(uint32_t* directory, void* virt);
 void* paging_align_to_lower_page(void* addr);
@@ -7,6 +7,17 @@ char tolower(char s1)
     {
         s1 +=32;
     }
+    return s1;
+}
+
+//Turns the string into upper caps
+char toupper(char s1)
+{
+    if(s1 >= 97 && s1 <= 122) //ASCII table
+    {
+        s1 -=32;
+    }
+    return s1;
 }
 
 //Counts the length of a string
@@ -13,6 +13,7 @@ uint32_t strncmp(const char* str1, const char* str2, uint32_t n);
 uint32_t istrncmp(const char* s1, const char* s2, uint32_t n);
 uint32_t strnlen_terminator(const char* str, uint32_t max, char terminator);
 char tolower(char s1);
+char toupper(char s1);
 
 
 #endif
\ No newline at end of file
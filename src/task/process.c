@@ -2,16 +2,21 @@
 #include "memory/memory.h"
 #include "status.h"
 #include "memory/heap/kheap.h"
+#include "memory/heap/slab.h"
+#include "memory/frame/kframe.h"
 #include "fs/file.h"
 #include "string/string.h"
 #include "kernel.h"
 #include "memory/paging/paging.h"
 #include "loader/formats/elfloader.h"
+#include "vm.h"
 
 struct process* current_process = 0; //Current process that is running
 
 static struct process* processes[CROSOS_MAX_PROCESSES] = {};
 
+static struct kmem_cache process_allocation_cache = KMEM_CACHE_INIT("process_allocation", sizeof(struct process_allocation));
+
 //Cleans the allocated memory for the process
 static void process_init(struct process* process)
 {
@@ -42,19 +47,29 @@ int32_t process_switch(struct process* process)
     return 0;
 }
 
-//Finds a free spot on the allocations array
-static int32_t process_find_free_allocation_index(struct process* process)
+//Returns the hash bucket of an allocated address. Kernel heap allocations are block aligned, so the low bits are dropped
+static struct process_allocation** process_allocation_bucket(struct process* process, void* ptr)
 {
-    int32_t res = -ENOMEM;
-    for(int32_t i = 0; i<CROSOS_MAX_PROGRAM_ALLOCATIONS; i++)
+    uint32_t hash = (uint32_t) ptr / CROSOS_HEAP_BLOCK_SIZE;
+    return &process->allocations[hash % CROSOS_PROCESS_ALLOCATION_BUCKETS];
+}
+
+//Adds an allocation to the index of the process
+static int32_t process_allocation_add(struct process* process, void* ptr, size_t size)
+{
+    struct process_allocation* allocation = kmem_cache_alloc(&process_allocation_cache);
+    if(!allocation)
     {
-        if(process->allocations[i].ptr == 0)
-        {
-            res = i; // Return the free index
-            break;
-        }
+        return -ENOMEM;
     }
-    return res;
+
+    struct process_allocation** bucket = process_allocation_bucket(process, ptr);
+    allocation->ptr = ptr;
+    allocation->size = size;
+    allocation->next = *bucket; //Add it at the front of the bucket
+    *bucket = allocation;
+    process->total_allocations++;
+    return 0;
 }
 
 //Allocates memory for a process and stores it on its allocations array
@@ -65,18 +80,15 @@ void* process_malloc(struct process* process, size_t size)
     {
         return 0;
     }
-    int32_t index = process_find_free_allocation_index(process); //Find a free index on the array
-    if(index < 0)
+    int res = paging_map_to(process->task->page_directory, ptr, ptr, paging_align_address(ptr+size), PAGING_IS_WRITABLE | PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL); //Creates a new page for the malloc
+    if(res < 0)
     {
         goto out_err;
     }
-    int res = paging_map_to(process->task->page_directory, ptr, ptr, paging_align_address(ptr+size), PAGING_IS_WRITABLE | PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL); //Creates a new page for the malloc
-    if(res < 0)
+    if(process_allocation_add(process, ptr, size) < 0) //Index the allocation to free it later
     {
         goto out_err;
     }
-    process->allocations[index].ptr = ptr; //Assign the free spot to the allocated array
-    process->allocations[index].size = size;
     return ptr;
 
 out_err:
@@ -87,45 +99,57 @@ out_err:
     return 0;
 }
 
-//Finds for the pointer in the allocations array of a process
-static bool process_is_process_pointer(struct process* process, void* ptr)
+//Returns the link in the process index that points to the allocation of 'addr', or 0 if it is not a pointer of the process
+static struct process_allocation** process_get_allocation_link(void* addr, struct process* process)
 {
-    for(int32_t i = 0; i < CROSOS_MAX_PROGRAM_ALLOCATIONS; i++)
+    struct process_allocation** link = process_allocation_bucket(process, addr);
+    while(*link)
     {
-        if(process->allocations[i].ptr == ptr)
+        if((*link)->ptr == addr)
         {
-            return true; //Pointer found
+            return link;
         }
+        link = &(*link)->next;
     }
-    return false;
+    return 0;
 }
 
-//Frees the pointer found in the process' allocations array
-static void process_allocation_free(struct process* process, void* ptr)
+//Returns how many bytes from 'address' on belong to the process, in the same region or allocation. 0 if the address is not of the process
+//The kernel checks pointers given by the process with it before using them. 'write' only accepts writable memory
+uint32_t process_user_range_size(struct process* process, void* address, bool write)
 {
-    for (int32_t i = 0; i < CROSOS_MAX_PROGRAM_ALLOCATIONS; i++)
+    struct process_vm_region* region = process_vm_find_region(process, address);
+    if(region)
     {
-        if(process->allocations[i].ptr == ptr)
+        if(write && !(region->flags & PAGING_IS_WRITABLE))
         {
-            process->allocations[i].ptr = 0x00; //Free the allocation entry
-            process->allocations[i].size = 0;
+            return 0;
         }
+        return region->end - address;
     }
-}
 
-//Returns the allocation that matches with the provided pointer
-static struct process_allocation* process_get_allocation_by_addr(void* addr, struct process* process)
-{
-    for(int i = 0; i < CROSOS_MAX_PROGRAM_ALLOCATIONS; i++)
+    for(uint32_t i = 0; i < CROSOS_PROCESS_ALLOCATION_BUCKETS; i++)
     {
-        if(process->allocations[i].ptr == addr)
+        for(struct process_allocation* allocation = process->allocations[i]; allocation; allocation = allocation->next)
         {
-            return &process->allocations[i];
+            if(address >= allocation->ptr && address < allocation->ptr + allocation->size)
+            {
+                return allocation->ptr + allocation->size - address;
+            }
         }
     }
     return 0;
 }
 
+//Removes the allocation pointed by 'link' from the index of the process
+static void process_allocation_free(struct process* process, struct process_allocation** link)
+{
+    struct process_allocation* allocation = *link;
+    *link = allocation->next;
+    kmem_cache_free(&process_allocation_cache, allocation);
+    process->total_allocations--;
+}
+
 //Returns the arguments of the proces
 void process_get_arguments(struct process* process, int* argc, char*** argv)
 {
@@ -191,19 +215,42 @@ out:
 
 //Frees the allocations of a process
 static int process_terminate_allocations(struct process* process)
- {
-     for(int i = 0; i < CROSOS_MAX_PROGRAM_ALLOCATIONS; i++)
-     {
-         process_free(process, process->allocations[i].ptr);
-     }
+{
+    for(int i = 0; i < CROSOS_PROCESS_ALLOCATION_BUCKETS && process->total_allocations; i++)
+    {
+        while(process->allocations[i])
+        {
+            struct process_allocation* allocation = process->allocations[i];
+            process_free(process, allocation->ptr);
+            if(process->allocations[i] == allocation)
+            {
+                //The pages could not be remapped. The page directory goes away with the process, so the memory is freed anyway
+                kfree(allocation->ptr);
+                process_allocation_free(process, &process->allocations[i]);
+            }
+        }
+    }
 
-     return 0;
- }
+    return 0;
+}
+
+//Closes the files the process left open
+static void process_terminate_files(struct process* process)
+{
+    for(uint32_t i = 0; i < CROSOS_MAX_PROCESS_FILES; i++)
+    {
+        if(process->files[i])
+        {
+            fclose(process->files[i]);
+            process->files[i] = 0;
+        }
+    }
+}
 
 //Frees the loaded binary data of a process
 static int process_free_binary_data(struct process* process)
 {
-    kfree(process->ptr);
+    kframe_free(process->ptr);
     return 0;
 }
 
@@ -235,7 +282,7 @@ static int process_free_program_data(struct process* process)
 //Switches the process to the first process found
 static void process_switch_to_any()
 {
-    for(int i = 0; i < CROSOS_MAX_PROGRAM_ALLOCATIONS; i++)
+    for(int i = 0; i < CROSOS_MAX_PROCESSES; i++)
     {
         if(processes[i])
         {
@@ -261,18 +308,19 @@ static void process_unlink(struct process* process)
 int process_terminate(struct process* process)
 {
     int res = 0;
+    process_terminate_files(process); //Closing flushes the files it was writing
     res = process_terminate_allocations(process);
     if(res < 0)
     {
         goto out;
     }
 
+    process_vm_free_regions(process); //Free the pages touched by the process before its page directory goes away. Some may be shared pages of its elf image
     res = process_free_program_data(process);
     if(res < 0)
     {
         goto out;
     }
-    kfree(process->stack); //Free the process stack memory
 
     res = task_free(process->task);
     if(res < 0)
@@ -290,25 +338,58 @@ out:
 void process_free(struct process* process, void* ptr)
 {
 
-    struct process_allocation* allocation = process_get_allocation_by_addr(ptr, process);//Unlink the pages from the process for the given address
-    
-    if(!allocation)
+    struct process_allocation** link = process_get_allocation_link(ptr, process); //Unlink the pages from the process for the given address
+    if(!link)
     {
         return; //Not our pointer
     }
 
-    int res = paging_map_to(process->task->page_directory, allocation->ptr, allocation->ptr, paging_align_address(allocation->ptr + allocation->size), 0x00); //Free the page used before
+    struct process_allocation* allocation = *link;
+
+    //Give the pages back to the kernel mapping. They are not unmapped because the kernel runs on the task page directory and may reuse them
+    int res = paging_map_to(process->task->page_directory, allocation->ptr, allocation->ptr, paging_align_address(allocation->ptr + allocation->size), PAGING_IS_PRESENT | PAGING_IS_WRITABLE);
 
     if(res < 0)
     {
         return;
     }
 
-    process_allocation_free(process, ptr); //Free allocation
+    process_allocation_free(process, link); //Free allocation
     kfree(ptr); //Free contents in the pointer
 
 }
 
+//Moves the end of the process heap by 'increment' bytes and returns the previous end, or 0 on error
+//The heap is a lazy region, so growing it only costs a page fault when each page is first touched
+void* process_sbrk(struct process* process, int32_t increment)
+{
+    void* heap_start = (void*) CROSOS_PROGRAM_VIRTUAL_HEAP_ADDRESS;
+    if(!process->heap_break)
+    {
+        //First call, create the empty heap region
+        if(process_vm_add_region(process, heap_start, heap_start, PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL | PAGING_IS_WRITABLE, 0, 0) < 0)
+        {
+            return 0;
+        }
+        process->heap_break = heap_start;
+    }
+
+    void* old_break = process->heap_break;
+    if((increment > 0 && increment > heap_start + CROSOS_USER_PROGRAM_HEAP_MAX_SIZE - old_break) || (increment < 0 && -increment > old_break - heap_start))
+    {
+        return 0;
+    }
+
+    void* new_break = old_break + increment;
+    if(process_vm_resize_region(process, heap_start, paging_align_address(new_break)) < 0)
+    {
+        return 0;
+    }
+
+    process->heap_break = new_break;
+    return old_break;
+}
+
 //Loads the process binary file
 static int32_t process_load_binary(const char* filename, struct process* process)
 {
@@ -328,7 +409,7 @@ static int32_t process_load_binary(const char* filename, struct process* process
         goto out;
     }
 
-    program_data_pointer = kzalloc(stat.filesize); //Allocates the size of the process binary file to memory
+    program_data_pointer = kframe_zalloc(stat.filesize); //Allocates the size of the process binary file to memory
     if(!program_data_pointer)
     {
         res = -ENOMEM;
@@ -349,7 +430,7 @@ out:
     {
         if(program_data_pointer)
         {
-            kfree(program_data_pointer);
+            kframe_free(program_data_pointer);
         }
     }
     fclose(fd); //Since it is loaded into memory, we dont need the file handle anymore
@@ -388,9 +469,9 @@ static int32_t process_load_data(const char* filename, struct process* process)
 //Maps a binary file that is loaded into memory to a virtual address
 int32_t process_map_binary(struct process* process)
 {
-    int32_t res = 0;
-    paging_map_to(process->task->page_directory, (void*) CROSOS_PROGRAM_VIRTUAL_ADDRESS, process->ptr, paging_align_address(process->ptr + process->size), PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL | PAGING_IS_WRITABLE);
-    return res;
+    //Pages are mapped from the loaded binary when the program touches them
+    void* start = (void*) CROSOS_PROGRAM_VIRTUAL_ADDRESS;
+    return process_vm_add_region(process, start, paging_align_address(start + process->size), PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL | PAGING_IS_WRITABLE, process->ptr, process->size);
 }
 
 //Maps an elf file to the corresponding page of the process structure
@@ -404,16 +485,33 @@ int32_t process_map_elf(struct process* process)
     for(int32_t i = 0; i < header->e_phnum; i++) //Iterate every program header entry
     {
         struct elf32_phdr* phdr = &phdrs[i]; //Get the entry
-        void* phdr_phys_address = elf_phdr_phys_address(elf_file, phdr); //Get physical address of the program's header
         int32_t flags = PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL; //Flags set by OS
         if(phdr->p_flags & PF_W) //If the writable flag of the program header is set
         {
             flags |= PAGING_IS_WRITABLE; //Add the writable OS flag for the paging
         }
-        //Set a page for the code that the header points to
-        //Get the lower page of the header's virtual address and physical address
-        //Provide end physical address and flags
-        res = paging_map_to(process->task->page_directory, paging_align_to_lower_page((void*) phdr->p_vaddr), paging_align_to_lower_page((void*) phdr_phys_address), paging_align_address(phdr_phys_address + phdr->p_memsz), flags);
+        if(phdr->p_type != PT_LOAD)
+        {
+            continue;
+        }
+
+        //Add a lazy region for the segment. Its pages are read from the file when they are touched and the rest (.bss) is zero filled
+        //The region starts at the lower page of the segment, so the file is read from the same offset inside the page
+        void* start = paging_align_to_lower_page((void*) phdr->p_vaddr);
+        uint32_t page_offset = phdr->p_vaddr - (uint32_t) start;
+        void* end = paging_align_address((void*) phdr->p_vaddr + phdr->p_memsz);
+        if(!phdr->p_filesz)
+        {
+            res = process_vm_add_region(process, start, end, flags, 0, 0); //Only .bss, nothing to read
+        }
+        else if(phdr->p_offset < page_offset)
+        {
+            res = -EINFORMAT;
+        }
+        else
+        {
+            res = process_vm_add_file_region(process, start, end, flags, elf_file, phdr->p_offset - page_offset, phdr->p_filesz + page_offset);
+        }
         if(ISERR(res))
         {
             break;
@@ -442,7 +540,8 @@ int32_t process_map_memory(struct process* process)
         goto out;
     }
 
-    paging_map_to(process->task->page_directory, (void*) CROSOS_PROGRAM_VIRTUAL_STACK_ADDRESS_END, process->stack, paging_align_address(process->stack + CROSOS_USER_PROGRAM_STACK_SIZE), PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL | PAGING_IS_WRITABLE);
+    //Zero filled stack, its pages are given when the program grows into them
+    res = process_vm_add_region(process, (void*) CROSOS_PROGRAM_VIRTUAL_STACK_ADDRESS_LIMIT, (void*) CROSOS_PROGRAM_VIRTUAL_STACK_ADDRESS_START, PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL | PAGING_IS_WRITABLE, 0, 0);
 
 out:
     return res;
@@ -495,8 +594,7 @@ int32_t process_load_for_slot(const char* filename, struct process** process, ui
 {
     int32_t res = 0;
     struct task* task = 0;
-    struct process* _process;
-    void* program_stack_pointer = 0;
+    struct process* _process = 0;
 
     if(process_get(process_slot) != 0) //Checks that the slot is free
     {
@@ -512,26 +610,20 @@ int32_t process_load_for_slot(const char* filename, struct process** process, ui
     }
 
     process_init(_process); //Cleans the process memory allocation
+    processes[process_slot] = _process; //Reserve the slot, the task may sleep reading the file and another process could be loaded meanwhile
+
     res = process_load_data(filename, _process); //Call to load the file from the filesystem to the memory
     if(res < 0)
     {
         goto out;
     }
 
-    program_stack_pointer = kzalloc(CROSOS_USER_PROGRAM_STACK_SIZE); //Allocates a new stack for the process
-    if(!program_stack_pointer)
-    {
-        res = -ENOMEM;
-        goto out;
-    }
-
     strncpy(_process->filename, filename, sizeof(_process->filename)); //Copies the filename to the new process struct
-    _process->stack = program_stack_pointer;
     _process->id = process_slot;
 
     //Create a task
     task = task_new(_process); //Creates a task, and a page directory for it
-    if(ERROR_I(task) == 0)
+    if(ISERR(task))
     {
         res = ERROR_I(task);
         goto out;
@@ -547,18 +639,29 @@ int32_t process_load_for_slot(const char* filename, struct process** process, ui
 
     *process = _process; //Changes the pointer address of the provided process to the created one
 
-    //Add process to array
-    processes[process_slot] = _process;
-
 out:
     if(ISERR(res))
     {
+        if(_process && processes[process_slot] == _process)
+        {
+            processes[process_slot] = 0x00; //Release the reserved slot
+        }
+
         if(_process && _process->task)
         {
+            process_vm_free_regions(_process);
             task_free(_process->task);
         }
 
-    //Free process data
+        if(_process && _process->ptr)
+        {
+            process_free_program_data(_process); //An elf file keeps its file open
+        }
+
+        if(_process)
+        {
+            kfree(_process);
+        }
     }
 
     return res;
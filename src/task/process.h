@@ -3,6 +3,7 @@
 #include <stdint.h>
 #include "config.h"
 #include "task.h"
+#include "vm.h"
 #include <stdbool.h>
 
 #define PROCESS_FILETYPE_ELF 0
@@ -14,6 +15,7 @@ struct process_allocation
 {
     void* ptr;
     size_t size;
+    struct process_allocation* next; //Next allocation in the same hash bucket
 };
 
 struct command_argument
@@ -33,15 +35,18 @@ struct process
     uint8_t id; //Process id
     char filename[CROSOS_MAX_PATH];
     struct task* task; //Main process task
-    struct process_allocation allocations[CROSOS_MAX_PROGRAM_ALLOCATIONS]; //Whenever the process mallocs, we add the address here to free it when the process dies
+    struct process_allocation* allocations[CROSOS_PROCESS_ALLOCATION_BUCKETS]; //Whenever the process mallocs, the address is hashed here to free it when the process dies
+    uint32_t total_allocations; //Live entries in 'allocations'
     PROCESS_FILETYPE filetype; //It may be a binary or an elf file
     union 
     {
         void* ptr; //Physical pointer to process memory
         struct elf_file* elf_file;
     };
-    void* stack; //Pointer to process stack
     uint32_t size; //Size of the data pointer by 'ptr'
+    struct process_vm_region* vm_regions; //Lazily mapped ranges of the process (code, data and stack)
+    void* heap_break; //End of the heap handed out by sbrk, 0 until the first call
+    uint32_t files[CROSOS_MAX_PROCESS_FILES]; //Kernel file descriptors of the files the process opened, 0 for free slots. Handle 'i + 1' is slot 'i'
     struct keyboard_buffer //Structure that holds the input buffer of the used keyboard
     //It doesnt hold a keyboard struct itself, it is only the buffer
     {
@@ -59,6 +64,8 @@ struct process* process_current();
 
 void* process_malloc(struct process* process, size_t size);
 void process_free(struct process* process, void* ptr);
+void* process_sbrk(struct process* process, int32_t increment);
+uint32_t process_user_range_size(struct process* process, void* address, bool write);
 
 void process_get_arguments(struct process* process, int* argc, char*** argv);
 int process_inject_arguments(struct process* process, struct command_argument* root_argument);
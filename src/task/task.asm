@@ -5,6 +5,10 @@ section .asm
 global restore_general_purpose_registers
 global task_return
 global user_registers
+global task_kernel_switch
+global task_restore_kernel_context
+
+extern task_resume
 
 task_return: ; using registers* struct. Enter user land. Faking an interrupt. We are pushing to the stack all what the processor would push when an interrupt happens
     mov ebp, esp
@@ -64,6 +68,24 @@ restore_general_purpose_registers: ; using registers* struct, to load another ta
     add esp, 4
     ret
 
+task_kernel_switch: ; void task_kernel_switch(uint32_t* kernel_esp, struct task* next). Suspends the current task inside the kernel and runs 'next'
+    push ebp ; Registers that C functions expect to be preserved across the call
+    push ebx
+    push esi
+    push edi
+    mov eax, [esp+20] ; kernel_esp
+    mov [eax], esp ; The context stays on the stack of the sleeping task
+    push dword [esp+24] ; next
+    call task_resume ; It does not return, task_restore_kernel_context continues from the saved context
+
+task_restore_kernel_context: ; void task_restore_kernel_context(uint32_t kernel_esp). Continues a task suspended by task_kernel_switch
+    mov esp, [esp+4]
+    pop edi
+    pop esi
+    pop ebx
+    pop ebp
+    ret ; Back to the caller of task_kernel_switch
+
 user_registers: ; Sets the register back to the offset of the GDT entry for the USER_DATA_SEGMENT
     mov ax, 0x23 ; Offset 20 + ring privilege (ring 3) (see more about Request Protection Level)
     mov ds, ax
@@ -1,7 +1,9 @@
 #include "task.h"
+#include "tss.h"
 #include "kernel.h"
 #include "status.h"
 #include "memory/heap/kheap.h"
+#include "memory/heap/slab.h"
 #include "memory/memory.h"
 #include "process.h"
 #include "idt/idt.h"
@@ -9,6 +11,8 @@
 #include "string/string.h"
 #include "loader/formats/elfloader.h"
 
+static struct kmem_cache task_cache = KMEM_CACHE_INIT("task", sizeof(struct task));
+
 //Current task that is running
 struct task* current_task = 0;
 
@@ -16,10 +20,20 @@ struct task* current_task = 0;
 struct task* task_tail = 0;
 struct task* task_head = 0;
 
+//Set once the first task enters user land. Before that the kernel cannot switch away from kernel_main
+static bool task_scheduler_running = false;
+
+//Task woken up by an interrupt, it runs as soon as the interrupt returns to user land
+static struct task* task_woken = 0;
+
+//Kernel stack of a task freed while the kernel was still running on it
+static void* task_dead_kernel_stack = 0;
+
 //Sets the current task and its page directory
 int32_t task_switch(struct task* task)
 {
     current_task = task;
+    tss.esp0 = (uint32_t) task->kernel_stack + CROSOS_TASK_KERNEL_STACK_SIZE; //Interrupts from user land run on the stack of the task
     paging_switch(task->page_directory); //Set the paging directory to the one of the current task
     return 0;
 }
@@ -42,44 +56,30 @@ void task_save_state(struct task* task, struct interrupt_frame* frame)
     task->registers.esi = frame->esi;
 }
 
-//The 'virtual' addres cannot be accessed from kernel land directly
-//Solution
+//Copies a string of the current task to the kernel buffer 'phys'. The page directory of the task is the loaded one during its system calls
+//The kernel memory is mapped in every page directory, so 'phys' is reachable from it and the string is copied directly
+//Only memory of the process is read, a string that runs past it is cut
 int32_t copy_string_from_task(struct task* task, void* virtual, void* phys, int32_t max)
 {
     int32_t res = 0;
-    if(max >= PAGING_PAGE_SIZE)
+    if(task != task_current() || max <= 0 || max >= PAGING_PAGE_SIZE)
     {
         res = -EINVARG;
         goto out;
     }
 
-    
-    char* tmp = kzalloc(max); //Allocate some memory in the kernel land (linearly paged) that will be shared with the task memory
-    if(!tmp)
+    uint32_t available = process_user_range_size(task->process, virtual, false);
+    if(available == 0)
     {
-        res = -ENOMEM;
+        res = -EINVARG; //Not an address of the process, it could point to kernel memory
         goto out;
     }
 
-    uint32_t* task_directory = task->page_directory->directory_entry;
-    uint32_t old_entry = paging_get(task_directory, tmp); //Get paging entry from the task for the address allocated in the kernel land
-    paging_map(task->page_directory, tmp, tmp, PAGING_IS_WRITABLE | PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL); //We map the physical address of the tmp (created in kernel mode) to the same virtual address number for the task paging directory
-    //That allowed the task to see the memory created in the kernel,  'tmp'
-    paging_switch(task->page_directory);  //Switch to the task page
-    strncpy(tmp, virtual, max); //Copy from virtual task address to tmp, since virtual contains the string in the task paging and tmp points to the same physical address than kernel paging
-    kernel_page(); //Switch again to kernel paging, since the tmp is already placed where the kernel knows
-
-    res = paging_set(task_directory, tmp, old_entry); //Restore the virtual address modified 'tmp' to the old paging, to recover the original paging before copying the string
-    if(res < 0)
+    if(available < (uint32_t) max)
     {
-        res = -EIO;
-        goto out_free;
+        max = available;
     }
-
-    strncpy(phys, tmp, max); //Copy from 'tmp' (that points to the string we want) to the 'phys'
-
-out_free:
-    kfree(tmp); //Free tmp because all contents are already copied to 'phys'
+    strncpy(phys, virtual, max); //Copy from virtual task address to the kernel buffer, it is always terminated
 
 out:
     return res;
@@ -120,6 +120,7 @@ void task_run_first_ever_task()
     {
         panic("task_run_first_ever_task(): No current task existent");
     }
+    task_scheduler_running = true;
     task_switch(task_head); //Sets the current task and the loads its page directory
     task_return(&task_head->registers); // Performs the fake interrupt return and enters the process in user mode
 }
@@ -135,7 +136,7 @@ struct task* task_current() //Gets current task
 struct task* task_new(struct process* process)
 {
     uint32_t res = 0;
-    struct task* task = kzalloc(sizeof(struct task)); //Creates and allocates a new task
+    struct task* task = kmem_cache_zalloc(&task_cache); //Creates and allocates a new task
     if(!task)
     {
         res = -ENOMEM;
@@ -169,15 +170,26 @@ out:
     return task;
 }
 
-//Returns next task or first in the linked list
-struct task* task_get_next() //It can return null if there are no more tasks
+//Returns the next task ready to run, wrapping to the first one of the linked list. The current task is checked the last
+struct task* task_get_next() //It can return null if there are no tasks or all of them are sleeping
 {
-    if(!current_task->next)
+    if(!task_head)
     {
-        return task_head; //Return first task if the current task is the last one (tail_task)
+        return 0;
     }
 
-    return current_task->next;
+    struct task* task = current_task ? current_task : task_tail;
+    struct task* next = task;
+    do
+    {
+        next = next->next ? next->next : task_head; //First task if the current task is the last one (tail_task)
+        if(next->state == TASK_STATE_READY)
+        {
+            return next;
+        }
+    } while(next != task);
+
+    return 0;
 }
 
 //Removes a task from the linked list
@@ -188,6 +200,11 @@ static void task_list_remove(struct task* task)
         task->prev->next = task->next; //Link the previous task with the next task
     }
 
+    if(task->next)
+    {
+        task->next->prev = task->prev; //And the next task with the previous one
+    }
+
     if(task == task_head)
     {
         task_head = task->next; //If it is the first of the list, the following one will be now
@@ -200,17 +217,40 @@ static void task_list_remove(struct task* task)
 
     if(task == current_task)
     {
-        current_task = task_get_next(); //Set the next as a current task
+        current_task = task->next ? task->next : task_head; //Set the next as a current task, task_next looks for one ready to run from it
     }
 }
 
 //Frees the allocated memory for a task
 uint32_t task_free(struct task* task)
 {
+    if(task_dead_kernel_stack)
+    {
+        kfree(task_dead_kernel_stack);
+        task_dead_kernel_stack = 0;
+    }
+
+    if(task->kernel_stack)
+    {
+        if(task == current_task)
+        {
+            task_dead_kernel_stack = task->kernel_stack; //The kernel is running on it until the next task is entered
+        }
+        else
+        {
+            kfree(task->kernel_stack);
+        }
+    }
+
+    if(task == task_woken)
+    {
+        task_woken = 0;
+    }
+
     paging_free_4gb(task->page_directory); //Free the paging directory for the task
     task_list_remove(task); //Remove from the list
 
-    kfree(task); //Free the task data
+    kmem_cache_free(&task_cache, task); //Free the task data
 
     return 0;
 }
@@ -227,6 +267,13 @@ uint32_t task_init(struct task* task, struct process* process)
     {
         return -EIO;
     }
+
+    task->kernel_stack = kzalloc(CROSOS_TASK_KERNEL_STACK_SIZE);
+    if(!task->kernel_stack)
+    {
+        return -ENOMEM;
+    }
+    task->state = TASK_STATE_READY;
     
     task->registers.ip = CROSOS_PROGRAM_VIRTUAL_ADDRESS; //When we first create a task, the start address is a hardcoded value
     if(process->filetype == PROCESS_FILETYPE_ELF)
@@ -251,7 +298,7 @@ void* task_get_stack_item(struct task* task, int32_t index)
     task_page_task(task);
 
     result = (void*) sp_ptr[index]; //Get the element 'index' on the stack pointer of the task
-    //Switch back to kernel page
+    //Switch back to kernel segments, the kernel is mapped in the task page
     kernel_page();
     //Kernel ready to continue with the interrupt
 
@@ -269,11 +316,130 @@ void* task_virtual_address_to_physical(struct task* task, void* virtual_address)
 void task_next()
 {
     struct task* next_task = task_get_next();
-    if(!next_task)
+    while(!next_task)
+    {
+        if(!task_head)
+        {
+            panic("No more tasks\n");
+        }
+
+        idt_wait_for_interrupt(); //Every task is sleeping, wait until an interrupt wakes one up
+        next_task = task_get_next();
+    }
+
+    task_resume(next_task);
+}
+
+//Runs a task. It continues inside the kernel if it went to sleep there, or returns to user land otherwise
+void task_resume(struct task* task)
+{
+    task_switch(task);
+    if(task->kernel_esp)
+    {
+        uint32_t kernel_esp = task->kernel_esp;
+        task->kernel_esp = 0;
+        task_restore_kernel_context(kernel_esp); //Returns from the task_kernel_switch of task_sleep
+    }
+
+    task_return(&task->registers);
+}
+
+//Runs the task woken up by the interrupt that is returning, without waiting for the clock. The interrupted task state must be saved
+void task_run_woken()
+{
+    struct task* task = task_woken;
+    task_woken = 0;
+    if(!task || task == current_task || task->state != TASK_STATE_READY)
+    {
+        return;
+    }
+
+    task_resume(task);
+}
+
+//Puts the current task to sleep in 'queue' and runs other tasks until an interrupt or another task wakes it up
+//Interrupts must be disabled, so the wake up cannot happen before the task is queued
+void task_sleep(struct task_wait_queue* queue)
+{
+    struct task* task = current_task;
+    if(!task_scheduler_running || !task)
+    {
+        idt_wait_for_interrupt(); //Still in kernel_main, there is no task to switch to
+        return;
+    }
+
+    task->state = TASK_STATE_BLOCKED;
+    task->wait_next = 0;
+    if(queue->tail)
+    {
+        queue->tail->wait_next = task;
+    }
+    else
+    {
+        queue->head = task;
+    }
+    queue->tail = task;
+
+    struct task* next_task = task_get_next();
+    while(!next_task)
+    {
+        idt_wait_for_interrupt(); //Nothing else to run, the CPU halts on the stack of the task
+        next_task = task_get_next();
+    }
+
+    if(next_task == task)
+    {
+        return; //Woken up while halted
+    }
+
+    task_kernel_switch(&task->kernel_esp, next_task); //Returns when the task is resumed
+}
+
+//Wakes up every task sleeping in 'queue'
+void task_wakeup(struct task_wait_queue* queue)
+{
+    struct task* task = queue->head;
+    if(task && !task_woken)
+    {
+        task_woken = task;
+    }
+
+    while(task)
+    {
+        struct task* next = task->wait_next;
+        task->state = TASK_STATE_READY;
+        task->wait_next = 0;
+        task = next;
+    }
+
+    queue->head = 0;
+    queue->tail = 0;
+}
+
+//Takes the mutex, sleeping while another task holds it
+void task_mutex_lock(struct task_mutex* mutex)
+{
+    while(mutex->locked)
+    {
+        task_sleep(&mutex->waiters);
+    }
+    mutex->locked = true;
+}
+
+//Takes the mutex if it is free. Returns false instead of sleeping
+bool task_mutex_trylock(struct task_mutex* mutex)
+{
+    if(mutex->locked)
     {
-        panic("No more tasks\n");
+        return false;
     }
+    mutex->locked = true;
+    return true;
+}
 
-    task_switch(next_task);
-    task_return(&next_task->registers);
+//Releases the mutex and wakes up the tasks waiting for it
+void task_mutex_unlock(struct task_mutex* mutex)
+{
+    mutex->locked = false;
+    task_wakeup(&mutex->waiters);
 }
\ No newline at end of file
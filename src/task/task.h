@@ -1,8 +1,13 @@
 #ifndef TASK_H
 #define TASK_H
 
+#include <stdbool.h>
 #include "config.h"
 #include "memory/paging/paging.h"
+
+#define TASK_STATE_READY 0
+#define TASK_STATE_BLOCKED 1 //Sleeping in a wait queue, the scheduler skips it
+
 struct interrupt_frame;
 struct registers
 {
@@ -22,6 +27,22 @@ struct registers
 };
 
 struct process;
+struct task;
+
+//Tasks sleeping until an event happens (an interrupt, a lock released...)
+struct task_wait_queue
+{
+    struct task* head;
+    struct task* tail;
+};
+
+//Lock that puts the tasks to sleep instead of spinning
+struct task_mutex
+{
+    bool locked;
+    struct task_wait_queue waiters;
+};
+
 struct task
 {
     //The page directory of the task
@@ -38,6 +59,18 @@ struct task
 
     //Previous task in the linked list
     struct task* prev;
+
+    //TASK_STATE_READY or TASK_STATE_BLOCKED
+    uint32_t state;
+
+    //Stack used by the interrupts of the task
+    void* kernel_stack;
+
+    //Stack pointer saved when the task sleeps inside the kernel, 0 if it goes straight back to user land
+    uint32_t kernel_esp;
+
+    //Next task in the same wait queue
+    struct task* wait_next;
 };
 
 struct task* task_new(struct process* process);
@@ -62,5 +95,16 @@ int32_t task_page_task(struct task* task);
 void* task_virtual_address_to_physical(struct task* task, void* virtual_address);
 
 void task_next();
+void task_resume(struct task* task);
+void task_run_woken();
+
+void task_sleep(struct task_wait_queue* queue);
+void task_wakeup(struct task_wait_queue* queue);
+void task_mutex_lock(struct task_mutex* mutex);
+bool task_mutex_trylock(struct task_mutex* mutex);
+void task_mutex_unlock(struct task_mutex* mutex);
+
+extern void task_kernel_switch(uint32_t* kernel_esp, struct task* next);
+extern void task_restore_kernel_context(uint32_t kernel_esp);
 
 #endif
\ No newline at end of file
@@ -32,5 +32,6 @@ struct tss //Keeps the status of the registers when task switching
     uint32_t iobp;
 } __attribute__((packed));
 
+extern struct tss tss;
 extern void tss_load(uint32_t tss_segment); //Loads the TSS segment. ASM function
 #endif 
\ No newline at end of file
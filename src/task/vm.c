@@ -0,0 +1,290 @@
+#include "vm.h"
+#include "process.h"
+#include "task.h"
+#include "status.h"
+#include "memory/memory.h"
+#include "memory/heap/slab.h"
+#include "memory/frame/kframe.h"
+#include "memory/paging/paging.h"
+#include "loader/formats/elfloader.h"
+
+static struct kmem_cache vm_region_cache = KMEM_CACHE_INIT("process_vm_region", sizeof(struct process_vm_region));
+
+//Adds a lazily mapped region to the process. Nothing is mapped until the pages are touched
+int32_t process_vm_add_region(struct process* process, void* start, void* end, uint32_t flags, void* source, uint32_t source_size)
+{
+    if(!paging_is_aligned(start) || !paging_is_aligned(end) || end < start)
+    {
+        return -EINVARG;
+    }
+
+    if(source && !paging_is_aligned(source))
+    {
+        return -EINVARG; //Backing pages are mapped as they are, they must be aligned
+    }
+
+    //The range may overlap the kernel identity mapping. Remove it from the task, so every first touch faults, even from the kernel
+    int32_t res = paging_unmap_range(process->task->page_directory, start, (end - start) / PAGING_PAGE_SIZE);
+    if(res < 0)
+    {
+        return res;
+    }
+
+    struct process_vm_region* region = kmem_cache_zalloc(&vm_region_cache);
+    if(!region)
+    {
+        return -ENOMEM;
+    }
+
+    region->start = start;
+    region->end = end;
+    region->flags = flags;
+    region->source = source;
+    region->source_size = source ? source_size : 0;
+    region->next = process->vm_regions; //Add it at the front of the list
+    process->vm_regions = region;
+    return 0;
+}
+
+//Adds a lazily mapped region whose first 'file_size' bytes come from 'file_offset' of an elf file
+//Only the pages that are touched are read, through the sector cache of the disk
+int32_t process_vm_add_file_region(struct process* process, void* start, void* end, uint32_t flags, struct elf_file* file, uint32_t file_offset, uint32_t file_size)
+{
+    int32_t res = process_vm_add_region(process, start, end, flags, 0, 0);
+    if(res < 0)
+    {
+        return res;
+    }
+
+    struct process_vm_region* region = process->vm_regions; //Added at the front
+    region->file = file;
+    region->file_offset = file_offset;
+    region->source_size = file_size;
+    return 0;
+}
+
+//Returns the region that contains 'address'
+struct process_vm_region* process_vm_find_region(struct process* process, void* address)
+{
+    for(struct process_vm_region* region = process->vm_regions; region; region = region->next)
+    {
+        if(address >= region->start && address < region->end)
+        {
+            return region;
+        }
+    }
+    return 0;
+}
+
+//Checks if the physical page mapped at 'page' belongs to the backing memory of a region or to the shared pages of its file, instead of being a frame of its own
+static bool process_vm_is_source_page(struct process_vm_region* region, void* page, void* phys)
+{
+    if(region->file)
+    {
+        return elf_is_shared_page(region->file, region->file_offset + (page - region->start), phys);
+    }
+    return region->source && phys >= region->source && phys < paging_align_address(region->source + region->source_size);
+}
+
+//Gets the frame of a page of a read-only file region, shared with the other processes that run the same file
+//Returns 0 if the page cannot be shared, then the process gets a copy of its own
+static void* process_vm_get_shared_page(struct process_vm_region* region, uint32_t offset)
+{
+    if((region->flags & PAGING_IS_WRITABLE) || offset >= region->source_size)
+    {
+        return 0;
+    }
+
+    uint32_t total = region->source_size - offset;
+    if(total > PAGING_PAGE_SIZE)
+    {
+        total = PAGING_PAGE_SIZE;
+    }
+
+    void* frame = 0;
+    if(elf_get_shared_page(region->file, region->file_offset + offset, total, &frame) < 0)
+    {
+        return 0;
+    }
+    return frame;
+}
+
+//Gets the frame for the page at 'offset' of a region backed by a file
+//Read-only pages are shared with the other processes that run the same file. Otherwise the page gets a frame of its own,
+//with the part of the page that the file holds read into it and the rest (.bss) zero filled
+static int32_t process_vm_get_file_page(struct process_vm_region* region, uint32_t offset, void** phys_out)
+{
+    void* phys = process_vm_get_shared_page(region, offset);
+    if(phys)
+    {
+        *phys_out = phys;
+        return 0;
+    }
+
+    phys = kframe_zalloc(PAGING_PAGE_SIZE);
+    if(!phys)
+    {
+        return -ENOMEM;
+    }
+
+    if(offset < region->source_size)
+    {
+        uint32_t total = region->source_size - offset;
+        if(total > PAGING_PAGE_SIZE)
+        {
+            total = PAGING_PAGE_SIZE;
+        }
+
+        int32_t res = elf_read(region->file, region->file_offset + offset, total, phys);
+        if(res < 0)
+        {
+            kframe_free(phys);
+            return res;
+        }
+    }
+
+    *phys_out = phys;
+    return 0;
+}
+
+//Resolves a page fault of the process by mapping the faulting page of its region
+int32_t process_vm_handle_fault(struct process* process, void* address, uint32_t error_code)
+{
+    if(error_code & PAGE_FAULT_PRESENT)
+    {
+        return -EINVARG; //Protection violation, not a missing page
+    }
+
+    struct process_vm_region* region = process_vm_find_region(process, address);
+    if(!region)
+    {
+        return -EINVARG; //The address does not belong to the process
+    }
+
+    if((error_code & PAGE_FAULT_WRITE) && !(region->flags & PAGING_IS_WRITABLE))
+    {
+        return -EINVARG;
+    }
+
+    void* page = paging_align_to_lower_page(address);
+    uint32_t offset = page - region->start;
+    void* phys = 0;
+    if(region->file)
+    {
+        int32_t res = process_vm_get_file_page(region, offset, &phys);
+        if(res < 0)
+        {
+            return res;
+        }
+    }
+    else if(offset + PAGING_PAGE_SIZE <= region->source_size)
+    {
+        phys = region->source + offset; //Whole page inside the backing memory, map it directly
+    }
+    else
+    {
+        //Zero filled page, with the tail of the backing memory copied at its beginning if it ends inside this page
+        phys = kframe_zalloc(PAGING_PAGE_SIZE);
+        if(!phys)
+        {
+            return -ENOMEM;
+        }
+
+        if(offset < region->source_size)
+        {
+            memcpy(phys, region->source + offset, region->source_size - offset);
+        }
+    }
+
+    int32_t res = paging_map(process->task->page_directory, page, phys, region->flags);
+    if(res < 0 && !process_vm_is_source_page(region, page, phys))
+    {
+        kframe_free(phys);
+    }
+    return res;
+}
+
+//Frees the frames mapped in the pages [from, to) of a region. With 'unmap' the pages are removed from the task too
+static int32_t process_vm_free_pages(struct process* process, struct process_vm_region* region, void* from, void* to, bool unmap)
+{
+    int32_t res = 0;
+    uint32_t* directory = paging_4gb_chunk_get_directory(process->task->page_directory);
+    for(void* page = from; page < to; page += PAGING_PAGE_SIZE)
+    {
+        uint32_t entry = paging_get(directory, page);
+        if(!(entry & PAGING_IS_PRESENT))
+        {
+            continue; //Never touched
+        }
+
+        if(unmap)
+        {
+            res = paging_set(directory, page, 0x00);
+            if(res < 0)
+            {
+                break;
+            }
+        }
+
+        void* phys = (void*) (entry & PAGING_ADDRESS_MASK);
+        if(!process_vm_is_source_page(region, page, phys))
+        {
+            kframe_free(phys);
+        }
+    }
+    return res;
+}
+
+//Moves the end of the region that starts at 'start'. Pages left out of a shrinking region are given back
+int32_t process_vm_resize_region(struct process* process, void* start, void* new_end)
+{
+    if(!paging_is_aligned(new_end) || new_end < start)
+    {
+        return -EINVARG;
+    }
+
+    struct process_vm_region* region = process->vm_regions;
+    while(region && region->start != start)
+    {
+        region = region->next;
+    }
+
+    if(!region)
+    {
+        return -EINVARG;
+    }
+
+    int32_t res = 0;
+    if(new_end < region->end)
+    {
+        res = process_vm_free_pages(process, region, new_end, region->end, true);
+    }
+    else
+    {
+        //Same as a new region, the grown range must fault on its first touch
+        res = paging_unmap_range(process->task->page_directory, region->end, (new_end - region->end) / PAGING_PAGE_SIZE);
+    }
+
+    if(res < 0)
+    {
+        return res;
+    }
+
+    region->end = new_end;
+    return 0;
+}
+
+//Frees the frames mapped for the regions of a process and the regions themselves. The backing memory and files are owned by the caller
+void process_vm_free_regions(struct process* process)
+{
+    struct process_vm_region* region = process->vm_regions;
+    while(region)
+    {
+        process_vm_free_pages(process, region, region->start, region->end, false);
+
+        struct process_vm_region* next = region->next;
+        kmem_cache_free(&vm_region_cache, region);
+        region = next;
+    }
+    process->vm_regions = 0;
+}
@@ -0,0 +1,36 @@
+#ifndef VM_H
+#define VM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+//Error code pushed by the processor on a page fault
+#define PAGE_FAULT_PRESENT 0b00000001 // The page was present, it is a protection violation
+#define PAGE_FAULT_WRITE 0b00000010 // The access was a write
+#define PAGE_FAULT_USER 0b00000100 // The access came from user land
+
+//Range of virtual memory of a process whose pages are mapped when they are touched for the first time
+//Pages inside the backing source are mapped from it. The rest of the pages get a new zero filled frame
+//A region may be backed by an elf file instead, its pages get a new frame filled from the file
+struct process_vm_region
+{
+    void* start; //Page aligned first virtual address
+    void* end; //Page aligned end virtual address
+    uint32_t flags; //Paging flags of the mapped pages
+    void* source; //Page aligned backing memory for the beginning of the region, or 0 for zero filled regions
+    uint32_t source_size; //Bytes of backing memory, or of the file when 'file' is set
+    struct elf_file* file; //File backing the beginning of the region
+    uint32_t file_offset; //Offset in the file of the first byte of the region
+    struct process_vm_region* next;
+};
+
+struct process;
+struct elf_file;
+int32_t process_vm_add_region(struct process* process, void* start, void* end, uint32_t flags, void* source, uint32_t source_size);
+int32_t process_vm_add_file_region(struct process* process, void* start, void* end, uint32_t flags, struct elf_file* file, uint32_t file_offset, uint32_t file_size);
+struct process_vm_region* process_vm_find_region(struct process* process, void* address);
+int32_t process_vm_handle_fault(struct process* process, void* address, uint32_t error_code);
+int32_t process_vm_resize_region(struct process* process, void* start, void* new_end);
+void process_vm_free_regions(struct process* process);
+
+#endif